@@ -1,13 +1,30 @@
 #include "asset_cache.h"
+#include "asset_pack.h"
+#include "audio.h"
 #include "collision.h"
+#include "components.h"
+#include "counters.h"
 #include "forces.h"
+#include "hud.h"
+#include "level.h"
+#include "perf_overlay.h"
+#include "prefab.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rng.h"
 #include "sdl_wrapper.h"
-#include <SDL2/SDL_mixer.h>
+#include "startup.h"
+#include "ui.h"
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#define ALLOC_SUBSYSTEM ALLOC_GAME
+#include "alloc_track.h"
+
 const double ELASTICITY = 0;
 const vector_t MIN = {0, 0};
 const vector_t MAX = {1000, 500};
@@ -15,9 +32,11 @@ vector_t dasher_center = {50, MIN.y + 70};
 vector_t OBSTACLE_C = {1000, MIN.y + 70};
 SDL_Rect dasher_rect = {0, 0, 50, 50};
 const vector_t off_screen_start = {1499, 500};
-const size_t NUM_ATTEMPTS = 4;
 
-const char *MUSIC_L1 = "assets/stereo-madness-full-song-download.wav";
+// Built with tools/pack_assets; loose files under assets/ are used if missing
+const char *ASSET_PACK = "assets.pak";
+// Compressed, and decoded as it streams, so the whole song is never resident
+const char *MUSIC_L1 = "assets/stereo-madness.ogg";
 const char *DEATH_SOUND = "assets/Death-Sound.wav";
 const char *DASHER_IMAGE = "assets/geometryChar.png";
 char *START_SCREEN = "assets/START_SCREEN.png";
@@ -37,9 +56,6 @@ const double GRAVITY_STRENGTH = 2000;
 const vector_t WALL_OBSTACLE_VELO = {-200, 0};
 const vector_t COIN_OFFSCREEN = {-200, -200};
 const double OFFSCREEN_OBJ = 0.0;
-const double BLOCK_W = 40;
-const double BLOCK_H = 40;
-const double WALL_DIMENSION = 5;
 const double FLOOR_HEIGHT = 10;
 const double CENTROID_Y = 70;
 const double BG_HEIGHT = 50;
@@ -48,6 +64,19 @@ char *LEVEL1 = "assets/level1.png";
 char *LEVEL2 = "assets/level2.png";
 char *END_SCREEN = "assets/END_SCREEN.png";
 
+// Fixed layouts for each level, compiled with tools/level_compile. The text
+// sources are used if a level has not been compiled, and random obstacles are
+// spawned if neither exists.
+const char *LEVEL1_FILE = "assets/level1.lvb";
+const char *LEVEL1_SOURCE = "assets/level1.lvl";
+const char *LEVEL2_FILE = "assets/level2.lvb";
+const char *LEVEL2_SOURCE = "assets/level2.lvl";
+// Every level has a spawn table (see prefab.h), used when it has no layout
+#define NUM_LEVELS NUM_SPAWN_TABLES
+// How far past the right edge of the screen placements are spawned
+const double SPAWN_LOOKAHEAD = 100;
+const size_t INITIAL_POOL_CAPACITY = 8;
+
 const rgb_color_t black = (rgb_color_t){0, 0, 0};
 const double LEVEL_LENGTH = 30;
 const double MIN_COIN = 100.0;
@@ -56,119 +85,297 @@ const double COIN_SPAWN_X = 1100;
 
 const rgb_color_t WHITE = (rgb_color_t){255, 255, 255};
 const char *FONT = "assets/impact.ttf";
-const SDL_Rect ATTEMPTS_LOC1 = {500, 150, 200, 50};
-const SDL_Rect ATTEMPS_TEXT_LOC = {430, 150, 200, 50};
-const SDL_Rect ATTEMPTS_LOC2 = {300, 275, 200, 50};
-const SDL_Rect ATTEMPS_TEXT_LOC2 = {300, 250, 200, 50};
-
-const SDL_Rect COINS_TEXT_LOC = {15, 15, 200, 50};
-const SDL_Rect COINS_LOC = {10, 40, 200, 50};
-const SDL_Rect COINS_TEXT_LOC2 = {625, 250, 200, 50};
-const SDL_Rect COINS_LOC2 = {625, 275, 200, 50};
-const SDL_Rect LEVEL_TITLE_LOC = {430, 100, 200, 50};
-
-const double INITIAL_OBSTACLE_VELOCITY = -260;
-const double CURR_OB_VELO = -330;
-double current_obstacle_velocity = INITIAL_OBSTACLE_VELOCITY;
+const SDL_Point ATTEMPTS_LOC1 = {500, 150};
+const SDL_Point ATTEMPS_TEXT_LOC = {430, 150};
+const SDL_Point ATTEMPTS_LOC2 = {300, 275};
+const SDL_Point ATTEMPS_TEXT_LOC2 = {300, 250};
+
+const SDL_Point COINS_TEXT_LOC = {15, 15};
+const SDL_Point COINS_LOC = {10, 40};
+const SDL_Point COINS_TEXT_LOC2 = {625, 250};
+const SDL_Point COINS_LOC2 = {625, 275};
+const SDL_Point LEVEL_TITLE_LOC = {430, 100};
+const char *COUNTER_FORMAT = "%3lld";
+
+// The simulation advances in steps of FIXED_DT so runs can be replayed exactly.
+// Frames slower than MAX_FRAME_TIME are treated as that long, so one stall
+// does not make the next frame run a burst of steps.
+const double FIXED_DT = 1.0 / 120;
+const double MAX_FRAME_TIME = 0.25;
+// How many steps the death effect stays on screen after a death
+const uint64_t DEATH_EFFECT_TICKS = 12;
+// Paths to record the run's inputs to, or to play a recording back from
+const char *RECORD_ENV = "GD_RECORD";
+const char *REPLAY_ENV = "GD_REPLAY";
+// Where builds with -DPROFILE write their trace when the game exits
+const char *PROFILE_ENV = "GD_PROFILE";
+const char *DEFAULT_PROFILE_PATH = "profile.json";
+// Where each frame's engine counters are written as CSV, if set
+const char *COUNTERS_ENV = "GD_COUNTERS";
+
+// Practice mode respawns the dasher at the last checkpoint instead of the
+// start of the level. Checkpoints are taken this often while it is grounded.
+const char PRACTICE_KEY = 'p';
+const double CHECKPOINT_INTERVAL = 2.0;
+const char *PRACTICE_LABEL = "Practice";
+const SDL_Point PRACTICE_LOC = {850, 15};
+// Shows and hides frame timings; never recorded, since it is not part of a run
+const char PERF_OVERLAY_KEY = 'f';
+const SDL_Point PERF_OVERLAY_LOC = {10, 75};
+
+// Set from the spawn table of the level being played
+double current_obstacle_velocity;
+
+// Everything needed to put a level back the way it was at some point
+typedef struct checkpoint {
+  bool is_valid;
+  scene_snapshot_t *scene;
+  rng_t rng;
+  level_position_t level_position;
+  double time;
+  double distance;
+  double obstacle_timer;
+  double coin_timer;
+  double obstacle_velocity;
+  long long curr_coins;
+  bool is_jumping;
+  char *curr_bg_path;
+} checkpoint_t;
 
 typedef struct state {
   long long attempts;
-  asset_t *end_screen_attempts;
+  hud_t *game_hud;
+  hud_t *end_hud;
+  const char *level_title;
   body_t *dasher;
   scene_t *scene;
   long long curr_coins;
   bool is_jumping;
   bool on_start_screen;
   bool on_end_screen;
-  asset_t *button;
+  asset_t *play_button;
+  asset_t *play_again_button;
+  list_t *ui_assets;
+  asset_t *death_effect;
+  // The tick until which the death effect is drawn
+  uint64_t death_effect_until;
   char *curr_bg_path;
   asset_t *curr_bg;
+  // The path curr_bg was made from, so it is only remade when that changes
+  const char *curr_bg_asset_path;
 
   body_t *background;
   body_t *front_background;
-  list_t *body_assets;
+  // Tags, sprites, colliders and scroll velocities of every game object
+  component_store_t *components;
   body_t *backdrop;
   body_t *lower_background;
   double time;
+  // Indexed by level number - 1; NULL if the level has no layout file
+  level_t *levels[NUM_LEVELS];
+  // How far the current level has scrolled since it started
+  double distance;
+  // Parked obstacles and coins of each kind, waiting to be spawned again
+  list_t *pools[NUM_PREFABS];
+  // Time since the last random obstacle and coin, for levels without a layout
+  double obstacle_timer;
+  double coin_timer;
+
+  bool is_practicing;
+  // Set when the dasher dies in practice mode, so the next step respawns it
+  bool respawn_pending;
+  checkpoint_t checkpoint;
+  // PRACTICE_LABEL while practicing, shown in the HUD
+  const char *practice_label;
+
+  perf_overlay_t *perf_overlay;
+
+  // All randomness comes from here, so a run is reproduced by its seed
+  rng_t rng;
+  // The index of the next simulation step
+  uint64_t tick;
+  // Time that has passed but not been simulated, less than FIXED_DT
+  double unsimulated_time;
+  // Where inputs are written to, or read from instead of SDL (or NULL)
+  replay_t *recording;
+  replay_t *playback;
+  // Where each frame's counters are logged (or NULL)
+  FILE *counters_log;
+  // The UI screen of the last frame presented, and whether the last frame
+  // was skipped because it would have looked the same
+  size_t shown_screen;
+  bool is_idle;
 } state_t;
 
 typedef enum {
   DASHER,
-  FLOOR, // Able to bounce on top
-  WALL,  // Destruction when collide on side of wall
   SCREEN,
   OBSTACLE,
 } body_type_t;
 
+// The screens that UI regions are registered to
+typedef enum {
+  SCREEN_START,
+  SCREEN_GAME,
+  SCREEN_END,
+} screen_t;
+
 typedef struct button_info {
   const char *image_path;
   SDL_Rect image_box;
   button_handler_t handler;
 } button_info_t;
 
-void init_music() {
-  SDL_Init(SDL_INIT_AUDIO);
-  Mix_Init(0);
-  Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048);
-  Mix_Music *music = Mix_LoadMUS(MUSIC_L1);
-  Mix_PlayMusic(music, -1);
+// Bodies store the id of their entity in the component store as their info
+entity_t get_entity(body_t *body) {
+  return (entity_t)(uintptr_t)body_get_info(body);
+}
+
+tag_component_t *get_tag(state_t *state, body_t *body) {
+  return component_get(state->components, COMPONENT_TAG, get_entity(body));
+}
+
+body_t *get_collider(state_t *state, entity_t entity) {
+  body_t **collider =
+      component_get(state->components, COMPONENT_COLLIDER, entity);
+  return collider ? *collider : NULL;
+}
+
+// Creates a body for a new entity with a tag and collider, and adds it to the
+// scene
+body_t *make_body(state_t *state, list_t *shape, double mass,
+                  rgb_color_t color, body_type_t type) {
+  entity_t entity = entity_create(state->components);
+  body_t *body =
+      body_init_with_info(shape, mass, color, (void *)(uintptr_t)entity, NULL);
+  tag_component_t *tag =
+      component_add(state->components, COMPONENT_TAG, entity);
+  tag->type = type;
+  tag->variant = NUM_PREFABS;
+  body_t **collider =
+      component_add(state->components, COMPONENT_COLLIDER, entity);
+  *collider = body;
+  scene_add_body(state->scene, body);
+  return body;
 }
 
-void stop_music() { Mix_HaltMusic(); }
+// Adds an image on top of the ones already drawn for a body
+void add_sprite(state_t *state, body_t *body, asset_t *asset) {
+  sprite_component_t *sprite =
+      component_add(state->components, COMPONENT_SPRITE, get_entity(body));
+  assert(sprite->num_layers < SPRITE_MAX_LAYERS);
+  sprite->layers[sprite->num_layers++] = asset;
+}
 
-void sound_effects(const char *filepath) {
-  SDL_Init(SDL_INIT_AUDIO);
-  Mix_OpenAudio(4412, MIX_DEFAULT_FORMAT, 2, 300);
-  Mix_Chunk *music = Mix_LoadWAV(filepath);
-  Mix_PlayChannel(1, music, 0);
+// Makes a body scroll with the level at `velocity`
+void add_scroll_velocity(state_t *state, body_t *body, vector_t velocity) {
+  vector_t *scroll =
+      component_add(state->components, COMPONENT_VELOCITY, get_entity(body));
+  *scroll = velocity;
+  body_set_velocity(body, velocity);
 }
 
-body_type_t *make_type_info(body_type_t type) {
-  body_type_t *info = malloc(sizeof(body_type_t));
-  assert(info);
-  *info = type;
-  return info;
+// Changes the speed of everything that scrolls with the level
+void set_scroll_velocity(state_t *state, vector_t velocity) {
+  for (size_t i = 0; i < component_count(state->components, COMPONENT_VELOCITY);
+       i++) {
+    vector_t *scroll = component_at(state->components, COMPONENT_VELOCITY, i);
+    *scroll = velocity;
+    entity_t entity = component_entity(state->components, COMPONENT_VELOCITY, i);
+    body_set_velocity(get_collider(state, entity), velocity);
+  }
 }
 
-body_type_t get_type(body_t *body) {
-  return *(body_type_t *)body_get_info(body);
+// Frees a body's images and entity, and removes the body from the scene
+void destroy_body(state_t *state, body_t *body) {
+  entity_t entity = get_entity(body);
+  sprite_component_t *sprite =
+      component_get(state->components, COMPONENT_SPRITE, entity);
+  if (sprite != NULL) {
+    for (size_t i = 0; i < sprite->num_layers; i++) {
+      asset_destroy(sprite->layers[i]);
+    }
+  }
+  entity_destroy(state->components, entity);
+  body_remove(body);
+}
+
+// Parks a spawned body so spawn_prefab_kind() can reuse it. The body keeps
+// its shape, assets and collisions but sleeps until it is reused.
+void recycle_body(state_t *state, body_t *body) {
+  prefab_kind_t prefab = get_tag(state, body)->variant;
+  if (prefab == NUM_PREFABS) {
+    destroy_body(state, body);
+    return;
+  }
+  if (body_is_asleep(body)) {
+    return;
+  }
+  body_reset(body);
+  body_set_asleep(body, true);
+  list_add(state->pools[prefab], body);
+}
+
+// Swaps the image on the scrolling level backgrounds
+void set_level_background(state_t *state, const char *path) {
+  body_t *backgrounds[] = {state->background, state->backdrop};
+  for (size_t i = 0; i < sizeof(backgrounds) / sizeof(backgrounds[0]); i++) {
+    sprite_component_t *sprite = component_get(
+        state->components, COMPONENT_SPRITE, get_entity(backgrounds[i]));
+    asset_destroy(sprite->layers[0]);
+    sprite->layers[0] = asset_make_image_with_body(path, backgrounds[i]);
+  }
+}
+
+// Gets the layout of the level being played, or NULL if it has none
+level_t *get_current_level(state_t *state) {
+  if (strcmp(state->curr_bg_path, LEVEL1) == 0) {
+    return state->levels[0];
+  } else if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
+    return state->levels[1];
+  }
+  return NULL;
+}
+
+// Gets how the level being played spawns obstacles, or NULL outside levels
+const spawn_table_t *get_spawn_table(state_t *state) {
+  if (strcmp(state->curr_bg_path, LEVEL1) == 0) {
+    return &SPAWN_TABLES[0];
+  } else if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
+    return &SPAWN_TABLES[1];
+  }
+  return NULL;
+}
+
+// Scrolls the current level back to its start
+void restart_level(state_t *state) {
+  state->time = 0;
+  state->distance = 0;
+  level_t *level = get_current_level(state);
+  if (level != NULL) {
+    level_reset(level);
+  }
 }
 
 // button handler for the play button and play again button
 void play(state_t *state) {
   state->on_start_screen = false;
   state->curr_bg_path = LEVEL1;
-  init_music();
-
-  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    body_type_t type = get_type(body);
-    if (type == WALL || type == OBSTACLE) {
-      body_set_velocity(body, WALL_OBSTACLE_VELO);
-    }
-  }
+  ui_set_screen(SCREEN_GAME);
+  audio_play_music(MUSIC_L1);
+  set_scroll_velocity(state, WALL_OBSTACLE_VELO);
 }
 
 void play_again(state_t *state) {
   state->on_end_screen = false;
   state->curr_bg_path = LEVEL1;
-  state->time = 0;
+  ui_set_screen(SCREEN_GAME);
+  restart_level(state);
   state->curr_coins = 0;
   state->attempts = 1;
-  stop_music();
-  init_music();
-  asset_t *new_asset1 = asset_make_image_with_body(LEVEL1, state->background);
-  asset_t *new_asset3 = asset_make_image_with_body(LEVEL1, state->backdrop);
-  list_set(state->body_assets, 0, new_asset1);
-  list_set(state->body_assets, 1, new_asset3);
-
-  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    body_type_t type = get_type(body);
-    if (type == WALL || type == OBSTACLE) {
-      body_set_velocity(body, WALL_OBSTACLE_VELO);
-    }
-  }
+  audio_play_music(MUSIC_L1);
+  set_level_background(state, LEVEL1);
+  set_scroll_velocity(state, WALL_OBSTACLE_VELO);
 }
 
 button_info_t play_button_info = {.image_path = "assets/PLAYBUTTON.jpeg",
@@ -190,94 +397,77 @@ asset_t *get_background(const char *path) {
   return background;
 }
 
+// Everything that scrolls with the level is an obstacle or a coin
 void remove_all_obstacles(state_t *state) {
-  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    if (get_type(body) == WALL || get_type(body) == OBSTACLE ||
-        get_type(body) == FLOOR) {
-      body_reset(body);
-      scene_remove_body(state->scene, i);
-    }
-  }
-  for (size_t i = 0; i < list_size(state->body_assets); i++) {
-    asset_t *asset = list_get(state->body_assets, i);
-    body_t *body = asset_to_body(asset);
-    if (body_is_removed(body)) {
-      asset_destroy(asset);
-      list_remove(state->body_assets, i);
-      i--;
-    }
+  // Backwards, since bodies that cannot be recycled leave the array
+  for (size_t i = component_count(state->components, COMPONENT_VELOCITY);
+       i-- > 0;) {
+    entity_t entity = component_entity(state->components, COMPONENT_VELOCITY, i);
+    recycle_body(state, get_collider(state, entity));
   }
 }
 
 void reset_to_level1(state_t *state) {
-  stop_music();
-  init_music();
+  audio_restart_music();
 
   remove_all_obstacles(state);
-  state->time = 0;
 
   state->curr_bg_path = LEVEL1;
-  asset_t *new_bg = asset_make_image_with_body(LEVEL1, state->background);
-  list_set(state->body_assets, 0, new_bg);
-  asset_t *new_backdrop = asset_make_image_with_body(LEVEL1, state->backdrop);
-  list_set(state->body_assets, 1, new_backdrop);
+  set_level_background(state, LEVEL1);
 
-  current_obstacle_velocity = INITIAL_OBSTACLE_VELOCITY;
-  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    body_type_t type = get_type(body);
-    if (type == WALL || type == OBSTACLE) {
-      vector_t body_vel = {current_obstacle_velocity, 0};
-      body_set_velocity(body, body_vel);
-    }
-  }
+  current_obstacle_velocity = SPAWN_TABLES[0].velocity;
+  set_scroll_velocity(state, (vector_t){current_obstacle_velocity, 0});
 }
 
 void reset_game(body_t *body1, body_t *body2, vector_t axis, void *aux,
                 double force_const) {
   state_t *state = aux;
+  // The scene is mid-tick, so practice mode respawns once the tick is over
+  if (state->is_practicing && state->checkpoint.is_valid) {
+    state->respawn_pending = true;
+    return;
+  }
   body_set_centroid(body1, dasher_center);
   body_reset(body1);
 
   // Short Visual effect to not distract player from game
-  sound_effects(DEATH_SOUND);
-  SDL_Rect death_box = {0, MAX.y - 175, 200, 200};
-  asset_t *death = asset_make_image(DETH_EFFECT, death_box);
-  asset_render(death);
-  asset_destroy(death);
+  audio_play_effect(DEATH_SOUND);
+  state->death_effect_until = state->tick + DEATH_EFFECT_TICKS;
   state->curr_coins = 0;
   state->attempts++;
   state->is_jumping = true;
-  state->time = 0;
   if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
     reset_to_level1(state);
   } else {
-    stop_music();
-    init_music();
+    audio_restart_music();
     remove_all_obstacles(state);
   }
+  restart_level(state);
 }
 
 void coin_collision(body_t *body1, body_t *body2, vector_t axis, void *aux,
                     double force_const) {
   state_t *state = aux;
-  sound_effects(COIN_SOUND_EFFECT);
+  audio_play_effect(COIN_SOUND_EFFECT);
   state->curr_coins++;
   state->is_jumping = true;
 
   body_set_centroid(body2, COIN_OFFSCREEN);
-  body_remove(body2);
+  recycle_body(state, body2);
 }
 
-asset_t *create_button_from_info(state_t *state, button_info_t info) {
+// Creates a button once and makes it clickable whenever `screen` is shown
+asset_t *create_button_from_info(state_t *state, button_info_t info,
+                                 screen_t screen) {
   asset_t *image_asset = NULL;
   if (info.image_path != NULL) {
     image_asset = asset_make_image(info.image_path, info.image_box);
+    list_add(state->ui_assets, image_asset);
   }
   asset_t *new_button =
       asset_make_button(info.image_box, image_asset, NULL, info.handler);
-  asset_cache_register_button(new_button);
+  list_add(state->ui_assets, new_button);
+  ui_add_button(new_button, screen);
   return new_button;
 }
 
@@ -332,9 +522,19 @@ void off_floor(state_t *state) {
   }
 }
 
-void on_key(char key, key_event_type_t type, double held_time, state_t *state) {
+void toggle_practice(state_t *state) {
+  state->is_practicing = !state->is_practicing;
+  state->practice_label = state->is_practicing ? PRACTICE_LABEL : NULL;
+  state->checkpoint.is_valid = false;
+}
+
+void apply_key(char key, key_event_type_t type, double held_time,
+               state_t *state) {
   body_t *user = state->dasher;
-  if (type == KEY_PRESSED) {
+  // Key repeats while 'p' is held do not toggle it back and forth
+  if (type == KEY_PRESSED && key == PRACTICE_KEY && held_time == 0) {
+    toggle_practice(state);
+  } else if (type == KEY_PRESSED) {
     switch (key) {
     case UP_ARROW:
     case SPACE_BAR:
@@ -352,6 +552,69 @@ void on_key(char key, key_event_type_t type, double held_time, state_t *state) {
   }
 }
 
+void apply_click(int x, int y, state_t *state) {
+  ui_handle_click(state, x, y);
+  apply_key(UP_ARROW, KEY_PRESSED, 0, state);
+}
+
+// Live input is recorded if requested, and ignored while a recording plays
+void on_key(char key, key_event_type_t type, double held_time, state_t *state) {
+  if (key == PERF_OVERLAY_KEY) {
+    if (type == KEY_PRESSED && held_time == 0) {
+      perf_overlay_toggle(state->perf_overlay);
+    }
+    return;
+  }
+  if (state->playback != NULL) {
+    return;
+  }
+  // Only the first press of the practice key does anything, so its repeats
+  // are not worth recording
+  if (key == PRACTICE_KEY && held_time > 0) {
+    return;
+  }
+  if (state->recording != NULL) {
+    replay_event_t event = {.type = REPLAY_KEY,
+                            .tick = state->tick,
+                            .key = key,
+                            .released = type == KEY_RELEASED,
+                            .held_time = held_time};
+    replay_write(state->recording, &event);
+  }
+  apply_key(key, type, held_time, state);
+}
+
+void on_click(int x, int y, state_t *state) {
+  if (state->playback != NULL) {
+    return;
+  }
+  if (state->recording != NULL) {
+    replay_event_t event = {
+        .type = REPLAY_CLICK, .tick = state->tick, .x = x, .y = y};
+    replay_write(state->recording, &event);
+  }
+  apply_click(x, y, state);
+}
+
+// The HUDs are cached in render targets, which the renderer can lose
+void on_render_reset(state_t *state) {
+  hud_invalidate(state->game_hud);
+  hud_invalidate(state->end_hud);
+}
+
+// Applies the recorded inputs that are due before the next step
+void play_back_inputs(state_t *state) {
+  replay_event_t event;
+  while (replay_next(state->playback, state->tick, &event)) {
+    if (event.type == REPLAY_KEY) {
+      apply_key(event.key, event.released ? KEY_RELEASED : KEY_PRESSED,
+                event.held_time, state);
+    } else if (event.type == REPLAY_CLICK) {
+      apply_click(event.x, event.y, state);
+    }
+  }
+}
+
 void update_background_positions(state_t *state, double dt) {
   vector_t bg_pos = body_get_centroid(state->background);
   vector_t front_pos = body_get_centroid(state->front_background);
@@ -387,283 +650,241 @@ void update_background_positions(state_t *state, double dt) {
 body_t *background_helper(state_t *state, vector_t center, double width,
                           double height, rgb_color_t color, const char *image) {
   list_t *rectangle = make_rectangle(center, width, height);
-  body_t *back = body_init_with_info(rectangle, INFINITY, color,
-                                     make_type_info(SCREEN), free);
-  asset_t *asset_made = asset_make_image_with_body(image, back);
-  list_add(state->body_assets, asset_made);
-  scene_add_body(state->scene, back);
+  body_t *back = make_body(state, rectangle, INFINITY, color, SCREEN);
+  add_sprite(state, back, asset_make_image_with_body(image, back));
   return back;
 }
 
-body_t *make_dasher(vector_t center) {
+body_t *make_dasher(state_t *state, vector_t center) {
   SDL_Rect rect = dasher_rect;
   list_t *shape = make_rectangle(center, rect.w, rect.h);
-  body_t *dasher =
-      body_init_with_info(shape, 1, WHITE, make_type_info(DASHER), free);
+  body_t *dasher = make_body(state, shape, 1, WHITE, DASHER);
+  // Falls far enough in one step to pass through the landing strips on blocks
+  body_set_continuous(dasher, true);
+  add_sprite(state, dasher, asset_make_image_with_body(DASHER_IMAGE, dasher));
   return dasher;
 }
 
-void add_coin(state_t *state, vector_t center, double width, double height) {
+body_t *add_coin(state_t *state, vector_t center, double width,
+                 double height) {
   list_t *coin_shape = make_rectangle(center, width, height);
-  body_t *coin = body_init_with_info(coin_shape, INFINITY, WHITE,
-                                     make_type_info(OBSTACLE), free);
-  asset_t *asset_obj = asset_make_image_with_body(COINS, coin);
-  list_add(state->body_assets, asset_obj);
-  scene_add_body(state->scene, coin);
-  vector_t body_vel = {current_obstacle_velocity, 0};
-  body_set_velocity(coin, body_vel);
+  body_t *coin = make_body(state, coin_shape, INFINITY, WHITE, OBSTACLE);
+  add_sprite(state, coin, asset_make_image_with_body(COINS, coin));
+  add_scroll_velocity(state, coin, (vector_t){current_obstacle_velocity, 0});
   create_collision(state->scene, state->dasher, coin, coin_collision, state,
                    0.0);
+  return coin;
 }
 
-// Creates obstacles for the user. This obstacle the user can not
-// collide with otherwise they lose
-void add_obstacles_unjumpable(state_t *state, vector_t center, double width,
-                              double height) {
-  list_t *obstacle_shape = make_rectangle(center, width, height);
-  body_t *obstacle = body_init_with_info(obstacle_shape, INFINITY, WHITE,
-                                         make_type_info(WALL), free);
-  asset_t *asset_ob = asset_make_image_with_body(SPIKES, obstacle);
-  list_add(state->body_assets, asset_ob);
-  scene_add_body(state->scene, obstacle);
-
-  vector_t body_vel = {current_obstacle_velocity, 0};
-  body_set_velocity(obstacle, body_vel);
-  create_collision(state->scene, state->dasher, obstacle, reset_game, state,
-                   0.0);
+// Handlers for the dasher hitting each part_tag_t of an obstacle
+const collision_handler_t PART_HANDLERS[NUM_PART_TAGS] = {
+    [PART_LANDING] = dasher_floor_collision_handler,
+    [PART_SIDE] = reset_game,
+    [PART_SPIKE] = reset_game,
+};
+
+// Starts an obstacle made of parts. The anchor only positions the obstacle;
+// it is never drawn or collided with.
+body_t *prefab_init(state_t *state, vector_t anchor, double width,
+                    double height) {
+  list_t *anchor_shape = make_rectangle(anchor, width, height);
+  return make_body(state, anchor_shape, INFINITY, black, OBSTACLE);
 }
 
-void add_obstacles_jumpable(state_t *state, vector_t center, double width,
-                            double height, double wall_dim) {
-  vector_t floor_center = {center.x, center.y + height / 2};
-  list_t *floor_shape = make_rectangle(floor_center, width, wall_dim - 2);
-  body_t *floor = body_init_with_info(floor_shape, INFINITY, black,
-                                      make_type_info(FLOOR), free);
-  scene_add_body(state->scene, floor);
-
-  vector_t left_wall_center = {(center.x - width / 2 + wall_dim / 2),
-                               center.y - 2};
-  list_t *left_wall_shape =
-      make_rectangle(left_wall_center, wall_dim, height - (3 * wall_dim));
-  body_t *left_wall = body_init_with_info(left_wall_shape, INFINITY, black,
-                                          make_type_info(WALL), free);
-  scene_add_body(state->scene, left_wall);
-
-  list_t *center_square_shape =
-      make_rectangle((vector_t){center.x, center.y}, width, height);
-  body_t *center_square = body_init_with_info(
-      center_square_shape, INFINITY, black, make_type_info(OBSTACLE), free);
-  asset_t *asset_square = asset_make_image_with_body(BOX, center_square);
-  list_add(state->body_assets, asset_square);
-  scene_add_body(state->scene, center_square);
-
-  vector_t body_vel = {current_obstacle_velocity, 0};
-  body_set_velocity(center_square, body_vel);
-  body_set_velocity(floor, body_vel);
-  body_set_velocity(left_wall, body_vel);
-
-  create_collision(state->scene, state->dasher, floor,
-                   dasher_floor_collision_handler, state, 0.0);
-
-  create_collision(state->scene, state->dasher, left_wall, reset_game, state,
-                   0.0);
+bool has_part(body_t *body, part_tag_t tag) {
+  for (size_t i = 0; i < body_num_parts(body); i++) {
+    if (body_get_part_tag(body, i) == tag) {
+      return true;
+    }
+  }
+  return false;
 }
 
-void triple_block(state_t *state, vector_t center) {
-  double block_width = BLOCK_W;
-  double block_height = BLOCK_H;
-
-  vector_t block1_center = center;
-  vector_t block2_center = {center.x + block_width, center.y};
-  vector_t block3_center = {center.x + 2 * block_width, center.y};
-
-  add_obstacles_jumpable(state, block1_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block2_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block3_center, block_width, block_height,
-                         WALL_DIMENSION);
+// Adds a finished obstacle to the scene with its images and one collision
+// covering all of its parts
+void prefab_finish(state_t *state, body_t *prefab) {
+  if (has_part(prefab, PART_BLOCK)) {
+    add_sprite(state, prefab,
+               asset_make_image_with_part(BOX, prefab, PART_BLOCK));
+  }
+  if (has_part(prefab, PART_SPIKE)) {
+    add_sprite(state, prefab,
+               asset_make_image_with_part(SPIKES, prefab, PART_SPIKE));
+  }
+  add_scroll_velocity(state, prefab,
+                      (vector_t){current_obstacle_velocity, 0});
+  create_compound_collision(state->scene, state->dasher, prefab, PART_HANDLERS,
+                            NUM_PART_TAGS, state, 0.0);
 }
 
-void five_block(state_t *state, vector_t center) {
-  double block_width = BLOCK_W;
-  double block_height = BLOCK_H;
-
-  vector_t block1_center = center;
-  vector_t block2_center = {center.x + block_width, center.y};
-  vector_t block3_center = {center.x + 2 * block_width, center.y};
-  vector_t block4_center = {center.x + 3 * block_width, center.y};
-  vector_t block5_center = {center.x + 4 * block_width, center.y};
-
-  add_obstacles_jumpable(state, block1_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block2_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block3_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block4_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block5_center, block_width, block_height,
-                         WALL_DIMENSION);
+// Builds an obstacle centered at `center` from its precomputed shape
+body_t *add_obstacle(state_t *state, vector_t center,
+                     const level_shape_t *shape) {
+  body_t *obstacle = prefab_init(state, center, shape->size.x, shape->size.y);
+  for (size_t i = 0; i < shape->num_parts; i++) {
+    const level_part_t *part = &shape->parts[i];
+    vector_t part_center = {center.x + (part->min.x + part->max.x) / 2,
+                            center.y + (part->min.y + part->max.y) / 2};
+    body_add_part(obstacle,
+                  make_rectangle(part_center, part->max.x - part->min.x,
+                                 part->max.y - part->min.y),
+                  part->tag);
+  }
+  prefab_finish(state, obstacle);
+  return obstacle;
 }
 
-void triple_staircase(state_t *state, vector_t center) {
-  double block_width = BLOCK_W;
-  double block_height = BLOCK_H;
-
-  vector_t block1_center = center;
-
-  vector_t block2_center = {center.x + 5 * block_width, 20 + center.y};
+// Update screen if level is complete
+void update_level(state_t *state) {
+  // Levels with a layout end once their last placement has crossed the screen
+  level_t *level = get_current_level(state);
+  bool is_complete;
+  if (level != NULL) {
+    is_complete =
+        level_is_done(level) && state->distance > level_length(level);
+  } else {
+    is_complete = state->time > LEVEL_LENGTH;
+  }
+  if (is_complete) {
+    if (strcmp(state->curr_bg_path, LEVEL1) == 0) {
+      remove_all_obstacles(state);
+      state->curr_bg_path = LEVEL2;
+      restart_level(state);
 
-  vector_t block3_center = {center.x + 10 * block_width, 40 + center.y};
+      set_level_background(state, LEVEL2);
 
-  add_obstacles_jumpable(state, block1_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block2_center, block_width, 2 * block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block3_center, block_width, 3 * block_height,
-                         WALL_DIMENSION);
+      current_obstacle_velocity = SPAWN_TABLES[1].velocity;
+    } else if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
+      state->curr_bg_path = END_SCREEN;
+      ui_set_screen(SCREEN_END);
+      current_obstacle_velocity = SPAWN_TABLES[0].velocity;
+      state->on_end_screen = true;
+    }
+  }
 }
 
-void double_staircase(state_t *state, vector_t center) {
-  double block_width = BLOCK_W;
-  double block_height = BLOCK_H;
-
-  vector_t block1_center = center;
-
-  vector_t block2_center = {center.x + 6 * block_width, 20 + center.y};
-
-  add_obstacles_jumpable(state, block1_center, block_width, block_height,
-                         WALL_DIMENSION);
-  add_obstacles_jumpable(state, block2_center, block_width, 2 * block_height,
-                         WALL_DIMENSION);
+// Gets the title shown in the HUD for the level with the given background
+const char *get_level_title(const char *bg_path) {
+  if (strcmp(bg_path, LEVEL1) == 0) {
+    return "Level1";
+  } else if (strcmp(bg_path, LEVEL2) == 0) {
+    return "Level2";
+  }
+  return NULL;
 }
 
-void triple_spike(state_t *state, vector_t center) {
-  double spike_width = BLOCK_W;
-  double spike_height = BLOCK_H;
-
-  vector_t spike1_center = center;
-  vector_t spike2_center = {center.x + spike_width, center.y};
-  vector_t spike3_center = {center.x + 2 * spike_width, center.y};
-
-  add_obstacles_unjumpable(state, spike1_center, spike_width, spike_height);
-  add_obstacles_unjumpable(state, spike2_center, spike_width, spike_height);
-  add_obstacles_unjumpable(state, spike3_center, spike_width, spike_height);
+// Spawns a prefab with the given shape centered at `center`, reusing a parked
+// one if there is one. Reuse only moves the body and wakes it, so it
+// allocates nothing.
+void spawn_prefab_shape(state_t *state, prefab_kind_t kind, vector_t center,
+                        const level_shape_t *shape) {
+  list_t *pool = state->pools[kind];
+  if (list_size(pool) > 0) {
+    body_t *body = list_remove(pool, list_size(pool) - 1);
+    vector_t velocity = {current_obstacle_velocity, 0};
+    *(vector_t *)component_get(state->components, COMPONENT_VELOCITY,
+                               get_entity(body)) = velocity;
+    body_set_centroid(body, center);
+    body_set_velocity(body, velocity);
+    body_set_asleep(body, false);
+    return;
+  }
+  body_t *body;
+  if (kind == PREFAB_COIN) {
+    body = add_coin(state, center, shape->size.x, shape->size.y);
+  } else {
+    body = add_obstacle(state, center, shape);
+  }
+  get_tag(state, body)->variant = kind;
 }
 
-void double_spike(state_t *state, vector_t center) {
-  double spike_width = BLOCK_W;
-  double spike_height = BLOCK_H;
+// Spawns a prefab in its usual shape centered at `center`
+void spawn_prefab_kind(state_t *state, prefab_kind_t kind, vector_t center) {
+  spawn_prefab_shape(state, kind, center, &PREFAB_SHAPES[kind]);
+}
 
-  vector_t spike1_center = center;
-  vector_t spike2_center = {center.x + spike_width, center.y};
+void add_random_obstacles(state_t *state, const spawn_table_t *table) {
+  size_t random_index = rng_range(&state->rng, table->num_kinds);
+  spawn_prefab_kind(state, table->kinds[random_index], OBSTACLE_C);
+}
 
-  add_obstacles_unjumpable(state, spike1_center, spike_width, spike_height);
-  add_obstacles_unjumpable(state, spike2_center, spike_width, spike_height);
+// level_spawner_t that creates a placement at its current screen position
+void spawn_prefab(void *aux, size_t kind, vector_t position,
+                  const level_shape_t *shape) {
+  state_t *state = aux;
+  vector_t center = {position.x - state->distance, position.y};
+  spawn_prefab_shape(state, kind, center, shape);
 }
 
-// Update screen if level is complete
-void update_level(state_t *state) {
-  if (state->time > LEVEL_LENGTH) {
-    if (strcmp(state->curr_bg_path, LEVEL1) == 0) {
-      remove_all_obstacles(state);
-      state->curr_bg_path = LEVEL2;
-      state->time = 0;
+// Spawns random obstacles and coins for levels without a layout file
+void spawn_random(state_t *state, double dt) {
+  state->obstacle_timer += dt;
+  state->coin_timer += dt;
+  if (state->coin_timer >= 5.0) {
+    double random_double =
+        MIN_COIN + rng_double(&state->rng) * (MAX_COIN - MIN_COIN);
+    spawn_prefab_kind(state, PREFAB_COIN,
+                      (vector_t){COIN_SPAWN_X, random_double});
+    state->coin_timer = 0;
+  }
 
-      asset_t *new_asset1 =
-          asset_make_image_with_body(LEVEL2, state->background);
-      asset_t *new_asset3 = asset_make_image_with_body(LEVEL2, state->backdrop);
-      list_set(state->body_assets, 0, new_asset1);
-      list_set(state->body_assets, 1, new_asset3);
+  const spawn_table_t *table = get_spawn_table(state);
+  if (table != NULL && state->obstacle_timer >= table->interval) {
+    add_random_obstacles(state, table);
+    state->obstacle_timer = 0;
+  }
+}
 
-      current_obstacle_velocity = CURR_OB_VELO;
-    } else if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
-      state->curr_bg_path = END_SCREEN;
-      state->button = create_button_from_info(state, play_again_button_info);
-      current_obstacle_velocity = INITIAL_OBSTACLE_VELOCITY;
-      state->on_end_screen = true;
+void remove_off_screen_bodies(state_t *state) {
+  for (size_t i = component_count(state->components, COMPONENT_VELOCITY);
+       i-- > 0;) {
+    entity_t entity = component_entity(state->components, COMPONENT_VELOCITY, i);
+    body_t *body = get_collider(state, entity);
+    if (!body_is_asleep(body)) {
+      // Obstacles span several parts, so wait until the last one is gone
+      vector_t min, max;
+      body_get_bounds(body, &min, &max);
+      if (max.x < OFFSCREEN_OBJ) {
+        recycle_body(state, body);
+      }
     }
   }
 }
 
-typedef void (*obstacle_func_t)(state_t *state, vector_t center);
-
-void add_obstacles_unjumpable_wrapper(state_t *state, vector_t center) {
-  add_obstacles_unjumpable(state, center, BLOCK_W, BLOCK_H);
-}
-
-void add_obstacles_jumpable_wrapper(state_t *state, vector_t center) {
-  add_obstacles_jumpable(state, center, BLOCK_W, BLOCK_H, WALL_DIMENSION);
-}
-
-obstacle_func_t level1_obstacle_functions[] = {add_obstacles_jumpable_wrapper,
-                                               add_obstacles_jumpable_wrapper,
-                                               add_obstacles_jumpable_wrapper,
-                                               add_obstacles_jumpable_wrapper,
-                                               add_obstacles_unjumpable_wrapper,
-                                               add_obstacles_unjumpable_wrapper,
-                                               add_obstacles_unjumpable_wrapper,
-                                               add_obstacles_unjumpable_wrapper,
-                                               double_spike,
-                                               double_spike,
-                                               triple_staircase,
-                                               triple_staircase,
-                                               five_block,
-                                               five_block,
-                                               triple_block,
-                                               triple_block};
-
-obstacle_func_t level2_obstacle_functions[] = {add_obstacles_jumpable_wrapper,
-                                               add_obstacles_jumpable_wrapper,
-                                               add_obstacles_unjumpable_wrapper,
-                                               add_obstacles_unjumpable_wrapper,
-                                               double_spike,
-                                               double_spike,
-                                               double_staircase,
-                                               double_staircase,
-                                               five_block,
-                                               five_block,
-                                               triple_block,
-                                               triple_block,
-                                               triple_spike};
-
-void add_random_obstacles(state_t *state) {
-  size_t num_obstacles;
-  size_t random_index;
-  vector_t obstacle_center = OBSTACLE_C;
-
-  if (strcmp(state->curr_bg_path, LEVEL1) == 0) {
-    num_obstacles = sizeof(level1_obstacle_functions) /
-                    sizeof(level1_obstacle_functions[0]);
-    random_index = rand() % num_obstacles;
-    level1_obstacle_functions[random_index](state, obstacle_center);
-  } else if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
-    num_obstacles = sizeof(level2_obstacle_functions) /
-                    sizeof(level2_obstacle_functions[0]);
-    random_index = rand() % num_obstacles;
-    level2_obstacle_functions[random_index](state, obstacle_center);
+// Loads a compiled level, falling back to its text source
+level_t *load_level(const char *compiled_path, const char *source_path) {
+  level_t *level = level_load(compiled_path, PREFAB_NAMES, PREFAB_SHAPES,
+                              NUM_PREFABS);
+  if (level == NULL) {
+    level = level_load(source_path, PREFAB_NAMES, PREFAB_SHAPES, NUM_PREFABS);
   }
+  return level;
 }
 
-void remove_off_screen_bodies(state_t *state) {
-  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    body_type_t type = get_type(body);
-    if (type == OBSTACLE || type == WALL || type == FLOOR) {
-      if (body_get_centroid(body).x < OFFSCREEN_OBJ) {
-        body_reset(body);
-        scene_remove_body(state->scene, i);
-      }
+// Draws every entity with a sprite whose body is not parked
+void render_sprites(state_t *state) {
+  for (size_t i = 0; i < component_count(state->components, COMPONENT_SPRITE);
+       i++) {
+    entity_t entity = component_entity(state->components, COMPONENT_SPRITE, i);
+    body_t *body = get_collider(state, entity);
+    if (body != NULL && body_is_asleep(body)) {
+      continue;
+    }
+    sprite_component_t *sprite =
+        component_at(state->components, COMPONENT_SPRITE, i);
+    for (size_t j = 0; j < sprite->num_layers; j++) {
+      asset_render(sprite->layers[j]);
     }
   }
 }
 
 bool is_in_contact_with_floor(state_t *state) {
-  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    if (get_type(body) == FLOOR) {
-      if (find_collision(state->dasher, body).collided) {
+  for (size_t i = 0; i < component_count(state->components, COMPONENT_VELOCITY);
+       i++) {
+    entity_t entity = component_entity(state->components, COMPONENT_VELOCITY, i);
+    body_t *body = get_collider(state, entity);
+    if (!body_is_asleep(body)) {
+      if (find_tagged_collision(state->dasher, body, PART_LANDING).collided) {
         if (body_get_velocity(state->dasher).y <= 0) {
           return true;
         }
@@ -673,31 +894,172 @@ bool is_in_contact_with_floor(state_t *state) {
   return false;
 }
 
+// Saves the level as it is now, for practice mode to respawn at
+void take_checkpoint(state_t *state) {
+  checkpoint_t *checkpoint = &state->checkpoint;
+  scene_save(state->scene, checkpoint->scene);
+  checkpoint->rng = state->rng;
+  level_t *level = get_current_level(state);
+  if (level != NULL) {
+    checkpoint->level_position = level_tell(level);
+  }
+  checkpoint->time = state->time;
+  checkpoint->distance = state->distance;
+  checkpoint->obstacle_timer = state->obstacle_timer;
+  checkpoint->coin_timer = state->coin_timer;
+  checkpoint->obstacle_velocity = current_obstacle_velocity;
+  checkpoint->curr_coins = state->curr_coins;
+  checkpoint->is_jumping = state->is_jumping;
+  checkpoint->curr_bg_path = state->curr_bg_path;
+  checkpoint->is_valid = true;
+}
+
+// Checkpoints are taken on the ground so respawning never starts mid-jump
+bool is_checkpoint_due(state_t *state) {
+  if (!state->is_practicing || state->on_start_screen ||
+      state->on_end_screen || state->is_jumping) {
+    return false;
+  }
+  checkpoint_t *checkpoint = &state->checkpoint;
+  return !checkpoint->is_valid ||
+         checkpoint->curr_bg_path != state->curr_bg_path ||
+         state->time - checkpoint->time >= CHECKPOINT_INTERVAL;
+}
+
+// Puts the level back the way it was at the last checkpoint. Returns false,
+// leaving the level as it was, if the checkpoint no longer matches the scene.
+bool restore_checkpoint(state_t *state) {
+  checkpoint_t *checkpoint = &state->checkpoint;
+  if (!scene_restore(state->scene, checkpoint->scene)) {
+    return false;
+  }
+
+  // Everything spawned since the checkpoint is new, so it goes back to sleep.
+  // Bodies that were parked at the checkpoint are parked again.
+  for (size_t i = scene_snapshot_bodies(checkpoint->scene);
+       i < scene_bodies(state->scene); i++) {
+    body_t *body = scene_get_body(state->scene, i);
+    body_reset(body);
+    body_set_asleep(body, true);
+  }
+  for (size_t i = 0; i < NUM_PREFABS; i++) {
+    while (list_size(state->pools[i]) > 0) {
+      list_remove(state->pools[i], list_size(state->pools[i]) - 1);
+    }
+  }
+  for (size_t i = 0; i < component_count(state->components, COMPONENT_VELOCITY);
+       i++) {
+    entity_t entity = component_entity(state->components, COMPONENT_VELOCITY, i);
+    body_t *body = get_collider(state, entity);
+    prefab_kind_t prefab = get_tag(state, body)->variant;
+    if (body_is_asleep(body) && prefab != NUM_PREFABS) {
+      list_add(state->pools[prefab], body);
+    }
+  }
+
+  state->rng = checkpoint->rng;
+  state->time = checkpoint->time;
+  state->distance = checkpoint->distance;
+  state->obstacle_timer = checkpoint->obstacle_timer;
+  state->coin_timer = checkpoint->coin_timer;
+  current_obstacle_velocity = checkpoint->obstacle_velocity;
+  state->curr_coins = checkpoint->curr_coins;
+  state->is_jumping = checkpoint->is_jumping;
+  if (state->curr_bg_path != checkpoint->curr_bg_path) {
+    state->curr_bg_path = checkpoint->curr_bg_path;
+    set_level_background(state, state->curr_bg_path);
+  }
+  level_t *level = get_current_level(state);
+  if (level != NULL) {
+    level_seek(level, checkpoint->level_position);
+  }
+  return true;
+}
+
 state_t *emscripten_init() {
-  asset_cache_init();
+  // The window comes up first so it appears while assets load
   sdl_init(MIN, MAX);
+  startup_begin(STARTUP_ASSET_PRELOAD);
+  asset_pack_open(ASSET_PACK);
+  asset_cache_init();
+  ui_init(MAX.x, MAX.y);
   state_t *state = malloc(sizeof(state_t));
   assert(state);
   state->scene = scene_init();
   assert(state->scene);
   state->is_jumping = false;
   state->curr_coins = 0;
-  state->body_assets = list_init(5, (free_func_t)asset_destroy);
+  state->components = component_store_init();
   state->attempts = 1;
-  state->end_screen_attempts = NULL;
+  state->level_title = NULL;
   state->on_start_screen = true;
   state->on_end_screen = false;
   state->curr_bg_path = START_SCREEN;
   state->time = 0;
   state->curr_coins = 0;
+  state->distance = 0;
+  state->levels[0] = load_level(LEVEL1_FILE, LEVEL1_SOURCE);
+  state->levels[1] = load_level(LEVEL2_FILE, LEVEL2_SOURCE);
+  for (size_t i = 0; i < NUM_PREFABS; i++) {
+    state->pools[i] = list_init(INITIAL_POOL_CAPACITY, NULL);
+  }
+  state->obstacle_timer = 0;
+  state->coin_timer = 0;
+  current_obstacle_velocity = SPAWN_TABLES[0].velocity;
+  state->is_practicing = false;
+  state->respawn_pending = false;
+  state->checkpoint.is_valid = false;
+  state->checkpoint.scene = scene_snapshot_init();
+  state->practice_label = NULL;
+  state->tick = 0;
+  state->unsimulated_time = 0;
+  state->shown_screen = SCREEN_START;
+  state->is_idle = false;
+
+  // A playback reuses the seed of its recording; otherwise every run differs
+  uint64_t seed = (uint64_t)time(NULL);
+  const char *replay_path = getenv(REPLAY_ENV);
+  state->playback = replay_path != NULL ? replay_open(replay_path) : NULL;
+  if (state->playback != NULL) {
+    seed = replay_seed(state->playback);
+  }
+  const char *record_path = getenv(RECORD_ENV);
+  state->recording = NULL;
+  if (record_path != NULL && state->playback == NULL) {
+    state->recording = replay_record(record_path, seed);
+    if (state->recording == NULL) {
+      fprintf(stderr, "Couldn't open %s for recording\n", record_path);
+    }
+  }
+  rng_seed(&state->rng, seed);
+
+  const char *counters_path = getenv(COUNTERS_ENV);
+  state->counters_log = NULL;
+  if (counters_path != NULL) {
+    state->counters_log = fopen(counters_path, "w");
+    if (state->counters_log == NULL) {
+      fprintf(stderr, "Couldn't open %s for counters\n", counters_path);
+    }
+    counters_log_csv(state->counters_log);
+  }
 
-  // Render start screen
+  // The start screen is drawn by the first frame
   asset_t *start_background = get_background(START_SCREEN);
   state->curr_bg = start_background;
-  asset_render(state->curr_bg);
+  state->curr_bg_asset_path = START_SCREEN;
 
-  // Create play button
-  state->button = create_button_from_info(state, play_button_info);
+  // Create the buttons for the start and end screens
+  state->ui_assets = list_init(4, (free_func_t)asset_destroy);
+  state->play_button =
+      create_button_from_info(state, play_button_info, SCREEN_START);
+  state->play_again_button =
+      create_button_from_info(state, play_again_button_info, SCREEN_END);
+  ui_set_screen(SCREEN_START);
+
+  // Kept for the whole run so respawning does not allocate
+  SDL_Rect death_box = {0, MAX.y - 175, 200, 200};
+  state->death_effect = asset_make_image(DETH_EFFECT, death_box);
+  state->death_effect_until = 0;
 
   body_t *temp = background_helper(state, (vector_t){MAX.x / 2, MAX.y / 2},
                                    MAX.x, MAX.y, black, LEVEL1);
@@ -717,46 +1079,59 @@ state_t *emscripten_init() {
                         MAX.x, BG_HEIGHT, black, FRONTBACK_IMAGE);
   state->lower_background = temp4;
 
-  body_t *dash = make_dasher(dasher_center);
-
+  body_t *dash = make_dasher(state, dasher_center);
   body_set_centroid(dash, dasher_center);
-  scene_add_body(state->scene, dash);
-  asset_t *dash_asset = asset_make_image_with_body(DASHER_IMAGE, dash);
-  list_add(state->body_assets, dash_asset);
   state->dasher = dash;
 
+  // The HUDs only re-rasterize text when a bound value changes
+  state->game_hud = hud_init(MAX.x, MAX.y);
+  hud_add_label(state->game_hud, FONT, ATTEMPS_TEXT_LOC, "Attempts:");
+  hud_add_number(state->game_hud, FONT, ATTEMPTS_LOC1, &state->attempts,
+                 COUNTER_FORMAT);
+  hud_add_label(state->game_hud, FONT, COINS_TEXT_LOC, "Coins:");
+  hud_add_number(state->game_hud, FONT, COINS_LOC, &state->curr_coins,
+                 COUNTER_FORMAT);
+  hud_add_text(state->game_hud, FONT, LEVEL_TITLE_LOC, &state->level_title);
+  hud_add_text(state->game_hud, FONT, PRACTICE_LOC, &state->practice_label);
+
+  state->end_hud = hud_init(MAX.x, MAX.y);
+  hud_add_label(state->end_hud, FONT, ATTEMPS_TEXT_LOC2, "Attempts:");
+  hud_add_number(state->end_hud, FONT, ATTEMPTS_LOC2, &state->attempts,
+                 COUNTER_FORMAT);
+  hud_add_label(state->end_hud, FONT, COINS_TEXT_LOC2, "Coins:");
+  hud_add_number(state->end_hud, FONT, COINS_LOC2, &state->curr_coins,
+                 COUNTER_FORMAT);
+
+  state->perf_overlay = perf_overlay_init(FONT);
+
   sdl_on_key((key_handler_t)on_key);
+  sdl_on_click((click_handler_t)on_click);
+  sdl_on_render_reset((render_reset_handler_t)on_render_reset);
+
+#ifdef HEADLESS
+  // There is no play button to click, unless a recording clicks it
+  if (state->playback == NULL) {
+    play(state);
+  }
+#endif
+  startup_end(STARTUP_ASSET_PRELOAD);
   return state;
 }
 
-bool emscripten_main(state_t *state) {
-  double dt = time_since_last_tick();
-  sdl_clear();
+// Advances the game by one fixed step
+void game_step(state_t *state, double dt) {
+  PROFILE_ZONE("game_step");
   if (!state->on_start_screen && !state->on_end_screen) {
     state->time += dt;
 
-    static double obstacle_timer = 0;
-    obstacle_timer += dt;
-    static double coin_timer = 0;
-    coin_timer += dt;
-    if (coin_timer >= 5.0) {
-      double random_double =
-          MIN_COIN + (double)rand() / RAND_MAX * (MAX_COIN - MIN_COIN);
-      add_coin(state, (vector_t){COIN_SPAWN_X, random_double}, 30, 30);
-      coin_timer = 0;
-    }
-
-    double obstacle_interval;
-    if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
-      obstacle_interval = 1.5;
+    level_t *level = get_current_level(state);
+    if (level != NULL) {
+      double horizon = state->distance + MAX.x + SPAWN_LOOKAHEAD;
+      level_spawn(level, horizon, spawn_prefab, state);
     } else {
-      obstacle_interval = 2.0;
-    }
-
-    if (obstacle_timer >= obstacle_interval) {
-      add_random_obstacles(state);
-      obstacle_timer = 0;
+      spawn_random(state, dt);
     }
+    state->distance -= current_obstacle_velocity * dt;
   }
 
   remove_off_screen_bodies(state);
@@ -771,112 +1146,192 @@ bool emscripten_main(state_t *state) {
     body_set_velocity(state->dasher, velocity);
   }
 
-  asset_t *screen = asset_make_image(state->curr_bg_path, bg1_rect);
-  asset_render(screen);
-
-  state->curr_bg = asset_make_image(state->curr_bg_path, bg1_rect);
-  if (state->on_start_screen) {
-    asset_render(state->button);
-  } else if (!state->on_start_screen && !state->on_end_screen) {
-    for (size_t i = 0; i < list_size(state->body_assets); i++) {
-      asset_t *asset = list_get(state->body_assets, i);
-      body_t *body = asset_to_body(asset);
-      if (body_is_removed(body)) {
-        list_remove(state->body_assets, i);
-        i--;
-      } else {
-        asset_render(list_get(state->body_assets, i));
-      }
-    }
+  if (state->on_end_screen) {
+    remove_all_obstacles(state);
+    audio_stop_music();
+  }
 
-    char *attempts_txt = malloc(sizeof(char) * (NUM_ATTEMPTS + 1));
-    assert(attempts_txt);
-    snprintf(attempts_txt, NUM_ATTEMPTS + 1, "%3lld", state->attempts);
-    asset_t *attempts_txt_asset =
-        asset_make_text(FONT, ATTEMPTS_LOC1, attempts_txt, WHITE);
+  scene_tick(state->scene, dt);
+  off_floor(state);
 
-    asset_render(attempts_txt_asset);
+  if (state->respawn_pending) {
+    state->respawn_pending = false;
+    if (restore_checkpoint(state)) {
+      audio_play_effect(DEATH_SOUND);
+      state->death_effect_until = state->tick + DEATH_EFFECT_TICKS;
+      state->attempts++;
+    } else {
+      // Something the checkpoint saved is gone, so die the normal way
+      state->checkpoint.is_valid = false;
+      reset_game(state->dasher, NULL, VEC_ZERO, state, 0);
+    }
+  } else if (is_checkpoint_due(state)) {
+    take_checkpoint(state);
+  }
+}
 
-    asset_t *attempts_context =
-        asset_make_text(FONT, ATTEMPS_TEXT_LOC, "Attempts:", WHITE);
+// Draws the current state without changing it
+void game_render(state_t *state) {
+  PROFILE_ZONE("game_render");
+  sdl_clear();
+  if (state->curr_bg_asset_path != state->curr_bg_path) {
+    asset_destroy(state->curr_bg);
+    state->curr_bg = asset_make_image(state->curr_bg_path, bg1_rect);
+    state->curr_bg_asset_path = state->curr_bg_path;
+  }
+  asset_render(state->curr_bg);
 
-    asset_render(attempts_context);
+  if (state->on_start_screen) {
+    asset_render(state->play_button);
+  } else if (!state->on_start_screen && !state->on_end_screen) {
+    render_sprites(state);
 
-    char *coins_txt = malloc(sizeof(char) * (NUM_ATTEMPTS + 1));
-    assert(coins_txt);
-    snprintf(coins_txt, NUM_ATTEMPTS + 1, "%3lld", state->curr_coins);
-    asset_t *coins_txt_asset =
-        asset_make_text(FONT, COINS_LOC, coins_txt, WHITE);
+    state->level_title = get_level_title(state->curr_bg_path);
+    hud_render(state->game_hud, 0, 0);
+    if (state->tick < state->death_effect_until) {
+      asset_render(state->death_effect);
+    }
+  } else {
+    hud_render(state->end_hud, 0, 0);
+    asset_render(state->play_again_button);
+  }
+}
 
-    asset_render(coins_txt_asset);
+double emscripten_step(state_t *state) {
+  if (state->playback != NULL) {
+    play_back_inputs(state);
+    if (replay_is_done(state->playback)) {
+      return 0;
+    }
+  }
+  game_step(state, FIXED_DT);
+  state->tick++;
+  return FIXED_DT;
+}
 
-    asset_t *coins_context =
-        asset_make_text(FONT, COINS_TEXT_LOC, "Coins:", WHITE);
-    asset_render(coins_context);
+void emscripten_render(state_t *state) { game_render(state); }
 
-    if (strcmp(state->curr_bg_path, LEVEL1) == 0) {
-      asset_t *level_title_asset =
-          asset_make_text(FONT, LEVEL_TITLE_LOC, "Level1", WHITE);
-      asset_render(level_title_asset);
+// Whether the next frame could look different from the last one presented.
+// Gameplay moves every frame, but the start and end screens only change on
+// input, or when the screen, background or end HUD's values change.
+static bool is_frame_damaged(state_t *state) {
+  if (!state->on_start_screen && !state->on_end_screen) {
+    return true;
+  }
+  return sdl_is_damaged() || perf_overlay_is_shown(state->perf_overlay) ||
+         ui_get_screen() != state->shown_screen ||
+         state->curr_bg_path != state->curr_bg_asset_path ||
+         (state->on_end_screen && hud_is_dirty(state->end_hud));
+}
 
-      asset_destroy(level_title_asset);
-    } else if (strcmp(state->curr_bg_path, LEVEL2) == 0) {
-      asset_t *level_title_asset =
-          asset_make_text(FONT, LEVEL_TITLE_LOC, "Level2", WHITE);
-      asset_render(level_title_asset);
+bool emscripten_is_idle(state_t *state) { return state->is_idle; }
 
-      asset_destroy(level_title_asset);
+bool emscripten_main(state_t *state) {
+  PROFILE_ZONE("frame");
+  perf_overlay_t *overlay = state->perf_overlay;
+  perf_overlay_begin_phase(overlay, PERF_SIM);
+  state->unsimulated_time += fmin(time_since_last_tick(), MAX_FRAME_TIME);
+  while (state->unsimulated_time >= FIXED_DT) {
+    if (emscripten_step(state) == 0) {
+      // Quit through SDL so the run ends the same way as a closed window
+      printf("Replay finished at tick %llu\n",
+             (unsigned long long)state->tick);
+      SDL_Event quit = {.type = SDL_QUIT};
+      SDL_PushEvent(&quit);
+      break;
     }
-
-    free(coins_txt);
-    asset_destroy(coins_txt_asset);
-    asset_destroy(coins_context);
-    free(attempts_txt);
-    asset_destroy(attempts_txt_asset);
-    asset_destroy(attempts_context);
-  } else {
-    remove_all_obstacles(state);
-    char *attempts_txt = malloc(sizeof(char) * (NUM_ATTEMPTS + 1));
-    assert(attempts_txt);
-    snprintf(attempts_txt, NUM_ATTEMPTS + 1, "%3lld", state->attempts);
-    asset_t *attempts_txt_asset =
-        asset_make_text(FONT, ATTEMPTS_LOC2, attempts_txt, WHITE);
-    asset_render(attempts_txt_asset);
-
-    asset_t *attempts_context =
-        asset_make_text(FONT, ATTEMPS_TEXT_LOC2, "Attempts:", WHITE);
-    asset_render(attempts_context);
-
-    char *coins_txt = malloc(sizeof(char) * (NUM_ATTEMPTS + 1));
-    assert(coins_txt);
-    snprintf(coins_txt, NUM_ATTEMPTS + 1, "%3lld", state->curr_coins);
-    asset_t *coins_txt_asset =
-        asset_make_text(FONT, COINS_LOC2, coins_txt, WHITE);
-    asset_render(coins_txt_asset);
-
-    asset_t *coins_context =
-        asset_make_text(FONT, COINS_TEXT_LOC2, "Coins:", WHITE);
-    asset_render(coins_context);
-    free(coins_txt);
-    asset_destroy(coins_txt_asset);
-    asset_destroy(coins_context);
-    free(attempts_txt);
-    asset_destroy(attempts_txt_asset);
-    asset_destroy(attempts_context);
-    asset_render(state->button);
-    stop_music();
+    state->unsimulated_time -= FIXED_DT;
   }
+  perf_overlay_end_phase(overlay, PERF_SIM);
 
-  scene_tick(state->scene, dt);
-  off_floor(state);
-  sdl_show();
+  // The window keeps showing the last frame presented until another is
+  state->is_idle = !is_frame_damaged(state);
+  bool is_first_frame = !state->is_idle && startup_time_to_first_frame() == 0;
+  if (is_first_frame) {
+    startup_begin(STARTUP_FIRST_FRAME);
+  }
+  if (!state->is_idle) {
+    perf_overlay_begin_phase(overlay, PERF_RENDER);
+    emscripten_render(state);
+    perf_overlay_render(overlay, PERF_OVERLAY_LOC.x, PERF_OVERLAY_LOC.y);
+    perf_overlay_end_phase(overlay, PERF_RENDER);
+
+    perf_overlay_begin_phase(overlay, PERF_PRESENT);
+    sdl_show();
+    perf_overlay_end_phase(overlay, PERF_PRESENT);
+    state->shown_screen = ui_get_screen();
+  }
+  if (is_first_frame) {
+    startup_end(STARTUP_FIRST_FRAME);
+    startup_report(stdout);
+    // Nothing plays until the game starts, so the audio device is opened
+    // after the start screen is up rather than before
+    audio_init();
+  }
+  perf_overlay_end_frame(overlay, state->scene);
+  counters_end_frame();
+#ifdef ALLOC_TRACK
+  alloc_track_end_frame();
+#endif
   return false;
 }
 
 void emscripten_free(state_t *state) {
-  TTF_Quit();
+#ifdef PROFILE
+  const char *profile_path = getenv(PROFILE_ENV);
+  if (profile_path == NULL) {
+    profile_path = DEFAULT_PROFILE_PATH;
+  }
+  if (profiler_dump(profile_path)) {
+    printf("Wrote profile to %s\n", profile_path);
+  } else {
+    fprintf(stderr, "Couldn't write profile to %s\n", profile_path);
+  }
+#endif
+  if (state->recording != NULL) {
+    replay_close(state->recording, state->tick);
+  }
+  if (state->playback != NULL) {
+    replay_close(state->playback, state->tick);
+  }
+  if (state->counters_log != NULL) {
+    counters_log_csv(NULL);
+    fclose(state->counters_log);
+  }
+  // Pooled bodies are still in the scene, so the pools do not free them
+  for (size_t i = 0; i < NUM_PREFABS; i++) {
+    list_free(state->pools[i]);
+  }
   scene_free(state->scene);
-  list_free(state->body_assets);
+  scene_snapshot_free(state->checkpoint.scene);
+  for (size_t i = 0; i < component_count(state->components, COMPONENT_SPRITE);
+       i++) {
+    sprite_component_t *sprite =
+        component_at(state->components, COMPONENT_SPRITE, i);
+    for (size_t j = 0; j < sprite->num_layers; j++) {
+      asset_destroy(sprite->layers[j]);
+    }
+  }
+  component_store_free(state->components);
+  asset_destroy(state->curr_bg);
+  asset_destroy(state->death_effect);
+  hud_free(state->game_hud);
+  hud_free(state->end_hud);
+  perf_overlay_free(state->perf_overlay);
+  for (size_t i = 0; i < NUM_LEVELS; i++) {
+    if (state->levels[i] != NULL) {
+      level_free(state->levels[i]);
+    }
+  }
+  ui_destroy();
+  list_free(state->ui_assets);
   asset_cache_destroy();
+  audio_quit();
+  asset_pack_close();
+  TTF_Quit();
   free(state);
+#ifdef ALLOC_TRACK
+  // Everything has been freed, so whatever is still live leaked
+  alloc_track_report(stderr);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef __ALLOC_TRACK_H__
+#define __ALLOC_TRACK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Opt-in accounting of heap allocations by subsystem.
+ *
+ * Build with -DALLOC_TRACK to enable it. Each file that allocates names its
+ * subsystem and includes this header after its other includes:
+ *
+ *   #define ALLOC_SUBSYSTEM ALLOC_BODY
+ *   #include "alloc_track.h"
+ *
+ * With ALLOC_TRACK defined, malloc, calloc, realloc, strdup and free in that
+ * file are redirected to the tracking versions below. Without it the header
+ * changes nothing.
+ *
+ * Every live allocation is kept in a table, so memory from untracked code
+ * (SDL, or files that do not include this header) can still be freed by
+ * tracked code and the other way around. Such allocations are simply not
+ * counted.
+ */
+typedef enum {
+  ALLOC_LIST,
+  ALLOC_BODY,
+  ALLOC_POLYGON,
+  ALLOC_COLLISION,
+  ALLOC_ASSET,
+  ALLOC_RENDER,
+  ALLOC_GAME,
+  ALLOC_OTHER,
+  NUM_ALLOC_SUBSYSTEMS,
+} alloc_subsystem_t;
+
+typedef struct {
+  /** Allocations, frees and bytes allocated since the last frame ended */
+  size_t frame_allocs;
+  size_t frame_frees;
+  size_t frame_bytes;
+  /** The most allocations made in a single frame */
+  size_t peak_frame_allocs;
+  /** Blocks and bytes allocated and not yet freed */
+  size_t live_blocks;
+  size_t live_bytes;
+  /** The most bytes that have been live at once */
+  size_t peak_live_bytes;
+  /** Allocations and frees over the whole run */
+  size_t total_allocs;
+  size_t total_frees;
+} alloc_stats_t;
+
+#if defined(ALLOC_TRACK) && !defined(ALLOC_TRACK_IMPL)
+#ifndef ALLOC_SUBSYSTEM
+#define ALLOC_SUBSYSTEM ALLOC_OTHER
+#endif
+#define malloc(size) alloc_track_malloc(size, ALLOC_SUBSYSTEM)
+#define calloc(count, size) alloc_track_calloc(count, size, ALLOC_SUBSYSTEM)
+#define realloc(ptr, size) alloc_track_realloc(ptr, size, ALLOC_SUBSYSTEM)
+#define strdup(str) alloc_track_strdup(str, ALLOC_SUBSYSTEM)
+// Not function-like, so free passed as a free_func_t is tracked too
+#define free alloc_track_free
+#endif
+
+void *alloc_track_malloc(size_t size, alloc_subsystem_t subsystem);
+void *alloc_track_calloc(size_t count, size_t size,
+                         alloc_subsystem_t subsystem);
+void *alloc_track_realloc(void *ptr, size_t size, alloc_subsystem_t subsystem);
+char *alloc_track_strdup(const char *str, alloc_subsystem_t subsystem);
+void alloc_track_free(void *ptr);
+
+/**
+ * Marks the end of a frame: per-frame counts are folded into the peaks and
+ * reset, and the frame is counted as allocation-free if nothing allocated.
+ */
+void alloc_track_end_frame(void);
+
+/**
+ * Gets the counters of one subsystem.
+ *
+ * @param subsystem the subsystem to get
+ * @return a copy of its counters
+ */
+alloc_stats_t alloc_track_stats(alloc_subsystem_t subsystem);
+
+/**
+ * Gets the name of a subsystem, for reports.
+ *
+ * @param subsystem the subsystem to name
+ * @return its name, e.g. "body"
+ */
+const char *alloc_track_name(alloc_subsystem_t subsystem);
+
+/**
+ * Writes the counters of every subsystem, how many frames allocated nothing,
+ * and the allocations that are still live (the leaks, when called on exit).
+ *
+ * @param file where to write the report
+ */
+void alloc_track_report(FILE *file);
+
+#endif // #ifndef __ALLOC_TRACK_H__
@@ -9,7 +9,13 @@
 #include <color.h>
 #include <stddef.h>
 
-typedef enum { ASSET_IMAGE, ASSET_FONT, ASSET_BUTTON } asset_type_t;
+typedef enum {
+  ASSET_IMAGE,
+  ASSET_FONT,
+  ASSET_BUTTON,
+  ASSET_MUSIC,
+  ASSET_SOUND
+} asset_type_t;
 
 typedef struct asset asset_t;
 
@@ -20,6 +26,14 @@ typedef struct asset asset_t;
  */
 asset_type_t asset_get_type(asset_t *asset);
 
+/**
+ * Gets the bounding box the asset was created with. For a button, this is the
+ * area on the screen that activates its handler.
+ *
+ * @return the bounding box of the asset.
+ */
+SDL_Rect asset_get_bounding_box(asset_t *asset);
+
 /**
  * Allocates memory for an image asset with the given parameters.
  *
@@ -68,10 +82,9 @@ asset_t *asset_make_button(SDL_Rect bounding_box, asset_t *image_asset,
                            asset_t *text_asset, button_handler_t handler);
 
 /**
- * Runs the button handler for `button` if
- *
- * 1. `x` and `y` are contained in the button's bounding box.
- * 2. AND `button` is currently rendered onto the screen.
+ * Runs the button handler for `button` if `x` and `y` are contained in the
+ * button's bounding box. Whether the button is on screen is decided by the
+ * UI layer (see ui.h), which only dispatches clicks to the current screen.
  *
  * @param button the pointer to the button asset
  * @param state the game state
@@ -111,6 +124,18 @@ void asset_destroy(asset_t *asset);
  */
 asset_t *asset_make_image_with_body(const char *filepath, body_t *body);
 
+/**
+ * Allocates memory for an image asset that is drawn over every part of a
+ * compound body with a given tag. See body_add_part().
+ *
+ * @param filepath the filepath to the image file
+ * @param body the compound body that the image asset will be associated with
+ * @param tag the tag of the parts to draw the image on
+ * @return a pointer to the newly allocated image asset
+ */
+asset_t *asset_make_image_with_part(const char *filepath, body_t *body,
+                                    size_t tag);
+
 /**
  * Retrieves the body associated with an image asset.
  *
@@ -29,6 +29,9 @@ void asset_cache_destroy();
  *
  * char *font_path = "assets/font.ttf";
  * TTF_Font *obj = asset_cache_obj_get_or_create(ASSET_FONT, font_path);
+ *
+ * char *song_path = "assets/song.ogg";
+ * Mix_Music *obj = asset_cache_obj_get_or_create(ASSET_MUSIC, song_path);
  * ```
  *
  * @param ty the type of the asset
@@ -37,6 +40,19 @@ void asset_cache_destroy();
  */
 void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath);
 
+/**
+ * Like `asset_cache_obj_get_or_create` for an ASSET_IMAGE, but the texture is
+ * resampled to the size it is drawn at when it is first loaded. The same
+ * image drawn at two different sizes gets two cache entries.
+ *
+ * @param filepath the filepath to the image
+ * @param width the width the image is drawn at, or 0 for its full width
+ * @param height the height the image is drawn at, or 0 for its full height
+ * @return the SDL_Texture that corresponds to the filepath and size, as a void*
+ */
+void *asset_cache_image_get_or_create(const char *filepath, int width,
+                                      int height);
+
 /**
  * Checks whether an asset with the particular filepath already exists in the
  * ASSET_CACHE list. If exists, returns the entry object. If it doesn't, returns
@@ -50,24 +66,4 @@ void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath);
  */
 void *entry_checker(asset_type_t t, const char *filepath);
 
-/**
- * Registers the button to the asset cache, effectively activating its button
- * handler. When this function is called, the asset_cache takes ownership of the
- * button so the caller does NOT have to free it.
- *
- * Asserts that the type of `button` is ASSET_BUTTON.
- *
- * @param button pointer to the button asset
- */
-void asset_cache_register_button(asset_t *button);
-
-/**
- * Runs `asset_on_button_click` on all the buttons stored in the asset cache.
- *
- * @param state the game state
- * @param x the x position of the mouse click
- * @param y the y position of the mouse click
- */
-void asset_cache_handle_buttons(state_t *state, double x, double y);
-
 #endif // #ifndef __ASSET_CACHE_H__
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef __ASSET_PACK_H__
+#define __ASSET_PACK_H__
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * On-disk layout of an asset archive:
+ *
+ *   pack_header_t
+ *   pack_entry_t[num_entries]   (sorted by name)
+ *   asset data                  (each blob aligned to PACK_ALIGNMENT)
+ *
+ * All integers are little-endian. Archives are built from an assets directory
+ * with the `pack_assets` tool.
+ */
+#define PACK_MAGIC "GDPK"
+#define PACK_VERSION 1
+#define PACK_NAME_LEN 56
+#define PACK_ALIGNMENT 16
+
+typedef enum {
+  PACK_OTHER,
+  PACK_IMAGE,
+  PACK_FONT,
+  PACK_AUDIO
+} pack_type_t;
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_entries;
+  uint32_t reserved;
+} pack_header_t;
+
+typedef struct {
+  /** The path the game loads the asset by, e.g. "assets/coin.png" */
+  char name[PACK_NAME_LEN];
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+} pack_entry_t;
+
+/**
+ * Memory-maps the global asset archive. Assets found in the archive are then
+ * loaded straight from the mapping by the asset cache instead of from loose
+ * files. Any previously opened archive is closed first.
+ *
+ * @param path the filepath to the archive
+ * @return true if the archive was mapped, false if it is missing or invalid
+ */
+bool asset_pack_open(const char *path);
+
+/**
+ * Unmaps the global asset archive. Anything still reading from the archive
+ * (e.g. streamed music) must be freed before this is called.
+ */
+void asset_pack_close(void);
+
+/**
+ * Looks up an asset in the archive with a binary search over the index.
+ *
+ * @param name the path the asset is loaded by
+ * @param size set to the size of the asset in bytes if it is found
+ * @return a pointer to the asset's bytes inside the mapping, or NULL if there
+ * is no open archive or it does not contain the asset
+ */
+const void *asset_pack_find(const char *name, size_t *size);
+
+/**
+ * Wraps an archived asset in a read-only SDL_RWops without copying it.
+ * The caller owns the returned SDL_RWops.
+ *
+ * @param name the path the asset is loaded by
+ * @return an SDL_RWops over the asset's bytes, or NULL if it is not archived
+ */
+SDL_RWops *asset_pack_open_rw(const char *name);
+
+#endif // #ifndef __ASSET_PACK_H__
@@ -0,0 +1,50 @@
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include <stdbool.h>
+
+/**
+ * Opens the audio device. Only the first call does any work, so it is safe to
+ * call this before every sound.
+ */
+void audio_init(void);
+
+/**
+ * Closes the audio device. Music and sound effects are owned by the asset
+ * cache, so `asset_cache_destroy` should be called before this.
+ */
+void audio_quit(void);
+
+/**
+ * Plays a music track on loop. The track is decoded from the asset cache, so
+ * it is only loaded from disk the first time it is played. Compressed formats
+ * (.ogg, .mp3) are streamed rather than held fully decoded in memory.
+ *
+ * If the track is already the current one and is still playing, it is rewound
+ * to the start instead of being reloaded.
+ *
+ * @param filepath the filepath to the music file
+ */
+void audio_play_music(const char *filepath);
+
+/**
+ * Restarts the current music track from the beginning by seeking, without
+ * reopening or reallocating anything. Does nothing if no track has been played.
+ */
+void audio_restart_music(void);
+
+/**
+ * Halts the current music track. It can be resumed from the start with
+ * `audio_restart_music`.
+ */
+void audio_stop_music(void);
+
+/**
+ * Plays a short sound effect once. The sound is loaded into the asset cache
+ * the first time it is played.
+ *
+ * @param filepath the filepath to the sound file
+ */
+void audio_play_effect(const char *filepath);
+
+#endif // #ifndef __AUDIO_H__
@@ -0,0 +1,111 @@
+/** Common functions for benchmarks. */
+
+#ifndef __BENCH_UTIL_H__
+#define __BENCH_UTIL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Runs `iterations` iterations of the code being measured.
+ * Whatever an iteration computes should be passed to bench_consume() so the
+ * compiler cannot skip it.
+ */
+typedef void (*bench_func_t)(void *aux, size_t iterations);
+
+typedef struct {
+  /** Untimed run before measuring, to warm caches and the branch predictor */
+  double warmup_time;
+  /** How long each timed repetition should take at least */
+  double min_repetition_time;
+  /** How many timed repetitions the statistics are taken over */
+  size_t repetitions;
+} bench_options_t;
+
+/** 50 ms of warmup, then 21 repetitions of at least 2 ms each */
+extern const bench_options_t BENCH_DEFAULT_OPTIONS;
+
+typedef struct {
+  const char *name;
+  /** The number of iterations timed together in each repetition */
+  size_t iterations;
+  size_t repetitions;
+  /** Statistics of the time per iteration over the repetitions */
+  double median_ns;
+  /** The median absolute deviation from the median */
+  double mad_ns;
+  double min_ns;
+  double max_ns;
+} bench_result_t;
+
+typedef enum {
+  /** An aligned table for people */
+  BENCH_TEXT,
+  /** One JSON object per line, for scripts comparing runs */
+  BENCH_JSON,
+} bench_format_t;
+
+/**
+ * Measures a function. The number of iterations per repetition is doubled
+ * until a repetition takes min_repetition_time, then the function is run for
+ * warmup_time, then each repetition is timed.
+ *
+ * @param name the name to report the benchmark under; must outlive the result
+ * @param func the code to measure
+ * @param aux an auxiliary value to pass to func
+ * @param options how long to warm up and measure for
+ * @return statistics of the time one iteration takes
+ */
+bench_result_t bench_run(const char *name, bench_func_t func, void *aux,
+                         const bench_options_t *options);
+
+/**
+ * Writes a result as a table row or a JSON line.
+ *
+ * @param file where to write the result
+ * @param result a result returned from bench_run()
+ * @param format how to write it
+ */
+void bench_print(FILE *file, const bench_result_t *result,
+                 bench_format_t format);
+
+/**
+ * Writes the header of the table BENCH_TEXT rows are printed under.
+ * Does nothing for BENCH_JSON.
+ *
+ * @param file where to write the header
+ * @param format the format the results will be printed in
+ */
+void bench_print_header(FILE *file, bench_format_t format);
+
+/**
+ * Marks a value as used, so the code computing it cannot be optimized away.
+ *
+ * @param value a pointer to the value
+ * @param size the size of the value in bytes
+ */
+void bench_consume(const void *value, size_t size);
+
+/**
+ * Orders doubles from smallest to largest, for qsort().
+ *
+ * @param a a pointer to a double
+ * @param b a pointer to another double
+ * @return negative, zero or positive as *a is less than, equal to or greater
+ *   than *b
+ */
+int bench_compare_doubles(const void *a, const void *b);
+
+/**
+ * Returns whether `name` should run given the benchmark filter from the
+ * command line: every benchmark runs with no filter, otherwise only those
+ * whose names contain it.
+ *
+ * @param name the name of a benchmark
+ * @param filter a substring to match, or NULL
+ * @return whether to run the benchmark
+ */
+bool bench_matches(const char *name, const char *filter);
+
+#endif // #ifndef __BENCH_UTIL_H__
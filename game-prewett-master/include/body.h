@@ -187,6 +187,95 @@ void body_add_impulse(body_t *body, vector_t impulse);
  */
 void body_reset(body_t *body);
 
+/**
+ * Adds a part to a body, making it a compound body.
+ * Parts are extra convex shapes that move and rotate with the body, so a
+ * prefab made of several pieces can be a single body. Each part has a tag,
+ * e.g. to tell collision handlers which piece of the body was hit.
+ * The body's own shape is still used for its centroid and mass.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param shape a list of vectors describing the part in world coordinates.
+ *   The body takes ownership of the list.
+ * @param tag the tag of the part
+ */
+void body_add_part(body_t *body, list_t *shape, size_t tag);
+
+/**
+ * Gets the number of parts added to a body with body_add_part().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the number of parts
+ */
+size_t body_num_parts(body_t *body);
+
+/**
+ * Gets the tag of one of a body's parts.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param part the index of the part
+ * @return the tag the part was added with
+ */
+size_t body_get_part_tag(body_t *body, size_t part);
+
+/**
+ * Gets the polygon of one of a body's parts.
+ * The polygon is owned by the body and must not be freed.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param part the index of the part
+ * @return the polygon describing the part's current position
+ */
+polygon_t *body_get_part_polygon(body_t *body, size_t part);
+
+/**
+ * Computes the axis-aligned bounding box of a body and all of its parts.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param min set to the bottom-left corner of the box
+ * @param max set to the top-right corner of the box
+ */
+void body_get_bounds(body_t *body, vector_t *min, vector_t *max);
+
+/**
+ * Computes the axis-aligned bounding box of one of a body's parts.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param part the index of the part
+ * @param min set to the bottom-left corner of the box
+ * @param max set to the top-right corner of the box
+ */
+void body_get_part_bounds(body_t *body, size_t part, vector_t *min,
+                          vector_t *max);
+
+/**
+ * Gets the number of bytes body_save_state() writes for a body.
+ * This only changes when parts are added.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the size of the body's state
+ */
+size_t body_state_size(body_t *body);
+
+/**
+ * Copies everything about a body that changes as it moves: the points of its
+ * shape and parts, its velocity, pending forces and impulses, and whether it
+ * is removed or asleep.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param buffer where to write body_state_size() bytes, aligned for a double
+ */
+void body_save_state(body_t *body, void *buffer);
+
+/**
+ * Puts a body back in a state saved by body_save_state().
+ * The body must have the same parts as when it was saved.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param buffer the state written by body_save_state()
+ */
+void body_load_state(body_t *body, const void *buffer);
+
 /**
  * Marks a body for removal--future calls to body_is_removed() will return true.
  * Does not free the body.
@@ -206,4 +295,52 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
+/**
+ * Gets how far a body moved during its last body_tick().
+ * Moving a body with body_set_centroid() resets this to zero, so a body that
+ * was placed somewhere is not treated as having swept through the space
+ * in between.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's displacement in its last tick
+ */
+vector_t body_get_displacement(body_t *body);
+
+/**
+ * Marks a body as fast-moving, so collisions involving it also check the
+ * path it took during each tick (see find_swept_collision()) and it cannot
+ * pass through thin bodies. Bodies start without this.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param continuous whether the body's collisions should be swept
+ */
+void body_set_continuous(body_t *body, bool continuous);
+
+/**
+ * Returns whether a body's collisions are swept.
+ *
+ * @param body the body to check
+ * @return whether body_set_continuous() was last called with true
+ */
+bool body_is_continuous(body_t *body);
+
+/**
+ * Puts a body to sleep or wakes it up.
+ * A sleeping body stays in its scene but is not ticked, and the scene skips
+ * every force creator acting on it. This lets a body be parked and reused
+ * later instead of being removed and allocated again.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param asleep whether the body should sleep
+ */
+void body_set_asleep(body_t *body, bool asleep);
+
+/**
+ * Returns whether a body is asleep. Bodies start awake.
+ *
+ * @param body the body to check
+ * @return whether the body was put to sleep with body_set_asleep()
+ */
+bool body_is_asleep(body_t *body);
+
 #endif // #ifndef __BODY_H__
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include <stdint.h>
+
+/**
+ * The monotonic clock that everything timing the game reads.
+ *
+ * Times are wall time, not clock()'s processor time, which stops while the
+ * process sleeps. They only mean something relative to one another.
+ */
+
+/**
+ * Gets the current time in nanoseconds.
+ *
+ * @return nanoseconds since an arbitrary fixed point
+ */
+uint64_t now_ns(void);
+
+/**
+ * Gets the current time in seconds.
+ *
+ * @return seconds since an arbitrary fixed point
+ */
+double now_seconds(void);
+
+#endif // #ifndef __CLOCK_H__
@@ -20,6 +20,13 @@ typedef struct {
    * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * When the shapes first touched during the last tick, as a fraction of the
+   * tick from 0 (its start) to 1 (its end). Tests that only look at where the
+   * shapes are now report 1.
+   * If collided is false, this value is undefined.
+   */
+  double time;
 } collision_info_t;
 
 /**
@@ -32,4 +39,77 @@ typedef struct {
  */
 collision_info_t find_collision(body_t *body1, body_t *body2);
 
+/**
+ * Returns whether the bounding boxes of two bodies, including their parts,
+ * overlap. This is much cheaper than find_collision() and can be used to
+ * skip it for bodies that are far apart.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies' bounding boxes overlap
+ */
+bool bounds_overlap(body_t *body1, body_t *body2);
+
+/**
+ * Like bounds_overlap(), but with body1's bounding box stretched over the
+ * path it took relative to body2 during the last tick. This is the broadphase
+ * for find_swept_collision().
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies' bounding boxes overlapped at any point
+ */
+bool swept_bounds_overlap(body_t *body1, body_t *body2);
+
+/**
+ * Computes the status of the collision between a body and one part of a
+ * compound body. See body_add_part().
+ *
+ * @param body1 the body
+ * @param body2 the compound body
+ * @param part the index of the part of body2 to test against
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from body1 towards the part.
+ */
+collision_info_t find_part_collision(body_t *body1, body_t *body2,
+                                     size_t part);
+
+/**
+ * Computes the status of the collision between a body and the parts of a
+ * compound body with a given tag. Parts whose bounding boxes do not overlap
+ * body1 are skipped without running the full test.
+ *
+ * @param body1 the body
+ * @param body2 the compound body
+ * @param tag the tag of the parts of body2 to test against
+ * @return the collision with the first colliding part, or a non-collision
+ */
+collision_info_t find_tagged_collision(body_t *body1, body_t *body2,
+                                       size_t tag);
+
+/**
+ * Computes whether two bodies touched at any point while moving during their
+ * last tick (see body_get_displacement()), which catches bodies that passed
+ * all the way through each other. Shapes are treated as their bounding boxes
+ * while they move, which is exact for axis-aligned rectangles.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies touched, and if so, when they first did and the
+ * axis they met along, pointing from body1 towards body2
+ */
+collision_info_t find_swept_collision(body_t *body1, body_t *body2);
+
+/**
+ * Like find_swept_collision(), but against one part of a compound body.
+ *
+ * @param body1 the body
+ * @param body2 the compound body
+ * @param part the index of the part of body2 to test against
+ * @return whether the body and part touched, and if so, when they first did
+ * and the axis they met along, pointing from body1 towards the part
+ */
+collision_info_t find_swept_part_collision(body_t *body1, body_t *body2,
+                                           size_t part);
+
 #endif // #ifndef __COLLISION_H__
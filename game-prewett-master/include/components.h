@@ -0,0 +1,158 @@
+#ifndef __COMPONENTS_H__
+#define __COMPONENTS_H__
+
+#include "asset.h"
+#include "body.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A store of game objects ("entities") and the data attached to them.
+ *
+ * Each kind of component is kept in its own dense array, packed by a sparse
+ * set keyed by entity id. Adding, removing and looking up a component are
+ * O(1), and a system that needs one kind of component can walk that array
+ * directly instead of scanning every body in the scene:
+ *
+ *   for (size_t i = 0; i < component_count(store, COMPONENT_VELOCITY); i++) {
+ *     entity_t entity = component_entity(store, COMPONENT_VELOCITY, i);
+ *     vector_t *velocity = component_at(store, COMPONENT_VELOCITY, i);
+ *     ...
+ *   }
+ *
+ * Components are stored in the order they were added, except that removing
+ * one moves the last component of that kind into its slot.
+ */
+typedef struct component_store component_store_t;
+
+typedef size_t entity_t;
+
+typedef enum {
+  /** tag_component_t: what kind of object the entity is */
+  COMPONENT_TAG,
+  /** sprite_component_t: the images drawn for the entity */
+  COMPONENT_SPRITE,
+  /** body_t *: the body that moves and collides for the entity */
+  COMPONENT_COLLIDER,
+  /** vector_t: the velocity the entity scrolls at */
+  COMPONENT_VELOCITY,
+  NUM_COMPONENTS,
+} component_type_t;
+
+#define SPRITE_MAX_LAYERS 2
+
+typedef struct {
+  /** The kind of object, defined by the game */
+  uint32_t type;
+  /** A game-defined subtype, e.g. the prefab an obstacle was made from */
+  uint32_t variant;
+} tag_component_t;
+
+typedef struct {
+  /** Drawn in order, so later layers are drawn on top */
+  asset_t *layers[SPRITE_MAX_LAYERS];
+  size_t num_layers;
+} sprite_component_t;
+
+/**
+ * Allocates memory for an empty component store.
+ *
+ * @return a pointer to the newly allocated store
+ */
+component_store_t *component_store_init(void);
+
+/**
+ * Releases the memory allocated for a store.
+ * Does not free anything the components point to, like bodies or assets.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ */
+void component_store_free(component_store_t *store);
+
+/**
+ * Creates an entity with no components.
+ * Ids of destroyed entities are reused.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @return the id of the new entity
+ */
+entity_t entity_create(component_store_t *store);
+
+/**
+ * Removes all of an entity's components and frees its id for reuse.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param entity the entity to destroy
+ */
+void entity_destroy(component_store_t *store, entity_t entity);
+
+/**
+ * Adds a component to an entity, or gets it if the entity already has one.
+ * New components are zeroed.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param type the kind of component to add
+ * @param entity the entity to add it to
+ * @return a pointer to the component's data, which is only valid until the
+ * next component of this kind is added or removed
+ */
+void *component_add(component_store_t *store, component_type_t type,
+                    entity_t entity);
+
+/**
+ * Removes a component from an entity. Does nothing if it does not have one.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param type the kind of component to remove
+ * @param entity the entity to remove it from
+ */
+void component_remove(component_store_t *store, component_type_t type,
+                      entity_t entity);
+
+/**
+ * Gets one of an entity's components.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param type the kind of component to get
+ * @param entity the entity to get it from
+ * @return a pointer to the component's data, or NULL if the entity does not
+ * have one. See component_add() for how long the pointer is valid.
+ */
+void *component_get(component_store_t *store, component_type_t type,
+                    entity_t entity);
+
+/**
+ * Gets the number of entities with a kind of component.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param type the kind of component
+ * @return the number of components of that kind
+ */
+size_t component_count(component_store_t *store, component_type_t type);
+
+/**
+ * Gets the entity that owns the component at a position in a dense array.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param type the kind of component
+ * @param index the position, less than component_count()
+ * @return the entity that owns the component
+ */
+entity_t component_entity(component_store_t *store, component_type_t type,
+                          size_t index);
+
+/**
+ * Gets the component at a position in a dense array.
+ *
+ * @param store a pointer to a store returned from component_store_init()
+ * @param type the kind of component
+ * @param index the position, less than component_count()
+ * @return a pointer to the component's data. See component_add() for how long
+ * the pointer is valid.
+ */
+void *component_at(component_store_t *store, component_type_t type,
+                   size_t index);
+
+#endif // #ifndef __COMPONENTS_H__
@@ -0,0 +1,106 @@
+#ifndef __COUNTERS_H__
+#define __COUNTERS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Counts of the work the engine does, such as how many collision tests ran,
+ * so a frame that did more work can be told apart from one that did the same
+ * work more slowly.
+ *
+ * Engine code counts with COUNTER_INC() or COUNTER_ADD(), which add to the
+ * current frame's counts. counters_end_frame() closes the frame; its counts
+ * can then be read alone, summed over the last COUNTERS_WINDOW frames, or
+ * summed over the whole run.
+ *
+ * Counts are kept per thread, so threads simulating scenes of their own never
+ * contend, and each thread reads and ends frames of its own counts only.
+ */
+#define COUNTERS_WINDOW 120
+
+typedef enum {
+  /** Force creators run by scene_tick() */
+  COUNTER_FORCE_CREATORS,
+  /** Separating axis tests between two shapes */
+  COUNTER_SAT_TESTS,
+  /** Separating axis tests that stopped at a separating axis */
+  COUNTER_SAT_EARLY_OUTS,
+  /** Pairs of bodies or parts that started or stopped colliding */
+  COUNTER_COLLISIONS_ENTERED,
+  COUNTER_COLLISIONS_EXITED,
+  /** Bodies moved by scene_tick(), and bodies it freed */
+  COUNTER_BODIES_INTEGRATED,
+  COUNTER_BODIES_REMOVED,
+  COUNTER_TEXTURES_CREATED,
+  COUNTER_TEXTURES_DESTROYED,
+  COUNTER_DRAW_CALLS,
+  /** Strings rasterized by text_render() */
+  COUNTER_TEXT_RASTERIZATIONS,
+  NUM_COUNTERS,
+} counter_t;
+
+/** The counts of the calling thread's current frame */
+extern _Thread_local uint64_t counters_current[NUM_COUNTERS];
+
+#define COUNTER_ADD(counter, amount) (counters_current[(counter)] += (amount))
+#define COUNTER_INC(counter) COUNTER_ADD(counter, 1)
+
+/**
+ * Ends the calling thread's current frame and starts a new one.
+ * If a CSV log is open, the frame's counts are written to it.
+ */
+void counters_end_frame(void);
+
+/**
+ * Gets a count of the last frame the calling thread ended.
+ *
+ * @param counter the counter to read
+ * @return the count, or 0 if no frame has ended
+ */
+uint64_t counters_last_frame(counter_t counter);
+
+/**
+ * Sums a count over the last COUNTERS_WINDOW frames the calling thread ended,
+ * or all of them if fewer have ended.
+ *
+ * @param counter the counter to read
+ * @return the sum over counters_window_frames() frames
+ */
+uint64_t counters_window(counter_t counter);
+
+/**
+ * Gets how many frames counters_window() sums over.
+ *
+ * @return the number of frames, at most COUNTERS_WINDOW
+ */
+size_t counters_window_frames(void);
+
+/**
+ * Gets a count of the whole run on the calling thread, including the frame
+ * in progress. Two readings can be subtracted to count the work in between.
+ *
+ * @param counter the counter to read
+ * @return the count
+ */
+uint64_t counters_total(counter_t counter);
+
+/**
+ * Gets the name of a counter, as used in CSV headers.
+ *
+ * @param counter a counter
+ * @return its name, e.g. "sat_tests"
+ */
+const char *counters_name(counter_t counter);
+
+/**
+ * Starts logging each frame the calling thread ends as a CSV row: the frame
+ * number, then each count. The header is written straight away.
+ *
+ * @param file where to write, which stays open until logging is stopped; or
+ * NULL to stop logging
+ */
+void counters_log_csv(FILE *file);
+
+#endif // #ifndef __COUNTERS_H__
@@ -10,6 +10,9 @@ struct forcer {
   force_creator_t creator;
   void *aux;
   list_t *bodies;
+  // The bytes of aux that change as the scene runs, saved by scene_save()
+  void *state;
+  size_t state_size;
 };
 
 /**
@@ -74,6 +77,9 @@ void create_drag(scene_t *scene, double gamma, body_t *body);
  * allowing different things to happen on a collision.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
  * It should only be called once while the bodies are still colliding.
+ * If either body is continuous, the handler is also called when one passed
+ * through the other during a tick, but only physics_collision_handler()
+ * moves it back to where they met.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -86,6 +92,31 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       double force_const);
 
+/**
+ * Adds a force creator to a scene that calls a handler each time a body
+ * collides with a part of a compound body (see body_add_part()).
+ * The handler is chosen by the tag of the part that was hit, so one forcer
+ * can tell e.g. a landing surface from a lethal side. Each part is tracked
+ * separately, so a handler is called once per part while they are colliding.
+ * Parts are only tested once the bodies' bounding boxes overlap.
+ *
+ * The compound body must have all of its parts before this is called.
+ *
+ * @param scene the scene containing the bodies
+ * @param body1 the body
+ * @param body2 the compound body
+ * @param handlers the handler for each tag, indexed by tag. Parts whose tag is
+ *   out of range or whose handler is NULL are ignored. The array is not
+ *   copied, so it must outlive the bodies.
+ * @param num_handlers the number of handlers in `handlers`
+ * @param aux an auxiliary value to pass to the handlers
+ * @param force_const a constant to pass to the handlers
+ */
+void create_compound_collision(scene_t *scene, body_t *body1, body_t *body2,
+                               const collision_handler_t *handlers,
+                               size_t num_handlers, void *aux,
+                               double force_const);
+
 /**
  * Adds a force creator to a scene that destroys two bodies when they collide.
  * The bodies should be destroyed by calling body_remove().
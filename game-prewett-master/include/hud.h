@@ -0,0 +1,96 @@
+#ifndef __HUD_H__
+#define __HUD_H__
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+/**
+ * A retained-mode overlay of text widgets.
+ * The widgets are composed into an offscreen texture, which is only redrawn
+ * when one of the values the widgets are bound to changes. Otherwise,
+ * rendering the HUD is a single texture copy no matter how many widgets it has.
+ */
+typedef struct hud hud_t;
+
+/**
+ * Allocates memory for an empty HUD that covers the given area of the window.
+ *
+ * @param width the width of the HUD in pixels
+ * @param height the height of the HUD in pixels
+ * @return a pointer to the newly allocated HUD
+ */
+hud_t *hud_init(int width, int height);
+
+/**
+ * Frees the HUD, its widgets and its textures.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ */
+void hud_free(hud_t *hud);
+
+/**
+ * Adds a widget that always shows the same text.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ * @param font_path the filepath to the .ttf file
+ * @param location the top-left corner of the text within the HUD
+ * @param text the text to show, which is copied
+ */
+void hud_add_label(hud_t *hud, const char *font_path, SDL_Point location,
+                   const char *text);
+
+/**
+ * Adds a widget that shows a number, formatted with `format`.
+ * The widget is re-rasterized when the number changes.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ * @param font_path the filepath to the .ttf file
+ * @param location the top-left corner of the text within the HUD
+ * @param value the number to show, which must outlive the HUD
+ * @param format a printf format for a single long long, e.g. "%3lld"
+ */
+void hud_add_number(hud_t *hud, const char *font_path, SDL_Point location,
+                    const long long *value, const char *format);
+
+/**
+ * Adds a widget that shows whichever string `text` points to. The widget is
+ * re-rasterized when `*text` is pointed at a different string, so the strings
+ * should not be modified in place. A NULL string shows nothing.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ * @param font_path the filepath to the .ttf file
+ * @param location the top-left corner of the text within the HUD
+ * @param text the string to show, which must outlive the HUD
+ */
+void hud_add_text(hud_t *hud, const char *font_path, SDL_Point location,
+                  const char *const *text);
+
+/**
+ * Forces the HUD and the text in it to be redrawn on the next hud_render(),
+ * e.g. after the renderer has lost the contents of its render targets or
+ * textures.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ */
+void hud_invalidate(hud_t *hud);
+
+/**
+ * Gets whether the next hud_render() will redraw the offscreen texture,
+ * because a bound value has changed or the HUD was invalidated.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ * @return true if the HUD looks different from when it was last rendered
+ */
+bool hud_is_dirty(hud_t *hud);
+
+/**
+ * Draws the HUD onto the screen at (x, y), first redrawing the offscreen
+ * texture if any bound value has changed since the last call.
+ *
+ * @param hud a pointer to a HUD returned from hud_init()
+ * @param x the x coordinate on the screen of the HUD's top-left corner
+ * @param y the y coordinate on the screen of the HUD's top-left corner
+ */
+void hud_render(hud_t *hud, int x, int y);
+
+#endif // #ifndef __HUD_H__
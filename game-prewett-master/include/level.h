@@ -0,0 +1,244 @@
+#ifndef __LEVEL_H__
+#define __LEVEL_H__
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * A fixed level: a list of object placements along the x-axis, spawned in
+ * order as the level scrolls past them.
+ *
+ * Levels are written as text files with one placement per line:
+ *
+ *   # comments and blank lines are ignored
+ *   <kind> <x> <y> [<width> <height>]
+ *
+ * where `kind` is one of the names passed to level_load(), (x, y) is the
+ * center of the object in level coordinates and the optional size replaces
+ * the size of the kind's shape. x = 0 is the left edge of the screen when the
+ * level starts.
+ *
+ * Long levels should be compiled with the `level_compile` tool into the
+ * binary layout below, which is memory-mapped instead of parsed:
+ *
+ *   level_file_header_t
+ *   char[LEVEL_KIND_NAME_LEN][num_kinds]   (names of the kinds used)
+ *   level_chunk_t[num_chunks]
+ *   per chunk, aligned to LEVEL_CHUNK_ALIGNMENT:
+ *     level_record_t[num_records]
+ *     level_part_t[num_parts]              (the parts of its placements)
+ *
+ * Chunk i holds the placements whose bounding box starts in
+ * [i * chunk_width, (i + 1) * chunk_width), sorted by the left edge of their
+ * bounding box. Each placement carries its shape and bounding box, so nothing
+ * is computed when it is spawned. All integers are little-endian.
+ */
+#define LEVEL_MAGIC "GDLV"
+#define LEVEL_VERSION 2
+#define LEVEL_KIND_NAME_LEN 32
+#define LEVEL_CHUNK_ALIGNMENT 4096
+/** The kind of a placement whose kind is not known */
+#define LEVEL_NO_KIND ((size_t)-1)
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_kinds;
+  uint32_t num_chunks;
+  uint64_t num_records;
+  double chunk_width;
+  /** The right edge of the rightmost placement */
+  double length;
+} level_file_header_t;
+
+typedef struct {
+  uint64_t offset;
+  uint32_t num_records;
+  uint32_t num_parts;
+} level_chunk_t;
+
+/** A box making up part of a placement, relative to its position */
+typedef struct {
+  vector_t min;
+  vector_t max;
+  uint32_t tag;
+  uint32_t reserved;
+} level_part_t;
+
+typedef struct {
+  vector_t position;
+  /** The size of the box centered on the position that anchors the object */
+  vector_t size;
+  /** The bounding box of the anchor and every part */
+  vector_t min;
+  vector_t max;
+  uint32_t kind;
+  uint32_t num_parts;
+  /** Indexes the parts of the record's chunk */
+  uint32_t first_part;
+  uint32_t reserved;
+} level_record_t;
+
+/**
+ * The shape of an object that can be placed: the size of its anchor box and
+ * the parts around it (see body_add_part()).
+ */
+typedef struct {
+  vector_t size;
+  size_t num_parts;
+  const level_part_t *parts;
+} level_shape_t;
+
+typedef struct level level_t;
+
+/**
+ * How far level_spawn() has got through a level, for saving and going back to
+ * with level_tell() and level_seek().
+ */
+typedef struct {
+  size_t chunk;
+  size_t cursor;
+} level_position_t;
+
+/**
+ * A function that creates the object for a placement once it comes into view.
+ *
+ * @param aux the auxiliary value passed to level_spawn()
+ * @param kind the index of the placement's kind in the `kinds` array
+ * @param position the position of the placement in level coordinates
+ * @param shape the placement's shape, which is only valid during the call
+ */
+typedef void (*level_spawner_t)(void *aux, size_t kind, vector_t position,
+                                const level_shape_t *shape);
+
+/**
+ * A function that looks up a kind name in a text level.
+ *
+ * @param aux the auxiliary value passed to level_parse_text()
+ * @param name the kind's name as written in the file
+ * @param path the filepath passed to level_parse_text(), for messages
+ * @param line_number the line the name is on, counting from 1
+ * @param shape set to the kind's shape; its parts must outlive the parse
+ * @return the kind to store, or LEVEL_NO_KIND to skip the placement
+ */
+typedef size_t (*level_kind_resolver_t)(void *aux, const char *name,
+                                        const char *path, size_t line_number,
+                                        level_shape_t *shape);
+
+/**
+ * Parses the placements of a text level, sorted by the left edge of their
+ * bounding box, with a copy of the parts of each one's shape. level_load()
+ * uses this for text levels, and the `level_compile` tool uses it before
+ * chunking them.
+ *
+ * @param f the open level file
+ * @param path the filepath of the file, for messages
+ * @param resolve gives the kind and shape of each placement from its name
+ * @param aux an auxiliary value passed to `resolve`
+ * @param num_records set to the number of placements
+ * @param parts set to the parts, indexed by each record's first_part, which
+ *   the caller frees
+ * @param num_parts set to the number of parts
+ * @param length set to the right edge of the rightmost placement
+ * @return the placements, which the caller frees
+ */
+level_record_t *level_parse_text(FILE *f, const char *path,
+                                 level_kind_resolver_t resolve, void *aux,
+                                 size_t *num_records, level_part_t **parts,
+                                 size_t *num_parts, double *length);
+
+/**
+ * Loads a level, either by parsing a text file or by memory-mapping a
+ * compiled one. Compiled levels only read their header and chunk table here;
+ * placements are paged in as level_spawn() reaches their chunk.
+ * Placements with an unknown kind are reported and skipped.
+ *
+ * @param path the filepath to the level file
+ * @param kinds the names of the kinds of objects that can be placed
+ * @param shapes the shape of each kind, used for text levels. Compiled
+ *   levels carry the shapes they were compiled with.
+ * @param num_kinds the number of names in `kinds`
+ * @return a pointer to the newly allocated level, or NULL if the file could
+ * not be opened or is not a valid level
+ */
+level_t *level_load(const char *path, const char *const *kinds,
+                    const level_shape_t *shapes, size_t num_kinds);
+
+/**
+ * Releases the memory allocated for a level, unmapping it if it was compiled.
+ *
+ * @param level a pointer to a level returned from level_load()
+ */
+void level_free(level_t *level);
+
+/**
+ * Gets the number of placements in a level.
+ *
+ * @param level a pointer to a level returned from level_load()
+ * @return the number of placements
+ */
+size_t level_entries(level_t *level);
+
+/**
+ * Gets the right edge of the rightmost placement in a level.
+ *
+ * @param level a pointer to a level returned from level_load()
+ * @return the largest x covered by any placement, or 0 if the level is empty
+ */
+double level_length(level_t *level);
+
+/**
+ * Rewinds the level so that every placement will be spawned again.
+ *
+ * @param level a pointer to a level returned from level_load()
+ */
+void level_reset(level_t *level);
+
+/**
+ * Returns whether every placement in the level has been spawned.
+ *
+ * @param level a pointer to a level returned from level_load()
+ * @return whether the level has nothing left to spawn
+ */
+bool level_is_done(level_t *level);
+
+/**
+ * Gets how far the level has spawned.
+ *
+ * @param level a pointer to a level returned from level_load()
+ * @return the position of the next placement to spawn
+ */
+level_position_t level_tell(level_t *level);
+
+/**
+ * Moves the level back (or forward) to a position returned from level_tell(),
+ * so that spawning carries on from there. Compiled levels page in the chunks
+ * around the new position.
+ *
+ * @param level a pointer to a level returned from level_load()
+ * @param position a position in the same level
+ */
+void level_seek(level_t *level, level_position_t position);
+
+/**
+ * Spawns every placement that has not been spawned yet and whose bounding box
+ * starts at or before `horizon`, in order. The level keeps a cursor into its
+ * sorted placements, so this takes time proportional to the number spawned.
+ *
+ * Compiled levels prefetch the chunk after the one being spawned from and
+ * release chunks once they have been spawned, so only a couple of chunks are
+ * resident at a time.
+ *
+ * @param level a pointer to a level returned from level_load()
+ * @param horizon the right edge of the lookahead window, in level coordinates
+ * @param spawner the function called for each placement that is spawned
+ * @param aux an auxiliary value to pass to the spawner
+ * @return the number of placements that were spawned
+ */
+size_t level_spawn(level_t *level, double horizon, level_spawner_t spawner,
+                   void *aux);
+
+#endif // #ifndef __LEVEL_H__
@@ -0,0 +1,98 @@
+#ifndef __PACER_H__
+#define __PACER_H__
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Paces a loop to a target frame rate, waiting between frames on the
+ * monotonic clock instead of relying on vsync.
+ *
+ * Frames are due at fixed deadlines one period apart. The wait sleeps until
+ * shortly before the deadline and spins for the rest, since a sleep can
+ * oversleep by a scheduler tick or more. The spin margin follows the largest
+ * oversleep recently seen, capped at half a period, so on a quiet host almost
+ * all of the wait is spent asleep. Stalls longer than a period are ignored.
+ *
+ * A frame that ends after its deadline has missed it. The deadlines are then
+ * moved to start from that frame rather than running frames back to back to
+ * catch up.
+ *
+ * With a target rate of 0 the pacer never waits, for benchmarking, but still
+ * keeps statistics.
+ */
+typedef struct pacer pacer_t;
+
+typedef struct {
+  /** Frames paced, and how many of them ended after their deadline */
+  size_t frames;
+  size_t missed_deadlines;
+  /**
+   * How far frame intervals strayed from the target period, in seconds,
+   * or 0 if the pacer does not wait
+   */
+  double mean_jitter;
+  double max_jitter;
+  /** Seconds spent waiting asleep and spinning */
+  double sleep_time;
+  double spin_time;
+  /** Seconds from the first frame to the last */
+  double elapsed;
+} pacer_stats_t;
+
+/**
+ * Allocates memory for a pacer. The first frame starts now.
+ *
+ * @param target_fps the frames per second to pace to, or 0 not to wait
+ * @return a pointer to the new pacer
+ */
+pacer_t *pacer_init(double target_fps);
+
+/**
+ * Releases the memory allocated for a pacer.
+ *
+ * @param pacer a pointer to a pacer returned from pacer_init()
+ */
+void pacer_free(pacer_t *pacer);
+
+/**
+ * Changes the rate a pacer paces to. The next deadline is one new period
+ * after the last frame ended.
+ *
+ * @param pacer a pointer to a pacer returned from pacer_init()
+ * @param target_fps the frames per second to pace to, or 0 not to wait
+ */
+void pacer_set_target(pacer_t *pacer, double target_fps);
+
+/**
+ * Ends a frame, waiting until its deadline if it ended early.
+ *
+ * @param pacer a pointer to a pacer returned from pacer_init()
+ */
+void pacer_end_frame(pacer_t *pacer);
+
+/**
+ * Starts the next frame now, after the loop has waited on something else
+ * such as input. The time spent waiting is not counted as a missed deadline.
+ *
+ * @param pacer a pointer to a pacer returned from pacer_init()
+ */
+void pacer_resume(pacer_t *pacer);
+
+/**
+ * Gets the statistics of the frames a pacer has paced.
+ *
+ * @param pacer a pointer to a pacer returned from pacer_init()
+ * @return the statistics
+ */
+pacer_stats_t pacer_stats(const pacer_t *pacer);
+
+/**
+ * Writes a one-line summary of a pacer's statistics.
+ *
+ * @param pacer a pointer to a pacer returned from pacer_init()
+ * @param file where to write the summary
+ */
+void pacer_report(const pacer_t *pacer, FILE *file);
+
+#endif // #ifndef __PACER_H__
@@ -0,0 +1,120 @@
+#ifndef __PERF_OVERLAY_H__
+#define __PERF_OVERLAY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "scene.h"
+
+/**
+ * An on-screen readout of how fast the game is running, cheap enough to leave
+ * on while playtesting.
+ *
+ * It shows the current and average frame rate, the 1% low (the frame rate of
+ * the slowest 1% of recent frames), a graph of recent frame times, how long
+ * the simulation, rendering and presenting took, and the number of bodies,
+ * force creators, draw calls and allocations in the last frame.
+ *
+ * All text is drawn from a glyph atlas rasterized once, the first time the
+ * overlay is drawn, so later draws create no textures and allocate nothing.
+ * Allocations are only counted in builds with -DALLOC_TRACK.
+ *
+ * A frame is measured like this:
+ *
+ *   perf_overlay_begin_phase(overlay, PERF_SIM);
+ *   ...step the simulation...
+ *   perf_overlay_end_phase(overlay, PERF_SIM);
+ *   perf_overlay_begin_phase(overlay, PERF_RENDER);
+ *   ...draw the frame...
+ *   perf_overlay_render(overlay, x, y);
+ *   perf_overlay_end_phase(overlay, PERF_RENDER);
+ *   perf_overlay_begin_phase(overlay, PERF_PRESENT);
+ *   sdl_show();
+ *   perf_overlay_end_phase(overlay, PERF_PRESENT);
+ *   perf_overlay_end_frame(overlay, scene);
+ *
+ * Since the overlay is drawn before the frame is presented, it shows the
+ * figures of the frame before.
+ */
+typedef struct perf_overlay perf_overlay_t;
+
+/** The parts of a frame that are timed separately */
+typedef enum {
+  PERF_SIM,
+  PERF_RENDER,
+  /** Includes waiting for vsync */
+  PERF_PRESENT,
+  NUM_PERF_PHASES,
+} perf_phase_t;
+
+/**
+ * Allocates an overlay, hidden until perf_overlay_toggle() is called.
+ * Its glyph atlas is rasterized the first time it is drawn, which needs
+ * sdl_init() to have been called.
+ *
+ * @param font_path the filepath to the .ttf file to draw text with, which
+ * must outlive the overlay
+ * @return a pointer to the newly allocated overlay
+ */
+perf_overlay_t *perf_overlay_init(const char *font_path);
+
+/**
+ * Frees the overlay and its glyph atlas.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ */
+void perf_overlay_free(perf_overlay_t *overlay);
+
+/**
+ * Shows the overlay if it is hidden, or hides it if it is shown.
+ * Frames are measured either way.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ */
+void perf_overlay_toggle(perf_overlay_t *overlay);
+
+/**
+ * Gets whether the overlay is shown, in which case it changes every frame.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ * @return true if perf_overlay_render() draws anything
+ */
+bool perf_overlay_is_shown(const perf_overlay_t *overlay);
+
+/**
+ * Starts timing a phase of the current frame.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ * @param phase the phase that is starting
+ */
+void perf_overlay_begin_phase(perf_overlay_t *overlay, perf_phase_t phase);
+
+/**
+ * Stops timing a phase of the current frame. A phase may be timed several
+ * times in one frame, in which case the times are added.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ * @param phase the phase passed to the last perf_overlay_begin_phase()
+ */
+void perf_overlay_end_phase(perf_overlay_t *overlay, perf_phase_t phase);
+
+/**
+ * Finishes measuring a frame: its time since the previous frame ended is added
+ * to the graph, and its phase times and counts become the ones shown.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ * @param scene the scene whose bodies and force creators are counted
+ */
+void perf_overlay_end_frame(perf_overlay_t *overlay, scene_t *scene);
+
+/**
+ * Draws the overlay with its top-left corner at (x, y), if it is shown.
+ * Its own draw calls are not counted.
+ *
+ * @param overlay a pointer to an overlay returned from perf_overlay_init()
+ * @param x the x coordinate of the overlay on the window
+ * @param y the y coordinate of the overlay on the window
+ */
+void perf_overlay_render(perf_overlay_t *overlay, int x, int y);
+
+#endif // #ifndef __PERF_OVERLAY_H__
@@ -0,0 +1,76 @@
+#ifndef __PREFAB_H__
+#define __PREFAB_H__
+
+#include "level.h"
+#include <stddef.h>
+
+/**
+ * The objects the game places in its levels, and the shape of each one.
+ * The game, the level compiler and the level validator all build obstacles
+ * from these shapes, so they cannot disagree about what a level contains.
+ *
+ * Obstacles are compound bodies (see body_add_part()) anchored on a square
+ * at their position. Each block is a strip on top that can be landed on, a
+ * lethal left side and the square drawn as the block itself; each spike is a
+ * lethal square. Coins have no parts.
+ *
+ * Levels without a layout file spawn obstacles at random from their
+ * spawn_table_t instead.
+ */
+
+/** The roles of the parts of an obstacle, stored as level_part_t tags */
+typedef enum {
+  PART_BLOCK,   // Solid square drawn as a block
+  PART_LANDING, // Able to bounce on top
+  PART_SIDE,    // Destruction when collide on side of block
+  PART_SPIKE,   // Destruction on any contact
+  NUM_PART_TAGS,
+} part_tag_t;
+
+/** The kinds of objects that can be placed in a level file */
+typedef enum {
+  PREFAB_BLOCK,
+  PREFAB_SPIKE,
+  PREFAB_DOUBLE_SPIKE,
+  PREFAB_TRIPLE_SPIKE,
+  PREFAB_TRIPLE_BLOCK,
+  PREFAB_FIVE_BLOCK,
+  PREFAB_DOUBLE_STAIRCASE,
+  PREFAB_TRIPLE_STAIRCASE,
+  PREFAB_COIN,
+  NUM_PREFABS,
+} prefab_kind_t;
+
+/** The names of each prefab_kind_t in level files */
+extern const char *const PREFAB_NAMES[NUM_PREFABS];
+
+/** The shape of each prefab_kind_t, relative to its position */
+extern const level_shape_t PREFAB_SHAPES[NUM_PREFABS];
+
+/** How a level without a layout file spawns obstacles at random */
+typedef struct {
+  const char *name;
+  /** The horizontal velocity everything in the level scrolls at */
+  double velocity;
+  /** The seconds between obstacles */
+  double interval;
+  /** The kinds an obstacle is drawn from; repeated kinds are more likely */
+  size_t num_kinds;
+  const prefab_kind_t *kinds;
+} spawn_table_t;
+
+/** The number of levels in the game, in the order they are played */
+#define NUM_SPAWN_TABLES 2
+
+/** The spawn table of each level */
+extern const spawn_table_t SPAWN_TABLES[NUM_SPAWN_TABLES];
+
+/**
+ * Looks up a prefab by the name it has in level files.
+ *
+ * @param name the name of a kind
+ * @return the kind, or NUM_PREFABS if there is none by that name
+ */
+prefab_kind_t prefab_find(const char *name);
+
+#endif // #ifndef __PREFAB_H__
@@ -0,0 +1,107 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A frame profiler that records how long named zones of code take.
+ *
+ * Build with -DPROFILE to enable it. Without it the PROFILE_* macros expand to
+ * nothing, so instrumented code costs nothing.
+ *
+ *   void scene_tick(scene_t *scene, double dt) {
+ *     PROFILE_ZONE("scene_tick");
+ *     ...
+ *   } // the zone ends here, including on early returns
+ *
+ * Each thread records the zones it finishes into its own ring buffer, so
+ * recording never locks. Once a buffer is full the oldest zones are
+ * overwritten. profiler_dump() writes every buffer as Chrome trace JSON, which
+ * can be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Zones nest up to PROFILER_MAX_DEPTH deep per thread. Deeper zones are not
+ * recorded.
+ */
+#ifndef PROFILER_BUFFER_EVENTS
+#define PROFILER_BUFFER_EVENTS (1 << 17)
+#endif
+#define PROFILER_MAX_DEPTH 64
+
+/** A finished zone */
+typedef struct {
+  /** Must be a string literal, or outlive the profiler */
+  const char *name;
+  /** When the zone started and how long it took, in nanoseconds */
+  uint64_t start;
+  uint64_t duration;
+} profiler_event_t;
+
+#ifdef PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+/** Starts a zone that ends when the enclosing block is left */
+#define PROFILE_ZONE(name)                                                     \
+  __attribute__((cleanup(profiler_end_scope))) int PROFILE_CONCAT(             \
+      profile_zone_, __LINE__) = profiler_begin(name)
+/** Starts and ends a zone that does not match a block */
+#define PROFILE_BEGIN(name) profiler_begin(name)
+#define PROFILE_END() profiler_end()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#endif
+
+/**
+ * Starts a zone on the calling thread. Use PROFILE_ZONE() or PROFILE_BEGIN()
+ * instead, so the call is compiled out without -DPROFILE.
+ *
+ * @param name the name of the zone
+ * @return 0, so it can initialize the variable PROFILE_ZONE() declares
+ */
+int profiler_begin(const char *name);
+
+/**
+ * Ends the zone most recently started on the calling thread.
+ */
+void profiler_end(void);
+
+/**
+ * Ends a zone started by PROFILE_ZONE(); called when its variable goes out of
+ * scope.
+ *
+ * @param zone the variable PROFILE_ZONE() declared
+ */
+void profiler_end_scope(int *zone);
+
+/**
+ * Gets the number of zones the calling thread has finished so far, to pass
+ * to profiler_total() later.
+ *
+ * @return a mark for the zones finished after this call
+ */
+size_t profiler_mark(void);
+
+/**
+ * Adds up how long the zones the calling thread finished since `mark` and
+ * named `name` took. Zones already overwritten in the thread's ring buffer
+ * are missed, so marks should be recent.
+ *
+ * @param name the name of the zones to add up
+ * @param mark a value returned from profiler_mark()
+ * @return the total duration of the zones in nanoseconds
+ */
+uint64_t profiler_total(const char *name, size_t mark);
+
+/**
+ * Writes the zones recorded by every thread as Chrome trace JSON.
+ * Other threads should not be recording while this runs.
+ *
+ * @param path the file to write
+ * @return whether the file could be written
+ */
+bool profiler_dump(const char *path);
+
+#endif // #ifndef __PROFILER_H__
@@ -0,0 +1,114 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A recording of the inputs of one run, used to play the run back exactly.
+ *
+ * A run is reproducible from its RNG seed and the inputs it received, as long
+ * as the simulation advances in fixed steps and inputs are applied between
+ * steps. Each input is stamped with the index of the step it was applied
+ * before (its "tick").
+ *
+ * Recordings are the bytes "GDRP" followed by a stream of unsigned LEB128
+ * varints:
+ *
+ *   version seed
+ *   then per event: <ticks since the previous event> <type> <payload>
+ *
+ * where the payload of a REPLAY_KEY is <key> <released> <held time in ms>,
+ * the payload of a REPLAY_CLICK is <x> <y> (zigzag-encoded), and a REPLAY_END
+ * has none. Most events take 5-6 bytes.
+ */
+typedef struct replay replay_t;
+
+#define REPLAY_MAGIC "GDRP"
+#define REPLAY_VERSION 1
+
+typedef enum {
+  REPLAY_KEY,
+  REPLAY_CLICK,
+  /** Marks the tick the recording was stopped at */
+  REPLAY_END,
+} replay_event_type_t;
+
+typedef struct {
+  replay_event_type_t type;
+  uint64_t tick;
+  /** REPLAY_KEY: the key and whether it was released rather than pressed */
+  char key;
+  bool released;
+  /** REPLAY_KEY: how long the key had been held, to the millisecond */
+  double held_time;
+  /** REPLAY_CLICK: the window coordinates of the click */
+  int32_t x;
+  int32_t y;
+} replay_event_t;
+
+/**
+ * Starts recording to a file, overwriting it.
+ *
+ * @param path the file to write
+ * @param seed the seed the run's RNG was started with
+ * @return the new recording, or NULL if the file could not be opened
+ */
+replay_t *replay_record(const char *path, uint64_t seed);
+
+/**
+ * Opens a recording to play it back.
+ *
+ * @param path a file written by replay_record()
+ * @return the recording, or NULL if the file is missing or not a recording
+ */
+replay_t *replay_open(const char *path);
+
+/**
+ * Gets the seed a recording was made with.
+ *
+ * @param replay a recording from replay_record() or replay_open()
+ * @return the seed passed to replay_record()
+ */
+uint64_t replay_seed(replay_t *replay);
+
+/**
+ * Appends an event to a recording.
+ * Events must be written in order of tick.
+ *
+ * @param replay a recording from replay_record()
+ * @param event the event to write
+ */
+void replay_write(replay_t *replay, const replay_event_t *event);
+
+/**
+ * Reads the next event of a playback if it is due.
+ * Call repeatedly before each step until it returns false.
+ *
+ * @param replay a recording from replay_open()
+ * @param tick the index of the step about to run
+ * @param event filled in with the next event if it returns true
+ * @return true if the next event's tick is at most `tick`
+ */
+bool replay_next(replay_t *replay, uint64_t tick, replay_event_t *event);
+
+/**
+ * Checks whether a playback has reached the end of its recording.
+ *
+ * @param replay a recording from replay_open()
+ * @return true once playback has passed the tick the recording ended at (or
+ * the end of the file)
+ */
+bool replay_is_done(replay_t *replay);
+
+/**
+ * Closes a recording or playback and frees it.
+ * Recordings are ended with a REPLAY_END event at `tick`.
+ *
+ * @param replay a recording from replay_record() or replay_open()
+ * @param tick the index of the step the run stopped at
+ */
+void replay_close(replay_t *replay, uint64_t tick);
+
+#endif // #ifndef __REPLAY_H__
@@ -0,0 +1,53 @@
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A seeded pseudo-random number generator (xorshift64*).
+ *
+ * Unlike rand(), each generator has its own state and produces the same
+ * sequence on every platform for a given seed, so a run can be reproduced
+ * from its seed alone.
+ * rng_t is defined here instead of rng.c because it is stored by value.
+ */
+typedef struct {
+  uint64_t state;
+} rng_t;
+
+/**
+ * Resets a generator to the start of the sequence for a seed.
+ * Any seed is allowed, including 0.
+ *
+ * @param rng the generator to seed
+ * @param seed the seed
+ */
+void rng_seed(rng_t *rng, uint64_t seed);
+
+/**
+ * Gets the next number in a generator's sequence.
+ *
+ * @param rng a seeded generator
+ * @return a uniformly distributed 32-bit number
+ */
+uint32_t rng_next(rng_t *rng);
+
+/**
+ * Gets a random number in [0, 1).
+ *
+ * @param rng a seeded generator
+ * @return a uniformly distributed double in [0, 1)
+ */
+double rng_double(rng_t *rng);
+
+/**
+ * Gets a random index in [0, n).
+ *
+ * @param rng a seeded generator
+ * @param n the number of choices; must be positive
+ * @return a uniformly distributed number in [0, n)
+ */
+size_t rng_range(rng_t *rng, size_t n);
+
+#endif // #ifndef __RNG_H__
@@ -18,6 +18,15 @@ typedef struct scene scene_t;
  */
 typedef void (*force_creator_t)(void *aux);
 
+/**
+ * A copy of the state of a scene's bodies and force creators, which the scene
+ * can be put back into with scene_restore(), e.g. for checkpoints.
+ *
+ * A snapshot stores its data in one buffer. The buffer is kept between saves,
+ * so saving into the same snapshot again usually does not allocate.
+ */
+typedef struct scene_snapshot scene_snapshot_t;
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -43,6 +52,14 @@ void scene_free(scene_t *scene);
  */
 size_t scene_bodies(scene_t *scene);
 
+/**
+ * Gets the number of force creators in a given scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of force creators added and not yet removed
+ */
+size_t scene_force_creators(scene_t *scene);
+
 /**
  * Gets the body at a given index in a scene.
  * Asserts that the index is valid.
@@ -95,6 +112,23 @@ void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux);
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies);
 
+/**
+ * Adds a force creator that keeps state between ticks, e.g. whether two
+ * bodies were already colliding. Like scene_add_bodies_force_creator(), but
+ * scene_save() and scene_restore() also copy the `state_size` bytes at
+ * `state`, which should point into aux.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the list of bodies affected by the force creator
+ * @param state the state of the force creator
+ * @param state_size the number of bytes of state
+ */
+void scene_add_stateful_force_creator(scene_t *scene, force_creator_t forcer,
+                                      void *aux, list_t *bodies, void *state,
+                                      size_t state_size);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
@@ -107,4 +141,61 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
  */
 void scene_tick(scene_t *scene, double dt);
 
+/**
+ * Allocates memory for an empty snapshot.
+ *
+ * @return the new snapshot
+ */
+scene_snapshot_t *scene_snapshot_init(void);
+
+/**
+ * Releases the memory allocated for a snapshot.
+ *
+ * @param snapshot a pointer to a snapshot returned from scene_snapshot_init()
+ */
+void scene_snapshot_free(scene_snapshot_t *snapshot);
+
+/**
+ * Gets the number of bytes of state in a snapshot.
+ *
+ * @param snapshot a pointer to a snapshot returned from scene_snapshot_init()
+ * @return the size of the saved state
+ */
+size_t scene_snapshot_size(scene_snapshot_t *snapshot);
+
+/**
+ * Gets the number of bodies whose state is in a snapshot.
+ * These are the first bodies of the scene when it was saved.
+ *
+ * @param snapshot a pointer to a snapshot returned from scene_snapshot_init()
+ * @return the number of bodies saved
+ */
+size_t scene_snapshot_bodies(scene_snapshot_t *snapshot);
+
+/**
+ * Saves the state of every body and stateful force creator in a scene,
+ * replacing whatever the snapshot held. Takes time proportional to the size
+ * of the state.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param snapshot a pointer to a snapshot returned from scene_snapshot_init()
+ */
+void scene_save(scene_t *scene, scene_snapshot_t *snapshot);
+
+/**
+ * Puts the bodies and force creators of a scene back into the state saved in
+ * a snapshot, in time proportional to the size of the state.
+ *
+ * Bodies and force creators added since the snapshot was saved are left as
+ * they are; the caller decides what to do with them. The scene is left
+ * unchanged if any body or force creator in the snapshot has since been
+ * removed from the scene, or no longer has the same amount of state (e.g. a
+ * body with a different number of points now sits at its address).
+ *
+ * @param scene the scene passed to scene_save()
+ * @param snapshot a snapshot saved from the scene
+ * @return whether the scene was restored
+ */
+bool scene_restore(scene_t *scene, scene_snapshot_t *snapshot);
+
 #endif // #ifndef __SCENE_H__
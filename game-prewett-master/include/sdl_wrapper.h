@@ -42,6 +42,24 @@ typedef enum { KEY_PRESSED, KEY_RELEASED } key_event_type_t;
 typedef void (*key_handler_t)(char key, key_event_type_t type, double held_time,
                               void *state);
 
+/**
+ * A mouse click handler.
+ * When a mouse button is pressed, the handler is passed the window coordinates
+ * of the pointer.
+ *
+ * @param x the x coordinate of the click, in pixels from the left of the window
+ * @param y the y coordinate of the click, in pixels from the top of the window
+ */
+typedef void (*click_handler_t)(int x, int y, void *state);
+
+/**
+ * A render reset handler.
+ * Called when the renderer has lost the contents of its render targets, or
+ * of all of its textures if the device was reset, so that anything cached in
+ * them can be redrawn.
+ */
+typedef void (*render_reset_handler_t)(void *state);
+
 /**
  * Initializes the SDL window and renderer.
  * Must be called once before any of the other SDL functions.
@@ -78,6 +96,31 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color);
  */
 void sdl_show(void);
 
+/**
+ * Gets whether the window may no longer show the last frame presented:
+ * input has arrived, or the window was exposed, resized or restored.
+ * sdl_show() clears this, so a screen that only changes in response to these
+ * can skip drawing while it is false.
+ *
+ * @return true if the next frame should be drawn and presented
+ */
+bool sdl_is_damaged(void);
+
+/**
+ * Gets whether the window has input focus and is not minimized or hidden.
+ *
+ * @return true if the user can see and interact with the window
+ */
+bool sdl_is_window_active(void);
+
+/**
+ * Blocks until an event arrives or the timeout passes. The event is left
+ * for sdl_is_done() to handle.
+ *
+ * @param timeout the most seconds to wait
+ */
+void sdl_wait_event(double timeout);
+
 /**
  * Draws all bodies in a scene.
  * This internally calls sdl_clear(), sdl_draw_polygon(), and sdl_show(),
@@ -116,6 +159,23 @@ void sdl_render_scene(scene_t *scene, void *aux);
  */
 void sdl_on_key(key_handler_t handler);
 
+/**
+ * Registers a function to be called every time a mouse button is pressed.
+ * Overwrites any existing handler.
+ *
+ * @param handler the function to call with each click
+ */
+void sdl_on_click(click_handler_t handler);
+
+/**
+ * Registers a function to be called every time the renderer loses the
+ * contents of its render targets or textures.
+ * Overwrites any existing handler.
+ *
+ * @param handler the function to call after each reset
+ */
+void sdl_on_render_reset(render_reset_handler_t handler);
+
 /**
  * Gets the amount of time that has passed since the last time
  * this function was called, in seconds.
@@ -142,12 +202,20 @@ void text_display(SDL_Texture *Message, vector_t location);
 SDL_Texture *text_render(const char *message, TTF_Font *font);
 
 /**
- * Calculates the bounding box for the given body.
- * @param poly The polygon representing the body.
+ * Calculates the bounding box for the given body, including its parts.
+ * @param body The body to bound.
  * @return SDL_Rect The bounding box of the body.
  */
 SDL_Rect get_body_bounding_box(body_t *body);
 
+/**
+ * Calculates the bounding box for one part of a compound body.
+ * @param body The compound body.
+ * @param part The index of the part.
+ * @return SDL_Rect The bounding box of the part.
+ */
+SDL_Rect get_part_bounding_box(body_t *body, size_t part);
+
 /**
  * Loads an image from a file and creates an SDL_Texture from it.
  *
@@ -157,6 +225,26 @@ SDL_Rect get_body_bounding_box(body_t *body);
  */
 SDL_Texture *sdl_display(const char *path);
 
+/**
+ * Decodes an image and uploads it as a texture that is ready to be drawn at
+ * the given size. If the image is larger than `width` x `height`, it is box
+ * filtered down to that size once on the CPU, so drawing it does not sample
+ * more texels than land on screen. Images are never scaled up.
+ *
+ * The pixels are converted to `format` before upload so the renderer does not
+ * have to convert them itself.
+ *
+ * @param src the image data, which is closed by this function
+ * @param width the width the texture is drawn at, or 0 to keep the image's
+ * @param height the height the texture is drawn at, or 0 to keep the image's
+ * @param format the pixel format to upload in, or SDL_PIXELFORMAT_UNKNOWN for
+ * the renderer's preferred format
+ * @return SDL_Texture* a pointer to the newly created texture, or NULL if the
+ * load fails
+ */
+SDL_Texture *sdl_load_texture(SDL_RWops *src, int width, int height,
+                              Uint32 format);
+
 /**
  * Renders an SDL_Texture to the screen at a specified location and with given
  * dimensions.
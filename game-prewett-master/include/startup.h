@@ -0,0 +1,63 @@
+#ifndef __STARTUP_H__
+#define __STARTUP_H__
+
+#include <stdio.h>
+
+/**
+ * Timing of the phases of starting the game, up to the first frame being
+ * presented.
+ *
+ * Startup begins with the first call to startup_begin(). A phase may be begun
+ * and ended more than once; its times add up. Phases that are put off until
+ * they are needed, such as opening the audio device, can end after the first
+ * frame and are then logged as they end.
+ */
+typedef enum {
+  STARTUP_VIDEO,
+  STARTUP_RENDERER,
+  STARTUP_TTF,
+  STARTUP_AUDIO,
+  STARTUP_ASSET_PRELOAD,
+  /** Drawing and presenting the first frame */
+  STARTUP_FIRST_FRAME,
+  NUM_STARTUP_PHASES,
+} startup_phase_t;
+
+/**
+ * Starts timing a phase.
+ *
+ * @param phase the phase that is starting
+ */
+void startup_begin(startup_phase_t phase);
+
+/**
+ * Stops timing a phase. Ending STARTUP_FIRST_FRAME marks the end of startup.
+ *
+ * @param phase the phase begun by the last startup_begin() call for it
+ */
+void startup_end(startup_phase_t phase);
+
+/**
+ * Gets how long a phase has taken.
+ *
+ * @param phase a phase
+ * @return the seconds spent in the phase so far
+ */
+double startup_phase_time(startup_phase_t phase);
+
+/**
+ * Gets how long after startup began the first frame was presented.
+ *
+ * @return the seconds until STARTUP_FIRST_FRAME ended, or 0 if it has not
+ */
+double startup_time_to_first_frame(void);
+
+/**
+ * Writes how long each phase took and when the first frame was presented.
+ * Phases that end later are logged to the same file as they end.
+ *
+ * @param file where to write the timings
+ */
+void startup_report(FILE *file);
+
+#endif // #ifndef __STARTUP_H__
@@ -28,6 +28,36 @@ state_t *emscripten_init();
  */
 bool emscripten_main(state_t *state);
 
+/**
+ * Advances the demo by one fixed simulation step without drawing anything.
+ * emscripten_main() calls this as often as real time requires; headless
+ * builds call it in a loop to simulate as fast as possible.
+ *
+ * @param state pointer to a state object with info about demo
+ * @return the number of seconds simulated, or 0 if there is nothing left to
+ * simulate (e.g. a replay has ended)
+ */
+double emscripten_step(state_t *state);
+
+/**
+ * Draws the current state to the renderer's current target without advancing
+ * it or presenting it. emscripten_main() calls this once per frame; tools can
+ * call it to draw offscreen.
+ *
+ * @param state pointer to a state object with info about demo
+ */
+void emscripten_render(state_t *state);
+
+/**
+ * Gets whether the last emscripten_main() call found nothing new to draw and
+ * nothing will change until an event arrives, so the main loop may block on
+ * events instead of running frames.
+ *
+ * @param state pointer to a state object with info about demo
+ * @return true if the demo is idle
+ */
+bool emscripten_is_idle(state_t *state);
+
 /**
  * Frees anything allocated in the demo
  * Should free everything in state as well as state itself.
@@ -0,0 +1,83 @@
+#ifndef __UI_H__
+#define __UI_H__
+
+#include "asset.h"
+#include "state.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A clickable region of the screen belonging to a button asset.
+ */
+typedef struct ui_region ui_region_t;
+
+/**
+ * Initializes the global UI layer over a window of the given size.
+ * Regions are bucketed into a grid of fixed-size cells, so a click only
+ * tests the regions overlapping the cell it lands in.
+ * The caller must then destroy the UI layer with `ui_destroy` when done.
+ *
+ * @param width the width of the window in pixels
+ * @param height the height of the window in pixels
+ */
+void ui_init(int width, int height);
+
+/**
+ * Frees the global UI layer and all of its regions. Button assets are owned
+ * by the caller and are not freed.
+ */
+void ui_destroy(void);
+
+/**
+ * Makes a button clickable while `screen` is the current screen.
+ * The button asset must outlive the region.
+ *
+ * Asserts that the type of `button` is ASSET_BUTTON.
+ *
+ * @param button pointer to the button asset
+ * @param screen the screen the button is shown on
+ * @return the region, which can be removed with `ui_remove`
+ */
+ui_region_t *ui_add_button(asset_t *button, size_t screen);
+
+/**
+ * Removes and frees a region, so its button is no longer clickable.
+ *
+ * @param region a region returned from `ui_add_button`
+ */
+void ui_remove(ui_region_t *region);
+
+/**
+ * Enables or disables a region without removing it. Regions start enabled.
+ *
+ * @param region a region returned from `ui_add_button`
+ * @param enabled whether clicks should reach the region's button
+ */
+void ui_set_enabled(ui_region_t *region, bool enabled);
+
+/**
+ * Switches which screen's regions receive clicks.
+ *
+ * @param screen the screen that is now shown
+ */
+void ui_set_screen(size_t screen);
+
+/**
+ * Gets the screen whose regions currently receive clicks.
+ *
+ * @return the current screen
+ */
+size_t ui_get_screen(void);
+
+/**
+ * Runs the handler of the topmost enabled button on the current screen that
+ * contains the click. Buttons added later are on top.
+ *
+ * @param state the game state
+ * @param x the x position of the mouse click
+ * @param y the y position of the mouse click
+ * @return whether a button handled the click
+ */
+bool ui_handle_click(state_t *state, double x, double y);
+
+#endif // #ifndef __UI_H__
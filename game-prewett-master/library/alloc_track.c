@@ -0,0 +1,270 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#define ALLOC_TRACK_IMPL
+#include "alloc_track.h"
+
+const size_t ALLOC_TABLE_INIT_CAPACITY = 1024;
+const size_t MAX_LEAKS_REPORTED = 20;
+
+// A live allocation; address is 0 for empty slots. Blocks are keyed by
+// address rather than pointer so nothing here reads a pointer once freed.
+typedef struct {
+  uintptr_t address;
+  size_t size;
+  alloc_subsystem_t subsystem;
+} alloc_entry_t;
+
+// Open addressing with linear probing, at most half full
+static alloc_entry_t *table = NULL;
+static size_t table_capacity = 0;
+static size_t table_size = 0;
+
+static alloc_stats_t stats[NUM_ALLOC_SUBSYSTEMS];
+static size_t num_frames = 0;
+static size_t num_allocation_free_frames = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *const SUBSYSTEM_NAMES[NUM_ALLOC_SUBSYSTEMS] = {
+    [ALLOC_LIST] = "list",           [ALLOC_BODY] = "body",
+    [ALLOC_POLYGON] = "polygon",     [ALLOC_COLLISION] = "collision",
+    [ALLOC_ASSET] = "asset",         [ALLOC_RENDER] = "render",
+    [ALLOC_GAME] = "game",           [ALLOC_OTHER] = "other",
+};
+
+static size_t hash_address(uintptr_t address) {
+  // Allocations are aligned, so the low bits carry little information
+  uint64_t x = (uint64_t)address;
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  return (size_t)x & (table_capacity - 1);
+}
+
+// Inserts without growing; the caller keeps the table at most half full
+static void table_put(alloc_entry_t entry) {
+  size_t i = hash_address(entry.address);
+  while (table[i].address != 0) {
+    i = (i + 1) & (table_capacity - 1);
+  }
+  table[i] = entry;
+  table_size++;
+}
+
+static void table_grow(void) {
+  alloc_entry_t *old = table;
+  size_t old_capacity = table_capacity;
+  table_capacity =
+      old_capacity == 0 ? ALLOC_TABLE_INIT_CAPACITY : 2 * old_capacity;
+  table = calloc(table_capacity, sizeof(alloc_entry_t));
+  assert(table);
+  table_size = 0;
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old[i].address != 0) {
+      table_put(old[i]);
+    }
+  }
+  free(old);
+}
+
+// Removes an entry, returning false if the address was not tracked
+static bool table_take(uintptr_t address, alloc_entry_t *entry) {
+  if (table_size == 0) {
+    return false;
+  }
+  size_t i = hash_address(address);
+  while (table[i].address != address) {
+    if (table[i].address == 0) {
+      return false;
+    }
+    i = (i + 1) & (table_capacity - 1);
+  }
+  *entry = table[i];
+  table[i].address = 0;
+  table_size--;
+
+  // Shift later entries of the probe run back so lookups never stop early
+  size_t hole = i;
+  for (size_t j = (i + 1) & (table_capacity - 1); table[j].address != 0;
+       j = (j + 1) & (table_capacity - 1)) {
+    size_t home = hash_address(table[j].address);
+    // Move the entry if its home is not in (hole, j], cyclically
+    bool can_move = hole <= j ? (home <= hole || home > j)
+                              : (home <= hole && home > j);
+    if (can_move) {
+      table[hole] = table[j];
+      table[j].address = 0;
+      hole = j;
+    }
+  }
+  return true;
+}
+
+static void record_alloc(void *ptr, size_t size, alloc_subsystem_t subsystem) {
+  if (ptr == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&lock);
+  if (2 * (table_size + 1) > table_capacity) {
+    table_grow();
+  }
+  table_put((alloc_entry_t){(uintptr_t)ptr, size, subsystem});
+  alloc_stats_t *s = &stats[subsystem];
+  s->frame_allocs++;
+  s->frame_bytes += size;
+  s->total_allocs++;
+  s->live_blocks++;
+  s->live_bytes += size;
+  if (s->live_bytes > s->peak_live_bytes) {
+    s->peak_live_bytes = s->live_bytes;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+// Counts the block as freed. This must happen before the block is released,
+// since another thread may be given the same address as soon as it is.
+// Returns false if the block was not tracked.
+static bool record_free(uintptr_t address, alloc_entry_t *entry) {
+  if (address == 0) {
+    return false;
+  }
+  pthread_mutex_lock(&lock);
+  bool was_tracked = table_take(address, entry);
+  if (was_tracked) {
+    alloc_stats_t *s = &stats[entry->subsystem];
+    s->frame_frees++;
+    s->total_frees++;
+    s->live_blocks--;
+    s->live_bytes -= entry->size;
+  }
+  pthread_mutex_unlock(&lock);
+  return was_tracked;
+}
+
+// Undoes record_free() for a block that turned out not to be released
+static void unrecord_free(alloc_entry_t entry) {
+  pthread_mutex_lock(&lock);
+  if (2 * (table_size + 1) > table_capacity) {
+    table_grow();
+  }
+  table_put(entry);
+  alloc_stats_t *s = &stats[entry.subsystem];
+  // The frame the free was counted in may have ended since
+  if (s->frame_frees > 0) {
+    s->frame_frees--;
+  }
+  s->total_frees--;
+  s->live_blocks++;
+  s->live_bytes += entry.size;
+  pthread_mutex_unlock(&lock);
+}
+
+void *alloc_track_malloc(size_t size, alloc_subsystem_t subsystem) {
+  void *ptr = malloc(size);
+  record_alloc(ptr, size, subsystem);
+  return ptr;
+}
+
+void *alloc_track_calloc(size_t count, size_t size,
+                         alloc_subsystem_t subsystem) {
+  void *ptr = calloc(count, size);
+  record_alloc(ptr, count * size, subsystem);
+  return ptr;
+}
+
+void *alloc_track_realloc(void *ptr, size_t size,
+                          alloc_subsystem_t subsystem) {
+  // Counted as a free of the old block and an allocation of the new one
+  alloc_entry_t entry;
+  bool was_tracked = record_free((uintptr_t)ptr, &entry);
+  void *new_ptr = realloc(ptr, size);
+  if (new_ptr == NULL && size != 0) {
+    // The old block is left as it was
+    if (was_tracked) {
+      unrecord_free(entry);
+    }
+    return NULL;
+  }
+  record_alloc(new_ptr, size, subsystem);
+  return new_ptr;
+}
+
+char *alloc_track_strdup(const char *str, alloc_subsystem_t subsystem) {
+  size_t size = strlen(str) + 1;
+  char *copy = alloc_track_malloc(size, subsystem);
+  if (copy != NULL) {
+    memcpy(copy, str, size);
+  }
+  return copy;
+}
+
+void alloc_track_free(void *ptr) {
+  alloc_entry_t entry;
+  record_free((uintptr_t)ptr, &entry);
+  free(ptr);
+}
+
+void alloc_track_end_frame(void) {
+  pthread_mutex_lock(&lock);
+  bool allocated = false;
+  for (size_t i = 0; i < NUM_ALLOC_SUBSYSTEMS; i++) {
+    alloc_stats_t *s = &stats[i];
+    allocated = allocated || s->frame_allocs > 0;
+    if (s->frame_allocs > s->peak_frame_allocs) {
+      s->peak_frame_allocs = s->frame_allocs;
+    }
+    s->frame_allocs = 0;
+    s->frame_frees = 0;
+    s->frame_bytes = 0;
+  }
+  num_frames++;
+  if (!allocated) {
+    num_allocation_free_frames++;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+alloc_stats_t alloc_track_stats(alloc_subsystem_t subsystem) {
+  pthread_mutex_lock(&lock);
+  alloc_stats_t copy = stats[subsystem];
+  pthread_mutex_unlock(&lock);
+  return copy;
+}
+
+const char *alloc_track_name(alloc_subsystem_t subsystem) {
+  return SUBSYSTEM_NAMES[subsystem];
+}
+
+void alloc_track_report(FILE *file) {
+  pthread_mutex_lock(&lock);
+  fprintf(file, "%-10s %10s %10s %11s %11s %12s %10s\n", "subsystem",
+          "allocs", "frees", "peak/frame", "live", "live bytes", "peak bytes");
+  for (size_t i = 0; i < NUM_ALLOC_SUBSYSTEMS; i++) {
+    alloc_stats_t *s = &stats[i];
+    fprintf(file, "%-10s %10zu %10zu %11zu %11zu %12zu %10zu\n",
+            SUBSYSTEM_NAMES[i], s->total_allocs, s->total_frees,
+            s->peak_frame_allocs, s->live_blocks, s->live_bytes,
+            s->peak_live_bytes);
+  }
+  fprintf(file, "%zu of %zu frames allocated nothing\n",
+          num_allocation_free_frames, num_frames);
+
+  if (table_size > 0) {
+    fprintf(file, "%zu allocations still live:\n", table_size);
+    size_t reported = 0;
+    for (size_t i = 0; i < table_capacity && reported < MAX_LEAKS_REPORTED;
+         i++) {
+      if (table[i].address != 0) {
+        fprintf(file, "  %p  %zu bytes  %s\n", (void *)table[i].address,
+                table[i].size,
+                SUBSYSTEM_NAMES[table[i].subsystem]);
+        reported++;
+      }
+    }
+    if (table_size > reported) {
+      fprintf(file, "  ...\n");
+    }
+  }
+  pthread_mutex_unlock(&lock);
+}
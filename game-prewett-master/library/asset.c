@@ -5,8 +5,13 @@
 #include "asset.h"
 #include "asset_cache.h"
 #include "color.h"
+#include "counters.h"
+#include "profiler.h"
 #include "sdl_wrapper.h"
 
+#define ALLOC_SUBSYSTEM ALLOC_ASSET
+#include "alloc_track.h"
+
 typedef struct asset {
   asset_type_t type;
   SDL_Rect bounding_box;
@@ -23,6 +28,9 @@ typedef struct image_asset {
   asset_t base;
   SDL_Texture *texture;
   body_t *body;
+  // Whether the image is drawn on each part of the body with part_tag
+  bool on_parts;
+  size_t part_tag;
 } image_asset_t;
 
 typedef struct button_asset {
@@ -30,7 +38,6 @@ typedef struct button_asset {
   image_asset_t *image_asset;
   text_asset_t *text_asset;
   button_handler_t handler;
-  bool is_rendered;
 } button_asset_t;
 
 /**
@@ -68,12 +75,15 @@ static asset_t *asset_init(asset_type_t ty, SDL_Rect bounding_box) {
 
 asset_type_t asset_get_type(asset_t *asset) { return asset->type; }
 
+SDL_Rect asset_get_bounding_box(asset_t *asset) { return asset->bounding_box; }
+
 asset_t *asset_make_image(const char *filepath, SDL_Rect bounding_box) {
   image_asset_t *img_asset =
       (image_asset_t *)asset_init(ASSET_IMAGE, bounding_box);
-  img_asset->texture =
-      (SDL_Texture *)asset_cache_obj_get_or_create(ASSET_IMAGE, filepath);
+  img_asset->texture = (SDL_Texture *)asset_cache_image_get_or_create(
+      filepath, bounding_box.w, bounding_box.h);
   img_asset->body = NULL;
+  img_asset->on_parts = false;
   assert(img_asset->texture);
 
   return (asset_t *)img_asset;
@@ -83,9 +93,35 @@ asset_t *asset_make_image_with_body(const char *filepath, body_t *body) {
   SDL_Rect arbitrary_rect = {0, 0, 0, 0};
   image_asset_t *img_asset =
       (image_asset_t *)asset_init(ASSET_IMAGE, arbitrary_rect);
-  img_asset->texture =
-      (SDL_Texture *)asset_cache_obj_get_or_create(ASSET_IMAGE, filepath);
+  // Bodies keep their size, so the texture can be sized to the body up front
+  SDL_Rect body_box = get_body_bounding_box(body);
+  img_asset->texture = (SDL_Texture *)asset_cache_image_get_or_create(
+      filepath, body_box.w, body_box.h);
   img_asset->body = body;
+  img_asset->on_parts = false;
+  assert(img_asset->texture);
+
+  return (asset_t *)img_asset;
+}
+
+asset_t *asset_make_image_with_part(const char *filepath, body_t *body,
+                                    size_t tag) {
+  SDL_Rect arbitrary_rect = {0, 0, 0, 0};
+  image_asset_t *img_asset =
+      (image_asset_t *)asset_init(ASSET_IMAGE, arbitrary_rect);
+  // Sized to the first tagged part; other sizes are scaled when drawn
+  SDL_Rect part_box = {0, 0, 0, 0};
+  for (size_t i = 0; i < body_num_parts(body); i++) {
+    if (body_get_part_tag(body, i) == tag) {
+      part_box = get_part_bounding_box(body, i);
+      break;
+    }
+  }
+  img_asset->texture = (SDL_Texture *)asset_cache_image_get_or_create(
+      filepath, part_box.w, part_box.h);
+  img_asset->body = body;
+  img_asset->on_parts = true;
+  img_asset->part_tag = tag;
   assert(img_asset->texture);
 
   return (asset_t *)img_asset;
@@ -121,7 +157,6 @@ asset_t *asset_make_button(SDL_Rect bounding_box, asset_t *image_asset,
   }
 
   new_button->handler = handler;
-  new_button->is_rendered = false;
   return (asset_t *)new_button;
 }
 
@@ -134,19 +169,31 @@ static bool is_point_in_rect(double x, double y, SDL_Rect rect) {
 void asset_on_button_click(asset_t *button, state_t *state, double x,
                            double y) {
   button_asset_t *button_asset = (button_asset_t *)button;
-  if (!button_asset->is_rendered) {
-    return;
-  }
   if (is_point_in_rect(x, y, button_asset->base.bounding_box)) {
     button_asset->handler(state);
   }
-  button_asset->is_rendered = false;
 }
 
 void asset_render(asset_t *asset) {
+  PROFILE_ZONE("asset_render");
+#ifdef HEADLESS
+  // There is no renderer to draw to
+  (void)asset;
+#else
   switch (asset->type) {
   case ASSET_IMAGE: {
     image_asset_t *img_asset = (image_asset_t *)asset;
+    if (img_asset->on_parts) {
+      body_t *body = img_asset->body;
+      for (size_t i = 0; i < body_num_parts(body); i++) {
+        if (body_get_part_tag(body, i) == img_asset->part_tag) {
+          SDL_Rect part_rect = get_part_bounding_box(body, i);
+          sdl_render(img_asset->texture, part_rect.x, part_rect.y,
+                     part_rect.w, part_rect.h);
+        }
+      }
+      break;
+    }
     SDL_Rect render_rect;
     if (img_asset->body != NULL) {
       render_rect = get_body_bounding_box(img_asset->body);
@@ -170,6 +217,7 @@ void asset_render(asset_t *asset) {
                    .y = (double)text_asset->base.bounding_box.y};
     text_display(texture, position);
     SDL_DestroyTexture(texture);
+    COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
     break;
   }
   case ASSET_BUTTON: {
@@ -178,10 +226,13 @@ void asset_render(asset_t *asset) {
     if (button_asset->text_asset) {
       asset_render((asset_t *)(button_asset->text_asset));
     }
-    button_asset->is_rendered = true;
     break;
   }
+  default: {
+    assert(false && "Asset type cannot be rendered");
+  }
   }
+#endif
 }
 
 void asset_destroy(asset_t *asset) { free(asset); }
@@ -1,12 +1,18 @@
 #include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_ttf.h>
 #include <assert.h>
 
 #include "asset.h"
 #include "asset_cache.h"
+#include "asset_pack.h"
+#include "counters.h"
 #include "list.h"
 #include "sdl_wrapper.h"
 
+#define ALLOC_SUBSYSTEM ALLOC_ASSET
+#include "alloc_track.h"
+
 static list_t *ASSET_CACHE;
 
 const size_t FONT_SIZE = 18;
@@ -15,6 +21,9 @@ const size_t INITIAL_CAPACITY = 5;
 typedef struct {
   asset_type_t type;
   const char *filepath;
+  // Size images were resampled to, or 0 if they were loaded at full size
+  int width;
+  int height;
   void *obj;
 } entry_t;
 
@@ -26,15 +35,22 @@ static void asset_cache_free_entry(entry_t *entry) {
   switch (entry->type) {
   case ASSET_IMAGE: {
     SDL_DestroyTexture((SDL_Texture *)entry->obj);
+    COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
     break;
   }
   case ASSET_FONT: {
     TTF_CloseFont((TTF_Font *)entry->obj);
     break;
   }
-  case ASSET_BUTTON: {
-    // FREEING IMAGE ASSET WITHIN BUTTON ASSET
-    free(entry->obj);
+  case ASSET_MUSIC: {
+    Mix_FreeMusic((Mix_Music *)entry->obj);
+    break;
+  }
+  case ASSET_SOUND: {
+    Mix_FreeChunk((Mix_Chunk *)entry->obj);
+    break;
+  }
+  default: {
     break;
   }
   }
@@ -49,11 +65,13 @@ void asset_cache_init() {
 void asset_cache_destroy() { list_free(ASSET_CACHE); }
 
 // helper function for asset_cache_obj_get_or_create
-void *already_exists(asset_type_t ty, const char *filepath) {
+void *already_exists(asset_type_t ty, const char *filepath, int width,
+                     int height) {
   for (size_t i = 0; i < list_size(ASSET_CACHE); i++) {
     entry_t *entry = (entry_t *)list_get(ASSET_CACHE, i);
     assert(entry != NULL);
-    if (entry->filepath && strcmp(entry->filepath, filepath) == 0) {
+    if (entry->filepath && strcmp(entry->filepath, filepath) == 0 &&
+        entry->width == width && entry->height == height) {
       assert(entry->type == ty);
       return entry->obj;
     }
@@ -61,8 +79,15 @@ void *already_exists(asset_type_t ty, const char *filepath) {
   return NULL;
 }
 
-void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath) {
-  void *exist_object = already_exists(ty, filepath);
+static void *get_or_create(asset_type_t ty, const char *filepath, int width,
+                           int height) {
+#ifdef HEADLESS
+  // Nothing is drawn or played without a window, so nothing is loaded. Every
+  // asset shares a placeholder, which is never dereferenced.
+  static char placeholder;
+  return &placeholder;
+#endif
+  void *exist_object = already_exists(ty, filepath, width, height);
   if (exist_object != NULL) {
     return exist_object;
   }
@@ -71,17 +96,39 @@ void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath) {
   assert(new_entry != NULL);
   new_entry->type = ty;
   new_entry->filepath = filepath;
+  new_entry->width = width;
+  new_entry->height = height;
 
+  // Archived assets are read straight out of the mapped archive; anything
+  // missing from it falls back to the loose file.
+  SDL_RWops *rw = asset_pack_open_rw(filepath);
   switch (ty) {
   case ASSET_IMAGE: {
-    new_entry->obj = sdl_display(filepath);
+    if (rw == NULL) {
+      rw = SDL_RWFromFile(filepath, "rb");
+    }
+    new_entry->obj =
+        sdl_load_texture(rw, width, height, SDL_PIXELFORMAT_UNKNOWN);
     break;
   }
   case ASSET_FONT: {
-    new_entry->obj = TTF_OpenFont(filepath, FONT_SIZE);
+    new_entry->obj = rw ? TTF_OpenFontRW(rw, 1, FONT_SIZE)
+                        : TTF_OpenFont(filepath, FONT_SIZE);
+    break;
+  }
+  case ASSET_MUSIC: {
+    new_entry->obj = rw ? Mix_LoadMUS_RW(rw, 1) : Mix_LoadMUS(filepath);
+    break;
+  }
+  case ASSET_SOUND: {
+    new_entry->obj = rw ? Mix_LoadWAV_RW(rw, 1) : Mix_LoadWAV(filepath);
     break;
   }
   default: {
+    if (rw) {
+      SDL_RWclose(rw);
+    }
+    free(new_entry);
     return NULL;
   }
   }
@@ -89,24 +136,11 @@ void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath) {
   return new_entry->obj;
 }
 
-void asset_cache_register_button(asset_t *button) {
-
-  entry_t *new_entry = malloc(sizeof(entry_t));
-  assert(new_entry != NULL);
-  assert(asset_get_type(button) == ASSET_BUTTON);
-  new_entry->type = ASSET_BUTTON;
-  new_entry->filepath = NULL;
-  new_entry->obj = button;
-
-  list_add(ASSET_CACHE, new_entry);
+void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath) {
+  return get_or_create(ty, filepath, 0, 0);
 }
 
-void asset_cache_handle_buttons(state_t *state, double x, double y) {
-
-  for (size_t i = 0; i < list_size(ASSET_CACHE); i++) {
-    entry_t *entry = (entry_t *)list_get(ASSET_CACHE, i);
-    if (entry && entry->type == ASSET_BUTTON) {
-      asset_on_button_click(entry->obj, state, x, y);
-    }
-  }
-}
\ No newline at end of file
+void *asset_cache_image_get_or_create(const char *filepath, int width,
+                                      int height) {
+  return get_or_create(ASSET_IMAGE, filepath, width, height);
+}
@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset_pack.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ALLOC_SUBSYSTEM ALLOC_ASSET
+#include "alloc_track.h"
+
+static const uint8_t *PACK_DATA = NULL;
+static size_t PACK_SIZE = 0;
+static const pack_entry_t *PACK_ENTRIES = NULL;
+static size_t PACK_NUM_ENTRIES = 0;
+
+#ifdef _WIN32
+// No mmap on Windows, so the archive is read into memory in one go instead
+static const uint8_t *map_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long length = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = malloc(length);
+  assert(data);
+  if (fread(data, 1, length, f) != (size_t)length) {
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *size = length;
+  return data;
+}
+
+static void unmap_file(const uint8_t *data, size_t size) { free((void *)data); }
+#else
+static const uint8_t *map_file(const char *path, size_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive, so the descriptor is not needed
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  *size = info.st_size;
+  return data;
+}
+
+static void unmap_file(const uint8_t *data, size_t size) {
+  munmap((void *)data, size);
+}
+#endif
+
+bool asset_pack_open(const char *path) {
+  asset_pack_close();
+
+  size_t size = 0;
+  const uint8_t *data = map_file(path, &size);
+  if (data == NULL) {
+    return false;
+  }
+
+  const pack_header_t *header = (const pack_header_t *)data;
+  size_t index_end = sizeof(pack_header_t);
+  if (size >= index_end) {
+    index_end += (size_t)header->num_entries * sizeof(pack_entry_t);
+  }
+  if (size < sizeof(pack_header_t) ||
+      memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != PACK_VERSION || size < index_end) {
+    fprintf(stderr, "Ignoring invalid asset archive %s\n", path);
+    unmap_file(data, size);
+    return false;
+  }
+
+  PACK_DATA = data;
+  PACK_SIZE = size;
+  PACK_ENTRIES = (const pack_entry_t *)(data + sizeof(pack_header_t));
+  PACK_NUM_ENTRIES = header->num_entries;
+  return true;
+}
+
+void asset_pack_close(void) {
+  if (PACK_DATA == NULL) {
+    return;
+  }
+  unmap_file(PACK_DATA, PACK_SIZE);
+  PACK_DATA = NULL;
+  PACK_SIZE = 0;
+  PACK_ENTRIES = NULL;
+  PACK_NUM_ENTRIES = 0;
+}
+
+// helper function for bsearch over the archive index
+static int compare_entry_name(const void *name, const void *entry) {
+  return strncmp((const char *)name, ((const pack_entry_t *)entry)->name,
+                 PACK_NAME_LEN);
+}
+
+const void *asset_pack_find(const char *name, size_t *size) {
+  if (PACK_DATA == NULL) {
+    return NULL;
+  }
+  const pack_entry_t *entry =
+      bsearch(name, PACK_ENTRIES, PACK_NUM_ENTRIES, sizeof(pack_entry_t),
+              compare_entry_name);
+  // Compared so that a corrupt offset or size cannot wrap around
+  if (entry == NULL || entry->offset > PACK_SIZE ||
+      entry->size > PACK_SIZE - entry->offset) {
+    return NULL;
+  }
+  *size = entry->size;
+  return PACK_DATA + entry->offset;
+}
+
+SDL_RWops *asset_pack_open_rw(const char *name) {
+  size_t size = 0;
+  const void *data = asset_pack_find(name, &size);
+  if (data == NULL) {
+    return NULL;
+  }
+  return SDL_RWFromConstMem(data, (int)size);
+}
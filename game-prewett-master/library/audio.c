@@ -0,0 +1,97 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <assert.h>
+#include <stdio.h>
+
+#include "asset_cache.h"
+#include "audio.h"
+#include "startup.h"
+
+const int AUDIO_FREQUENCY = 44100;
+const int AUDIO_CHANNELS = 2;
+const int AUDIO_CHUNK_SIZE = 2048;
+const int EFFECT_CHANNEL = 1;
+const int LOOP_FOREVER = -1;
+
+#ifdef HEADLESS
+// Headless builds have no audio device, so sounds are dropped
+void audio_init(void) {}
+
+void audio_quit(void) {}
+
+void audio_play_music(const char *filepath) {}
+
+void audio_restart_music(void) {}
+
+void audio_stop_music(void) {}
+
+void audio_play_effect(const char *filepath) {}
+#else
+static bool audio_opened = false;
+static Mix_Music *current_music = NULL;
+
+void audio_init(void) {
+  if (audio_opened) {
+    return;
+  }
+  startup_begin(STARTUP_AUDIO);
+  SDL_InitSubSystem(SDL_INIT_AUDIO);
+  // The music is streamed from OGG, so it cannot play without the decoder
+  if ((Mix_Init(MIX_INIT_OGG | MIX_INIT_MP3) & MIX_INIT_OGG) == 0) {
+    fprintf(stderr, "Couldn't load the OGG decoder: %s\n", Mix_GetError());
+  }
+  Mix_OpenAudio(AUDIO_FREQUENCY, MIX_DEFAULT_FORMAT, AUDIO_CHANNELS,
+                AUDIO_CHUNK_SIZE);
+  audio_opened = true;
+  startup_end(STARTUP_AUDIO);
+}
+
+void audio_quit(void) {
+  if (!audio_opened) {
+    return;
+  }
+  Mix_HaltMusic();
+  current_music = NULL;
+  Mix_CloseAudio();
+  Mix_Quit();
+  audio_opened = false;
+}
+
+void audio_play_music(const char *filepath) {
+  audio_init();
+  Mix_Music *music =
+      (Mix_Music *)asset_cache_obj_get_or_create(ASSET_MUSIC, filepath);
+  assert(music);
+  if (music == current_music && Mix_PlayingMusic()) {
+    Mix_RewindMusic();
+    return;
+  }
+  current_music = music;
+  Mix_PlayMusic(current_music, LOOP_FOREVER);
+}
+
+void audio_restart_music(void) {
+  if (current_music == NULL) {
+    return;
+  }
+  if (Mix_PlayingMusic()) {
+    Mix_RewindMusic();
+  } else {
+    Mix_PlayMusic(current_music, LOOP_FOREVER);
+  }
+}
+
+void audio_stop_music(void) {
+  if (Mix_PlayingMusic()) {
+    Mix_HaltMusic();
+  }
+}
+
+void audio_play_effect(const char *filepath) {
+  audio_init();
+  Mix_Chunk *chunk =
+      (Mix_Chunk *)asset_cache_obj_get_or_create(ASSET_SOUND, filepath);
+  assert(chunk);
+  Mix_PlayChannel(EFFECT_CHANNEL, chunk, 0);
+}
+#endif
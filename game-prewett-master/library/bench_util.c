@@ -0,0 +1,110 @@
+#include "bench_util.h"
+#include "clock.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const bench_options_t BENCH_DEFAULT_OPTIONS = {
+    .warmup_time = 0.05, .min_repetition_time = 0.002, .repetitions = 21};
+const double BENCH_NS_PER_S = 1e9;
+
+// Written through a volatile pointer so the compiler must produce every value
+// passed to bench_consume()
+static volatile uint8_t bench_sink;
+
+// Times `iterations` iterations of func, in seconds
+static double time_iterations(bench_func_t func, void *aux,
+                              size_t iterations) {
+  double start = now_seconds();
+  func(aux, iterations);
+  return now_seconds() - start;
+}
+
+int bench_compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Sorts the values and gets their median
+static double sort_median(double *values, size_t n) {
+  qsort(values, n, sizeof(double), bench_compare_doubles);
+  return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+bench_result_t bench_run(const char *name, bench_func_t func, void *aux,
+                         const bench_options_t *options) {
+  assert(options->repetitions > 0);
+  size_t iterations = 1;
+  while (time_iterations(func, aux, iterations) <
+         options->min_repetition_time) {
+    iterations *= 2;
+  }
+
+  double warmup_end = now_seconds() + options->warmup_time;
+  while (now_seconds() < warmup_end) {
+    func(aux, iterations);
+  }
+
+  double *times = malloc(options->repetitions * sizeof(double));
+  assert(times);
+  for (size_t i = 0; i < options->repetitions; i++) {
+    times[i] =
+        time_iterations(func, aux, iterations) * BENCH_NS_PER_S / iterations;
+  }
+
+  bench_result_t result = {.name = name,
+                           .iterations = iterations,
+                           .repetitions = options->repetitions};
+  result.median_ns = sort_median(times, options->repetitions);
+  result.min_ns = times[0];
+  result.max_ns = times[options->repetitions - 1];
+  for (size_t i = 0; i < options->repetitions; i++) {
+    times[i] = fabs(times[i] - result.median_ns);
+  }
+  result.mad_ns = sort_median(times, options->repetitions);
+  free(times);
+  return result;
+}
+
+void bench_print_header(FILE *file, bench_format_t format) {
+  if (format == BENCH_TEXT) {
+    fprintf(file, "%-40s %12s %10s %12s %10s\n", "benchmark", "median ns",
+            "mad ns", "min ns", "iters");
+  }
+}
+
+void bench_print(FILE *file, const bench_result_t *result,
+                 bench_format_t format) {
+  switch (format) {
+  case BENCH_TEXT:
+    fprintf(file, "%-40s %12.2f %10.2f %12.2f %10zu\n", result->name,
+            result->median_ns, result->mad_ns, result->min_ns,
+            result->iterations);
+    break;
+  case BENCH_JSON:
+    fprintf(file,
+            "{\"name\":\"%s\",\"median_ns\":%.3f,\"mad_ns\":%.3f,"
+            "\"min_ns\":%.3f,\"max_ns\":%.3f,\"iterations\":%zu,"
+            "\"repetitions\":%zu}\n",
+            result->name, result->median_ns, result->mad_ns, result->min_ns,
+            result->max_ns, result->iterations, result->repetitions);
+    break;
+  }
+  fflush(file);
+}
+
+void bench_consume(const void *value, size_t size) {
+  const uint8_t *bytes = value;
+  uint8_t hash = 0;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+  }
+  bench_sink = hash;
+}
+
+bool bench_matches(const char *name, const char *filter) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
@@ -1,18 +1,45 @@
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "body.h"
 #include "polygon.h"
 
+#define ALLOC_SUBSYSTEM ALLOC_BODY
+#include "alloc_track.h"
+
 const double STARTING_ROT = 0.0;
+const size_t PARTS_INIT = 4;
+
+typedef struct body_part {
+  polygon_t *poly;
+  size_t tag;
+} body_part_t;
+
+// What body_save_state() writes, followed by the points of the body's shape
+// and then of each part
+typedef struct body_state {
+  vector_t velocity;
+  vector_t force;
+  vector_t impulse;
+  vector_t displacement;
+  bool removed;
+  bool asleep;
+} body_state_t;
 
 struct body {
   polygon_t *poly;
+  // NULL unless the body is compound
+  list_t *parts;
   double mass;
   vector_t force;
   vector_t impulse;
+  // How far the last body_tick() moved the body, for swept collisions
+  vector_t displacement;
   bool removed;
+  bool asleep;
+  bool continuous;
   void *info;
   free_func_t info_freer;
 };
@@ -23,10 +50,14 @@ body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
   assert(body != NULL);
   body->poly =
       polygon_init(shape, VEC_ZERO, STARTING_ROT, color.r, color.g, color.b);
+  body->parts = NULL;
   body->mass = mass;
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
+  body->displacement = VEC_ZERO;
   body->removed = false;
+  body->asleep = false;
+  body->continuous = false;
   body->info = info;
   body->info_freer = info_freer;
   return body;
@@ -40,9 +71,17 @@ polygon_t *body_get_polygon(body_t *body) { return body->poly; }
 
 void *body_get_info(body_t *body) { return body->info; }
 
+static void body_part_free(body_part_t *part) {
+  polygon_free(part->poly);
+  free(part);
+}
+
 void body_free(body_t *body) {
   if (body != NULL) {
     polygon_free(body->poly);
+    if (body->parts != NULL) {
+      list_free(body->parts);
+    }
     if (body->info_freer != NULL && body->info != NULL) {
       body->info_freer(body->info);
     }
@@ -83,7 +122,13 @@ void body_set_color(body_t *body, rgb_color_t *col) {
 }
 
 void body_set_centroid(body_t *body, vector_t x) {
-  polygon_set_center(body->poly, x);
+  vector_t translation = vec_subtract(x, body_get_centroid(body));
+  polygon_translate(body->poly, translation);
+  for (size_t i = 0; i < list_size(body->parts); i++) {
+    body_part_t *part = list_get(body->parts, i);
+    polygon_translate(part->poly, translation);
+  }
+  body->displacement = VEC_ZERO;
 }
 
 void body_set_velocity(body_t *body, vector_t v) {
@@ -95,7 +140,12 @@ double body_get_rotation(body_t *body) {
 }
 
 void body_set_rotation(body_t *body, double angle) {
+  vector_t centroid = body_get_centroid(body);
   polygon_set_rotation(body->poly, angle);
+  for (size_t i = 0; i < list_size(body->parts); i++) {
+    body_part_t *part = list_get(body->parts, i);
+    polygon_rotate(part->poly, angle, centroid);
+  }
 }
 
 void body_tick(body_t *body, double dt) {
@@ -110,6 +160,7 @@ void body_tick(body_t *body, double dt) {
   vector_t prev_center = vec_multiply(dt, avg_v);
   vector_t new_center = vec_add(body_get_centroid(body), prev_center);
   body_set_centroid(body, new_center);
+  body->displacement = prev_center;
 
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
@@ -129,7 +180,129 @@ void body_remove(body_t *body) { body->removed = true; }
 
 bool body_is_removed(body_t *body) { return body->removed; }
 
+vector_t body_get_displacement(body_t *body) { return body->displacement; }
+
+void body_set_continuous(body_t *body, bool continuous) {
+  body->continuous = continuous;
+}
+
+bool body_is_continuous(body_t *body) { return body->continuous; }
+
+void body_set_asleep(body_t *body, bool asleep) { body->asleep = asleep; }
+
+bool body_is_asleep(body_t *body) { return body->asleep; }
+
 void body_reset(body_t *body) {
   body->impulse = VEC_ZERO;
   body->force = VEC_ZERO;
-}
\ No newline at end of file
+}
+
+void body_add_part(body_t *body, list_t *shape, size_t tag) {
+  if (body->parts == NULL) {
+    body->parts = list_init(PARTS_INIT, (free_func_t)body_part_free);
+  }
+  body_part_t *part = malloc(sizeof(body_part_t));
+  assert(part != NULL);
+  part->poly = polygon_init(shape, VEC_ZERO, STARTING_ROT, 0, 0, 0);
+  part->tag = tag;
+  list_add(body->parts, part);
+}
+
+size_t body_num_parts(body_t *body) { return list_size(body->parts); }
+
+size_t body_get_part_tag(body_t *body, size_t part) {
+  return ((body_part_t *)list_get(body->parts, part))->tag;
+}
+
+polygon_t *body_get_part_polygon(body_t *body, size_t part) {
+  return ((body_part_t *)list_get(body->parts, part))->poly;
+}
+
+// Grows the box [min, max] to contain every point of a polygon
+static void extend_bounds(polygon_t *poly, vector_t *min, vector_t *max) {
+  list_t *points = polygon_get_points(poly);
+  for (size_t i = 0; i < list_size(points); i++) {
+    vector_t *point = list_get(points, i);
+    min->x = fmin(min->x, point->x);
+    min->y = fmin(min->y, point->y);
+    max->x = fmax(max->x, point->x);
+    max->y = fmax(max->y, point->y);
+  }
+}
+
+void body_get_bounds(body_t *body, vector_t *min, vector_t *max) {
+  *min = (vector_t){INFINITY, INFINITY};
+  *max = (vector_t){-INFINITY, -INFINITY};
+  extend_bounds(body->poly, min, max);
+  for (size_t i = 0; i < list_size(body->parts); i++) {
+    body_part_t *part = list_get(body->parts, i);
+    extend_bounds(part->poly, min, max);
+  }
+}
+
+void body_get_part_bounds(body_t *body, size_t part, vector_t *min,
+                          vector_t *max) {
+  *min = (vector_t){INFINITY, INFINITY};
+  *max = (vector_t){-INFINITY, -INFINITY};
+  extend_bounds(body_get_part_polygon(body, part), min, max);
+}
+
+size_t body_state_size(body_t *body) {
+  size_t num_points = list_size(polygon_get_points(body->poly));
+  for (size_t i = 0; i < list_size(body->parts); i++) {
+    body_part_t *part = list_get(body->parts, i);
+    num_points += list_size(polygon_get_points(part->poly));
+  }
+  return sizeof(body_state_t) + num_points * sizeof(vector_t);
+}
+
+// helper functions for body_save_state and body_load_state; each returns the
+// position after the points it copied
+static vector_t *save_points(polygon_t *poly, vector_t *out) {
+  list_t *points = polygon_get_points(poly);
+  for (size_t i = 0; i < list_size(points); i++) {
+    *out++ = *(vector_t *)list_get(points, i);
+  }
+  return out;
+}
+
+static const vector_t *load_points(polygon_t *poly, const vector_t *in) {
+  list_t *points = polygon_get_points(poly);
+  for (size_t i = 0; i < list_size(points); i++) {
+    *(vector_t *)list_get(points, i) = *in++;
+  }
+  return in;
+}
+
+void body_save_state(body_t *body, void *buffer) {
+  body_state_t *state = buffer;
+  state->velocity = body_get_velocity(body);
+  state->force = body->force;
+  state->impulse = body->impulse;
+  state->displacement = body->displacement;
+  state->removed = body->removed;
+  state->asleep = body->asleep;
+
+  vector_t *points = save_points(body->poly, (vector_t *)(state + 1));
+  for (size_t i = 0; i < list_size(body->parts); i++) {
+    body_part_t *part = list_get(body->parts, i);
+    points = save_points(part->poly, points);
+  }
+}
+
+void body_load_state(body_t *body, const void *buffer) {
+  const body_state_t *state = buffer;
+  body_set_velocity(body, state->velocity);
+  body->force = state->force;
+  body->impulse = state->impulse;
+  body->displacement = state->displacement;
+  body->removed = state->removed;
+  body->asleep = state->asleep;
+
+  const vector_t *points =
+      load_points(body->poly, (const vector_t *)(state + 1));
+  for (size_t i = 0; i < list_size(body->parts); i++) {
+    body_part_t *part = list_get(body->parts, i);
+    points = load_points(part->poly, points);
+  }
+}
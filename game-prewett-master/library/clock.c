@@ -0,0 +1,13 @@
+#include <time.h>
+
+#include "clock.h"
+
+const uint64_t CLOCK_NS_PER_S = 1000000000ULL;
+
+uint64_t now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * CLOCK_NS_PER_S + (uint64_t)now.tv_nsec;
+}
+
+double now_seconds(void) { return now_ns() / (double)CLOCK_NS_PER_S; }
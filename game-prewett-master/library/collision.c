@@ -1,32 +1,13 @@
 #include "collision.h"
 #include "body.h"
+#include "counters.h"
+#include "profiler.h"
 
 #include <assert.h>
 #include <float.h>
 #include <math.h>
 #include <stdlib.h>
 
-/**
- * Returns a list of vectors representing the edges of a shape.
- *
- * @param shape the list of vectors representing the vertices of a shape
- * @return a list of vectors representing the edges of the shape
- */
-static list_t *get_edges(list_t *shape) {
-  list_t *edges = list_init(list_size(shape), free);
-
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    *vec =
-        vec_subtract(*(vector_t *)list_get(shape, i % list_size(shape)),
-                     *(vector_t *)list_get(shape, (i + 1) % list_size(shape)));
-    list_add(edges, vec);
-  }
-
-  return edges;
-}
-
 /**
  * Returns a vector containing the maximum and minimum length projections given
  * a unit axis and shape.
@@ -69,12 +50,15 @@ static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
  */
 static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
                                           double *min_overlap) {
-  list_t *edges1 = get_edges(shape1);
-  collision_info_t collision = {true, {0, 0}};
+  collision_info_t collision = {true, {0, 0}, 1};
+  size_t num_vertices = list_size(shape1);
 
-  for (size_t i = 0; i < list_size(edges1); i++) {
-    vector_t *edge = (vector_t *)list_get(edges1, i);
-    vector_t axis = {-edge->y, edge->x}; // Perpendicular axis
+  for (size_t i = 0; i < num_vertices; i++) {
+    // Edges are computed in place so collision tests never allocate
+    vector_t edge =
+        vec_subtract(*(vector_t *)list_get(shape1, i),
+                     *(vector_t *)list_get(shape1, (i + 1) % num_vertices));
+    vector_t axis = {-edge.y, edge.x}; // Perpendicular axis
     double axis_length = vec_get_length(axis);
     vector_t unit_axis = {axis.x / axis_length, axis.y / axis_length};
 
@@ -100,7 +84,6 @@ static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
     double overlap = max_proj1 - min_proj2;
 
     if (overlap < 0) {
-      list_free(edges1);
       collision.collided = false;
       return collision;
     } else {
@@ -110,28 +93,32 @@ static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
       }
     }
   }
-  list_free(edges1);
   return collision;
 }
 
-collision_info_t find_collision(body_t *body1, body_t *body2) {
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
-
+/**
+ * Runs the separating axis test on two convex shapes in both directions.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+static collision_info_t find_shape_collision(list_t *shape1, list_t *shape2) {
   double c1_overlap = __DBL_MAX__;
   double c2_overlap = __DBL_MAX__;
 
+  COUNTER_INC(COUNTER_SAT_TESTS);
+  // A separating axis from either shape settles it, so the other shape's
+  // axes need not be tried
   collision_info_t collision1 = compare_collision(shape1, shape2, &c1_overlap);
-  collision_info_t collision2 = compare_collision(shape2, shape1, &c2_overlap);
-
-  list_free(shape1);
-  list_free(shape2);
-
   if (!collision1.collided) {
+    COUNTER_INC(COUNTER_SAT_EARLY_OUTS);
     return collision1;
   }
 
+  collision_info_t collision2 = compare_collision(shape2, shape1, &c2_overlap);
   if (!collision2.collided) {
+    COUNTER_INC(COUNTER_SAT_EARLY_OUTS);
     return collision2;
   }
 
@@ -140,3 +127,176 @@ collision_info_t find_collision(body_t *body1, body_t *body2) {
   }
   return collision2;
 }
+
+collision_info_t find_collision(body_t *body1, body_t *body2) {
+  PROFILE_ZONE("find_collision");
+  // The shapes are only read, so the polygons' own points can be tested
+  list_t *shape1 = polygon_get_points(body_get_polygon(body1));
+  list_t *shape2 = polygon_get_points(body_get_polygon(body2));
+  return find_shape_collision(shape1, shape2);
+}
+
+// helper function for the bounding box tests
+static bool boxes_overlap(vector_t min1, vector_t max1, vector_t min2,
+                          vector_t max2) {
+  return min1.x <= max2.x && min2.x <= max1.x && min1.y <= max2.y &&
+         min2.y <= max1.y;
+}
+
+bool bounds_overlap(body_t *body1, body_t *body2) {
+  vector_t min1, max1, min2, max2;
+  body_get_bounds(body1, &min1, &max1);
+  body_get_bounds(body2, &min2, &max2);
+  return boxes_overlap(min1, max1, min2, max2);
+}
+
+static vector_t get_relative_motion(body_t *body1, body_t *body2) {
+  return vec_subtract(body_get_displacement(body1),
+                      body_get_displacement(body2));
+}
+
+bool swept_bounds_overlap(body_t *body1, body_t *body2) {
+  vector_t min1, max1, min2, max2;
+  body_get_bounds(body1, &min1, &max1);
+  body_get_bounds(body2, &min2, &max2);
+  vector_t motion = get_relative_motion(body1, body2);
+  // Covers both where body1 started and where it ended
+  min1 = (vector_t){min1.x - fmax(motion.x, 0), min1.y - fmax(motion.y, 0)};
+  max1 = (vector_t){max1.x - fmin(motion.x, 0), max1.y - fmin(motion.y, 0)};
+  return boxes_overlap(min1, max1, min2, max2);
+}
+
+collision_info_t find_part_collision(body_t *body1, body_t *body2,
+                                     size_t part) {
+  PROFILE_ZONE("find_part_collision");
+  list_t *shape1 = polygon_get_points(body_get_polygon(body1));
+  list_t *shape2 = polygon_get_points(body_get_part_polygon(body2, part));
+  return find_shape_collision(shape1, shape2);
+}
+
+// Gets the bounding box of a shape
+static void get_shape_bounds(list_t *shape, vector_t *min, vector_t *max) {
+  *min = (vector_t){INFINITY, INFINITY};
+  *max = (vector_t){-INFINITY, -INFINITY};
+  for (size_t i = 0; i < list_size(shape); i++) {
+    vector_t *vertex = list_get(shape, i);
+    min->x = fmin(min->x, vertex->x);
+    min->y = fmin(min->y, vertex->y);
+    max->x = fmax(max->x, vertex->x);
+    max->y = fmax(max->y, vertex->y);
+  }
+}
+
+/**
+ * Finds when two intervals overlap along one axis while the first moves by
+ * `motion` and ends at [min1, max1].
+ *
+ * @return false if they never overlap; otherwise entry and exit are set to
+ * the fractions of the motion at which the overlap starts and ends
+ */
+static bool sweep_interval(double min1, double max1, double min2, double max2,
+                           double motion, double *entry, double *exit) {
+  if (motion == 0) {
+    *entry = -INFINITY;
+    *exit = INFINITY;
+    return min1 <= max2 && min2 <= max1;
+  }
+  double start_min = min1 - motion;
+  double start_max = max1 - motion;
+  if (motion > 0) {
+    *entry = (min2 - start_max) / motion;
+    *exit = (max2 - start_min) / motion;
+  } else {
+    *entry = (max2 - start_min) / motion;
+    *exit = (min2 - start_max) / motion;
+  }
+  // Edges that only touch overlap, as in the separating axis test, so a zero
+  // gap at either end of the motion is not lost to rounding in the division
+  if (start_min <= max2 && min2 <= start_max) {
+    *entry = fmin(*entry, 0);
+    *exit = fmax(*exit, 0);
+  }
+  if (min1 <= max2 && min2 <= max1) {
+    *entry = fmin(*entry, 1);
+    *exit = fmax(*exit, 1);
+  }
+  return true;
+}
+
+/**
+ * Swept bounding box test between two shapes, where `motion` is how far
+ * shape1 moved relative to shape2 during the last tick.
+ */
+static collision_info_t sweep_shapes(list_t *shape1, list_t *shape2,
+                                     vector_t motion) {
+  collision_info_t collision = {false, {0, 0}, 0};
+  vector_t min1, max1, min2, max2;
+  get_shape_bounds(shape1, &min1, &max1);
+  get_shape_bounds(shape2, &min2, &max2);
+
+  double entry_x, exit_x, entry_y, exit_y;
+  if (!sweep_interval(min1.x, max1.x, min2.x, max2.x, motion.x, &entry_x,
+                      &exit_x) ||
+      !sweep_interval(min1.y, max1.y, min2.y, max2.y, motion.y, &entry_y,
+                      &exit_y)) {
+    return collision;
+  }
+  // The boxes touch once they overlap on both axes
+  double entry = fmax(entry_x, entry_y);
+  double exit = fmin(exit_x, exit_y);
+  if (entry > exit || entry > 1 || exit < 0) {
+    return collision;
+  }
+
+  collision.collided = true;
+  collision.time = fmax(entry, 0);
+  // The axis that started overlapping last is the one they met along
+  if (entry_x > entry_y) {
+    collision.axis = (vector_t){motion.x > 0 ? 1 : -1, 0};
+  } else if (motion.y != 0) {
+    collision.axis = (vector_t){0, motion.y > 0 ? 1 : -1};
+  } else {
+    // Already overlapping at the start of the tick, so there is no entry
+    // axis; use the direction between the boxes' centers
+    vector_t offset = vec_subtract(vec_add(min2, max2), vec_add(min1, max1));
+    double length = vec_get_length(offset);
+    collision.axis =
+        length > 0 ? vec_multiply(1 / length, offset) : (vector_t){1, 0};
+  }
+  return collision;
+}
+
+collision_info_t find_swept_collision(body_t *body1, body_t *body2) {
+  list_t *shape1 = polygon_get_points(body_get_polygon(body1));
+  list_t *shape2 = polygon_get_points(body_get_polygon(body2));
+  return sweep_shapes(shape1, shape2, get_relative_motion(body1, body2));
+}
+
+collision_info_t find_swept_part_collision(body_t *body1, body_t *body2,
+                                           size_t part) {
+  list_t *shape1 = polygon_get_points(body_get_polygon(body1));
+  list_t *shape2 = polygon_get_points(body_get_part_polygon(body2, part));
+  return sweep_shapes(shape1, shape2, get_relative_motion(body1, body2));
+}
+
+collision_info_t find_tagged_collision(body_t *body1, body_t *body2,
+                                       size_t tag) {
+  collision_info_t collision = {false, {0, 0}, 0};
+  vector_t min1, max1;
+  body_get_bounds(body1, &min1, &max1);
+  for (size_t i = 0; i < body_num_parts(body2); i++) {
+    if (body_get_part_tag(body2, i) != tag) {
+      continue;
+    }
+    vector_t min2, max2;
+    body_get_part_bounds(body2, i, &min2, &max2);
+    if (!boxes_overlap(min1, max1, min2, max2)) {
+      continue;
+    }
+    collision = find_part_collision(body1, body2, i);
+    if (collision.collided) {
+      break;
+    }
+  }
+  return collision;
+}
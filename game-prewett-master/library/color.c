@@ -5,6 +5,9 @@
 
 #include "color.h"
 
+#define ALLOC_SUBSYSTEM ALLOC_RENDER
+#include "alloc_track.h"
+
 const double COLOR_MAX = 255; // max value of each rgb value
 const double WHITE_MIX = 1;
 
@@ -0,0 +1,184 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "components.h"
+
+#define ALLOC_SUBSYSTEM ALLOC_GAME
+#include "alloc_track.h"
+
+const size_t COMPONENTS_INIT_CAPACITY = 16;
+const size_t NO_COMPONENT = (size_t)-1;
+
+typedef struct component_array {
+  size_t elem_size;
+  size_t count;
+  size_t capacity;
+  // Dense: the owner and data of each component, packed together
+  entity_t *entities;
+  uint8_t *data;
+  // Sparse: the dense index of each entity's component, or NO_COMPONENT
+  size_t *index_of;
+  size_t index_capacity;
+} component_array_t;
+
+struct component_store {
+  component_array_t arrays[NUM_COMPONENTS];
+  entity_t next_entity;
+  entity_t *free_ids;
+  size_t num_free_ids;
+  size_t free_capacity;
+};
+
+static const size_t COMPONENT_SIZES[NUM_COMPONENTS] = {
+    [COMPONENT_TAG] = sizeof(tag_component_t),
+    [COMPONENT_SPRITE] = sizeof(sprite_component_t),
+    [COMPONENT_COLLIDER] = sizeof(body_t *),
+    [COMPONENT_VELOCITY] = sizeof(vector_t),
+};
+
+component_store_t *component_store_init(void) {
+  component_store_t *store = malloc(sizeof(component_store_t));
+  assert(store != NULL);
+  for (size_t i = 0; i < NUM_COMPONENTS; i++) {
+    component_array_t *array = &store->arrays[i];
+    array->elem_size = COMPONENT_SIZES[i];
+    array->count = 0;
+    array->capacity = COMPONENTS_INIT_CAPACITY;
+    array->entities = malloc(array->capacity * sizeof(entity_t));
+    array->data = malloc(array->capacity * array->elem_size);
+    array->index_capacity = COMPONENTS_INIT_CAPACITY;
+    array->index_of = malloc(array->index_capacity * sizeof(size_t));
+    assert(array->entities && array->data && array->index_of);
+    for (size_t j = 0; j < array->index_capacity; j++) {
+      array->index_of[j] = NO_COMPONENT;
+    }
+  }
+  store->next_entity = 0;
+  store->free_capacity = COMPONENTS_INIT_CAPACITY;
+  store->free_ids = malloc(store->free_capacity * sizeof(entity_t));
+  assert(store->free_ids != NULL);
+  store->num_free_ids = 0;
+  return store;
+}
+
+void component_store_free(component_store_t *store) {
+  for (size_t i = 0; i < NUM_COMPONENTS; i++) {
+    free(store->arrays[i].entities);
+    free(store->arrays[i].data);
+    free(store->arrays[i].index_of);
+  }
+  free(store->free_ids);
+  free(store);
+}
+
+entity_t entity_create(component_store_t *store) {
+  if (store->num_free_ids > 0) {
+    return store->free_ids[--store->num_free_ids];
+  }
+  return store->next_entity++;
+}
+
+void entity_destroy(component_store_t *store, entity_t entity) {
+  for (size_t i = 0; i < NUM_COMPONENTS; i++) {
+    component_remove(store, i, entity);
+  }
+  if (store->num_free_ids == store->free_capacity) {
+    store->free_capacity *= 2;
+    store->free_ids =
+        realloc(store->free_ids, store->free_capacity * sizeof(entity_t));
+    assert(store->free_ids != NULL);
+  }
+  store->free_ids[store->num_free_ids++] = entity;
+}
+
+// helper function for the lookups; NO_COMPONENT if the entity has none
+static size_t index_of(component_array_t *array, entity_t entity) {
+  if (entity >= array->index_capacity) {
+    return NO_COMPONENT;
+  }
+  return array->index_of[entity];
+}
+
+void *component_add(component_store_t *store, component_type_t type,
+                    entity_t entity) {
+  component_array_t *array = &store->arrays[type];
+  size_t index = index_of(array, entity);
+  if (index != NO_COMPONENT) {
+    return array->data + index * array->elem_size;
+  }
+
+  if (entity >= array->index_capacity) {
+    size_t old_capacity = array->index_capacity;
+    while (entity >= array->index_capacity) {
+      array->index_capacity *= 2;
+    }
+    array->index_of =
+        realloc(array->index_of, array->index_capacity * sizeof(size_t));
+    assert(array->index_of != NULL);
+    for (size_t i = old_capacity; i < array->index_capacity; i++) {
+      array->index_of[i] = NO_COMPONENT;
+    }
+  }
+  if (array->count == array->capacity) {
+    array->capacity *= 2;
+    array->entities =
+        realloc(array->entities, array->capacity * sizeof(entity_t));
+    array->data = realloc(array->data, array->capacity * array->elem_size);
+    assert(array->entities && array->data);
+  }
+
+  index = array->count++;
+  array->entities[index] = entity;
+  array->index_of[entity] = index;
+  void *data = array->data + index * array->elem_size;
+  memset(data, 0, array->elem_size);
+  return data;
+}
+
+void component_remove(component_store_t *store, component_type_t type,
+                      entity_t entity) {
+  component_array_t *array = &store->arrays[type];
+  size_t index = index_of(array, entity);
+  if (index == NO_COMPONENT) {
+    return;
+  }
+
+  // Keep the array packed by moving the last component into the hole
+  size_t last = --array->count;
+  if (index != last) {
+    entity_t moved = array->entities[last];
+    array->entities[index] = moved;
+    memcpy(array->data + index * array->elem_size,
+           array->data + last * array->elem_size, array->elem_size);
+    array->index_of[moved] = index;
+  }
+  array->index_of[entity] = NO_COMPONENT;
+}
+
+void *component_get(component_store_t *store, component_type_t type,
+                    entity_t entity) {
+  component_array_t *array = &store->arrays[type];
+  size_t index = index_of(array, entity);
+  if (index == NO_COMPONENT) {
+    return NULL;
+  }
+  return array->data + index * array->elem_size;
+}
+
+size_t component_count(component_store_t *store, component_type_t type) {
+  return store->arrays[type].count;
+}
+
+entity_t component_entity(component_store_t *store, component_type_t type,
+                          size_t index) {
+  assert(index < store->arrays[type].count);
+  return store->arrays[type].entities[index];
+}
+
+void *component_at(component_store_t *store, component_type_t type,
+                   size_t index) {
+  component_array_t *array = &store->arrays[type];
+  assert(index < array->count);
+  return array->data + index * array->elem_size;
+}
@@ -0,0 +1,86 @@
+#include "counters.h"
+#include <stdbool.h>
+
+static const char *const COUNTER_NAMES[NUM_COUNTERS] = {
+    [COUNTER_FORCE_CREATORS] = "force_creators",
+    [COUNTER_SAT_TESTS] = "sat_tests",
+    [COUNTER_SAT_EARLY_OUTS] = "sat_early_outs",
+    [COUNTER_COLLISIONS_ENTERED] = "collisions_entered",
+    [COUNTER_COLLISIONS_EXITED] = "collisions_exited",
+    [COUNTER_BODIES_INTEGRATED] = "bodies_integrated",
+    [COUNTER_BODIES_REMOVED] = "bodies_removed",
+    [COUNTER_TEXTURES_CREATED] = "textures_created",
+    [COUNTER_TEXTURES_DESTROYED] = "textures_destroyed",
+    [COUNTER_DRAW_CALLS] = "draw_calls",
+    [COUNTER_TEXT_RASTERIZATIONS] = "text_rasterizations",
+};
+
+// The frames a thread has ended
+typedef struct {
+  // The last frame is at (num_frames - 1) % COUNTERS_WINDOW
+  uint64_t frames[COUNTERS_WINDOW][NUM_COUNTERS];
+  size_t num_frames;
+  // Sums over the frames in the window, and over every ended frame
+  uint64_t window[NUM_COUNTERS];
+  uint64_t totals[NUM_COUNTERS];
+  FILE *csv;
+} counters_history_t;
+
+_Thread_local uint64_t counters_current[NUM_COUNTERS];
+static _Thread_local counters_history_t history;
+
+void counters_end_frame(void) {
+  uint64_t *frame = history.frames[history.num_frames % COUNTERS_WINDOW];
+  bool is_window_full = history.num_frames >= COUNTERS_WINDOW;
+  for (size_t i = 0; i < NUM_COUNTERS; i++) {
+    // The slot being reused holds the frame that leaves the window
+    if (is_window_full) {
+      history.window[i] -= frame[i];
+    }
+    frame[i] = counters_current[i];
+    history.window[i] += frame[i];
+    history.totals[i] += frame[i];
+    counters_current[i] = 0;
+  }
+
+  if (history.csv != NULL) {
+    fprintf(history.csv, "%zu", history.num_frames);
+    for (size_t i = 0; i < NUM_COUNTERS; i++) {
+      fprintf(history.csv, ",%llu", (unsigned long long)frame[i]);
+    }
+    fprintf(history.csv, "\n");
+  }
+  history.num_frames++;
+}
+
+uint64_t counters_last_frame(counter_t counter) {
+  if (history.num_frames == 0) {
+    return 0;
+  }
+  return history.frames[(history.num_frames - 1) % COUNTERS_WINDOW][counter];
+}
+
+uint64_t counters_window(counter_t counter) { return history.window[counter]; }
+
+size_t counters_window_frames(void) {
+  return history.num_frames < COUNTERS_WINDOW ? history.num_frames
+                                              : COUNTERS_WINDOW;
+}
+
+uint64_t counters_total(counter_t counter) {
+  return history.totals[counter] + counters_current[counter];
+}
+
+const char *counters_name(counter_t counter) { return COUNTER_NAMES[counter]; }
+
+void counters_log_csv(FILE *file) {
+  history.csv = file;
+  if (file == NULL) {
+    return;
+  }
+  fprintf(file, "frame");
+  for (size_t i = 0; i < NUM_COUNTERS; i++) {
+    fprintf(file, ",%s", COUNTER_NAMES[i]);
+  }
+  fprintf(file, "\n");
+}
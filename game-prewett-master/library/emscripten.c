@@ -1,4 +1,7 @@
+#include "clock.h"
+#include "counters.h"
 #include "math.h"
+#include "pacer.h"
 #include "sdl_wrapper.h"
 #include "state.h"
 #include <stdio.h>
@@ -9,8 +12,72 @@
 #include <emscripten.h>
 #endif
 
+#include "alloc_track.h"
+
+#ifdef HEADLESS
+#include <stdint.h>
+
+/**
+ * Built with -DHEADLESS, the demo runs without a window or audio device:
+ * nothing is loaded, drawn or played, and the simulation is stepped as fast
+ * as possible instead of in real time.
+ *
+ * Usage: <demo> [simulated_seconds]
+ *
+ * Set GD_REPLAY to fast-forward through a recorded run instead of letting the
+ * dasher run into obstacles on its own.
+ */
+const double DEFAULT_SIMULATED_SECONDS = 600;
+
+int main(int argc, char **argv) {
+  double target = argc > 1 ? atof(argv[1]) : DEFAULT_SIMULATED_SECONDS;
+  state_t *state = emscripten_init();
+
+  double start = now_seconds();
+  double simulated = 0;
+  double step = 0;
+  uint64_t steps = 0;
+  // Half a step of slack so rounding does not add a step past the target
+  while (simulated + step / 2 < target) {
+    step = emscripten_step(state);
+    if (step == 0) {
+      break;
+    }
+    simulated += step;
+    steps++;
+    // Each step stands in for a frame, since nothing is drawn
+    counters_end_frame();
+#ifdef ALLOC_TRACK
+    alloc_track_end_frame();
+#endif
+  }
+  double elapsed = now_seconds() - start;
+
+  printf("Simulated %.1f s in %llu steps and %.3f s of wall time "
+         "(%.0f simulated s per wall s)\n",
+         simulated, (unsigned long long)steps, elapsed,
+         elapsed > 0 ? simulated / elapsed : 0);
+  emscripten_free(state);
+  return 0;
+}
+#else
 state_t *state;
 
+#ifndef __EMSCRIPTEN__
+/**
+ * Natively, frames are paced to GD_FPS frames per second, or DEFAULT_FPS if
+ * it is unset. GD_FPS=0 runs frames back to back, for benchmarking.
+ * In a browser, requestAnimationFrame paces them instead.
+ */
+const char *FPS_ENV = "GD_FPS";
+const double DEFAULT_FPS = 60;
+// While the demo is idle and the window is in the background, the loop sleeps
+// until an event arrives, waking at least this often (in seconds)
+const double IDLE_WAIT_TIMEOUT = 0.25;
+
+pacer_t *frame_pacer;
+#endif
+
 void loop() {
   // If needed, generate a pointer to our initial state
   if (!state) {
@@ -18,6 +85,14 @@ void loop() {
   }
 
   bool game_over = emscripten_main(state);
+#ifndef __EMSCRIPTEN__
+  if (emscripten_is_idle(state) && !sdl_is_window_active()) {
+    sdl_wait_event(IDLE_WAIT_TIMEOUT);
+    pacer_resume(frame_pacer);
+  } else {
+    pacer_end_frame(frame_pacer);
+  }
+#endif
 
   if (sdl_is_done((void *)state)) { // Once our demo exits...
     emscripten_free(state);         // Free any state variables we've been using
@@ -25,6 +100,8 @@ void loop() {
     emscripten_cancel_main_loop();
     emscripten_force_exit(0);
 #else
+    pacer_report(frame_pacer, stdout);
+    pacer_free(frame_pacer);
     exit(0);
 #endif
     return;
@@ -38,8 +115,11 @@ int main() {
   // Set loop as the function emscripten calls to request a new frame
   emscripten_set_main_loop_arg(loop, NULL, 0, 1);
 #else
+  const char *fps = getenv(FPS_ENV);
+  frame_pacer = pacer_init(fps != NULL ? atof(fps) : DEFAULT_FPS);
   while (1) {
     loop();
   }
 #endif
 }
+#endif
@@ -1,6 +1,8 @@
 #include "forces.h"
 #include "asset_cache.h"
 #include "collision.h"
+#include "counters.h"
+#include "profiler.h"
 #include "sdl_wrapper.h"
 
 #include <assert.h>
@@ -8,6 +10,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#define ALLOC_SUBSYSTEM ALLOC_COLLISION
+#include "alloc_track.h"
+
 const double MIN_DIST = 5;
 
 typedef struct body_aux {
@@ -60,6 +65,7 @@ void body_aux_free(void *aux) {
  * @param info auxiliary information about the force and associated bodies
  */
 static void newtonian_gravity(void *info) {
+  PROFILE_ZONE("newtonian_gravity");
   body_aux_t *aux = (body_aux_t *)info;
   vector_t displacement =
       vec_subtract(body_get_centroid(list_get(aux->bodies, 0)),
@@ -102,6 +108,7 @@ void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
  * @param info auxiliary information about the force and associated bodies
  */
 static void spring_force(void *info) {
+  PROFILE_ZONE("spring_force");
   body_aux_t *aux = info;
 
   double k = aux->force_const;
@@ -137,6 +144,7 @@ void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
  * @param info auxiliary information about the force and associated body
  */
 static void drag_force(void *info) {
+  PROFILE_ZONE("drag_force");
   body_aux_t *aux = (body_aux_t *)info;
   vector_t cons_force = vec_multiply(
       -1 * aux->force_const, body_get_velocity(list_get(aux->bodies, 0)));
@@ -154,6 +162,30 @@ void create_drag(scene_t *scene, double gamma, body_t *body) {
                                  bodies);
 }
 
+/**
+ * Moves whichever of two bodies is continuous back along its last tick to
+ * where they first touched, so a collision found by a swept test is handled
+ * as if the tick had stopped there.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param time when they first touched, from a swept collision_info_t
+ */
+static void move_to_contact(body_t *body1, body_t *body2, double time) {
+  vector_t motion = vec_subtract(body_get_displacement(body1),
+                                 body_get_displacement(body2));
+  vector_t rewind = vec_multiply(1 - time, motion);
+  if (body_is_continuous(body1)) {
+    body_set_centroid(body1, vec_subtract(body_get_centroid(body1), rewind));
+  } else {
+    body_set_centroid(body2, vec_add(body_get_centroid(body2), rewind));
+  }
+}
+
+static bool is_swept(body_t *body1, body_t *body2) {
+  return body_is_continuous(body1) || body_is_continuous(body2);
+}
+
 /**
  * The force creator for collisions. Checks if the bodies in the collision aux
  * are colliding, and if they do, runs the collision handler on the bodies.
@@ -161,6 +193,7 @@ void create_drag(scene_t *scene, double gamma, body_t *body) {
  * @param info auxiliary information about the force and associated body
  */
 static void collision_force_creator(void *collision_aux) {
+  PROFILE_ZONE("collision_force_creator");
   collision_aux_t *col_aux = collision_aux;
 
   list_t *bodies = col_aux->bodies;
@@ -171,14 +204,25 @@ static void collision_force_creator(void *collision_aux) {
   bool prev_collision = col_aux->collided;
 
   collision_info_t info = find_collision(body1, body2);
+  // A fast body may have passed all the way through the other during the
+  // last tick. Solid bodies move it back to where they met; triggers such
+  // as pickups only need to know that it passed.
+  if (!info.collided && !prev_collision && is_swept(body1, body2)) {
+    info = find_swept_collision(body1, body2);
+    if (info.collided && col_aux->handler == physics_collision_handler) {
+      move_to_contact(body1, body2, info.time);
+    }
+  }
   // avoids registering impulse multiple times while bodies are still colliding
   if (info.collided && !prev_collision) {
     collision_handler_t handler = col_aux->handler;
 
     handler(body1, body2, info.axis, col_aux->aux, col_aux->force_const);
     col_aux->collided = true;
+    COUNTER_INC(COUNTER_COLLISIONS_ENTERED);
   } else if (!info.collided && prev_collision) {
     col_aux->collided = false;
+    COUNTER_INC(COUNTER_COLLISIONS_EXITED);
   }
 }
 
@@ -196,8 +240,140 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
   collision_aux_t *collision_aux =
       collision_aux_init(force_const, aux_bodies, handler, false, aux);
 
-  scene_add_bodies_force_creator(scene, collision_force_creator, collision_aux,
-                                 bodies);
+  scene_add_stateful_force_creator(scene, collision_force_creator,
+                                   collision_aux, bodies,
+                                   &collision_aux->collided, sizeof(bool));
+}
+
+typedef struct compound_collision_aux {
+  double force_const;
+  list_t *bodies;
+  const collision_handler_t *handlers;
+  size_t num_handlers;
+  void *aux;
+  size_t num_parts;
+  bool collided[]; // one flag per part of the compound body
+} compound_collision_aux_t;
+
+// helper function for compound_collision_force_creator
+static bool is_handled(compound_collision_aux_t *col_aux, body_t *body2,
+                       size_t part) {
+  size_t tag = body_get_part_tag(body2, part);
+  return tag < col_aux->num_handlers && col_aux->handlers[tag] != NULL;
+}
+
+/**
+ * Finds the handled part that a fast body passed through first during the
+ * last tick without still touching it.
+ *
+ * @param col_aux the compound collision being checked
+ * @param collision set to the swept collision with that part
+ * @return the index of the part, or num_parts if there is none
+ */
+static size_t find_passed_part(compound_collision_aux_t *col_aux,
+                               collision_info_t *collision) {
+  body_t *body1 = list_get(col_aux->bodies, 0);
+  body_t *body2 = list_get(col_aux->bodies, 1);
+  size_t first = col_aux->num_parts;
+  for (size_t i = 0; i < col_aux->num_parts; i++) {
+    if (!is_handled(col_aux, body2, i) || col_aux->collided[i]) {
+      continue;
+    }
+    collision_info_t swept = find_swept_part_collision(body1, body2, i);
+    if (swept.collided &&
+        (first == col_aux->num_parts || swept.time < collision->time) &&
+        !find_part_collision(body1, body2, i).collided) {
+      first = i;
+      *collision = swept;
+    }
+  }
+  return first;
+}
+
+/**
+ * The force creator for compound collisions. Checks each handled part of the
+ * compound body against the other body and runs the part's handler when they
+ * start colliding.
+ *
+ * @param info auxiliary information about the force and associated bodies
+ */
+static void compound_collision_force_creator(void *info) {
+  PROFILE_ZONE("compound_collision_force_creator");
+  compound_collision_aux_t *col_aux = info;
+  body_t *body1 = list_get(col_aux->bodies, 0);
+  body_t *body2 = list_get(col_aux->bodies, 1);
+
+  // A fast body may have passed through thin parts during the last tick. It
+  // is moved back to the first of them, which is handled as touching there.
+  collision_info_t passed = {false, {0, 0}, 0};
+  size_t passed_part = col_aux->num_parts;
+  bool was_near = true;
+  if (is_swept(body1, body2)) {
+    was_near = swept_bounds_overlap(body1, body2);
+    if (was_near) {
+      passed_part = find_passed_part(col_aux, &passed);
+    }
+    if (passed_part < col_aux->num_parts) {
+      move_to_contact(body1, body2, passed.time);
+    }
+  }
+
+  // Broadphase: nothing can be touching unless the whole bodies overlap,
+  // which they cannot if they were never near during the tick
+  bool is_near = was_near && bounds_overlap(body1, body2);
+  for (size_t i = 0; i < col_aux->num_parts; i++) {
+    if (!is_handled(col_aux, body2, i)) {
+      continue;
+    }
+    size_t tag = body_get_part_tag(body2, i);
+    collision_info_t collision = {false, {0, 0}, 0};
+    if (i == passed_part) {
+      collision = passed;
+    } else if (is_near) {
+      collision = find_part_collision(body1, body2, i);
+    }
+    if (collision.collided && !col_aux->collided[i]) {
+      col_aux->handlers[tag](body1, body2, collision.axis, col_aux->aux,
+                             col_aux->force_const);
+      col_aux->collided[i] = true;
+      COUNTER_INC(COUNTER_COLLISIONS_ENTERED);
+    } else if (!collision.collided && col_aux->collided[i]) {
+      col_aux->collided[i] = false;
+      COUNTER_INC(COUNTER_COLLISIONS_EXITED);
+    }
+  }
+}
+
+void create_compound_collision(scene_t *scene, body_t *body1, body_t *body2,
+                               const collision_handler_t *handlers,
+                               size_t num_handlers, void *aux,
+                               double force_const) {
+  list_t *bodies = list_init(2, NULL);
+  list_add(bodies, body1);
+  list_add(bodies, body2);
+
+  list_t *aux_bodies = list_init(2, NULL);
+  list_add(aux_bodies, body1);
+  list_add(aux_bodies, body2);
+
+  // Allocated together with the flags so forcer_free() releases both
+  size_t num_parts = body_num_parts(body2);
+  compound_collision_aux_t *col_aux =
+      malloc(sizeof(compound_collision_aux_t) + num_parts * sizeof(bool));
+  assert(col_aux);
+  col_aux->force_const = force_const;
+  col_aux->bodies = aux_bodies;
+  col_aux->handlers = handlers;
+  col_aux->num_handlers = num_handlers;
+  col_aux->aux = aux;
+  col_aux->num_parts = num_parts;
+  for (size_t i = 0; i < num_parts; i++) {
+    col_aux->collided[i] = false;
+  }
+
+  scene_add_stateful_force_creator(scene, compound_collision_force_creator,
+                                   col_aux, bodies, col_aux->collided,
+                                   num_parts * sizeof(bool));
 }
 
 forcer_t *forcer_init(force_creator_t creator, void *aux, list_t *bodies) {
@@ -206,6 +382,8 @@ forcer_t *forcer_init(force_creator_t creator, void *aux, list_t *bodies) {
   force->creator = creator;
   force->aux = aux;
   force->bodies = bodies;
+  force->state = NULL;
+  force->state_size = 0;
   return force;
 }
 
@@ -0,0 +1,246 @@
+#include <SDL2/SDL_ttf.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset_cache.h"
+#include "counters.h"
+#include "hud.h"
+#include "list.h"
+#include "sdl_wrapper.h"
+
+#define ALLOC_SUBSYSTEM ALLOC_RENDER
+#include "alloc_track.h"
+
+const size_t HUD_WIDGETS_INIT = 4;
+const size_t HUD_NUMBER_LEN = 32;
+
+typedef enum { WIDGET_LABEL, WIDGET_NUMBER, WIDGET_TEXT } widget_type_t;
+
+typedef struct widget {
+  widget_type_t type;
+  TTF_Font *font;
+  SDL_Point location;
+  char *label;
+  const long long *number;
+  const char *format;
+  const char *const *text;
+  // The value the texture was last rasterized from
+  long long shown_number;
+  const char *shown_text;
+  SDL_Texture *texture;
+} widget_t;
+
+struct hud {
+  int width;
+  int height;
+  SDL_Texture *target;
+  list_t *widgets;
+  bool dirty;
+};
+
+static void widget_free(widget_t *widget) {
+  if (widget->texture != NULL) {
+    SDL_DestroyTexture(widget->texture);
+    COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
+  }
+  free(widget->label);
+  free(widget);
+}
+
+hud_t *hud_init(int width, int height) {
+  hud_t *hud = malloc(sizeof(hud_t));
+  assert(hud);
+  hud->width = width;
+  hud->height = height;
+#ifdef HEADLESS
+  // There is no renderer to draw to
+  hud->target = NULL;
+#else
+  hud->target = SDL_CreateTexture(sdl_get_renderer(), SDL_PIXELFORMAT_ARGB8888,
+                                  SDL_TEXTUREACCESS_TARGET, width, height);
+  assert(hud->target);
+  COUNTER_INC(COUNTER_TEXTURES_CREATED);
+  SDL_SetTextureBlendMode(hud->target, SDL_BLENDMODE_BLEND);
+#endif
+  hud->widgets = list_init(HUD_WIDGETS_INIT, (free_func_t)widget_free);
+  hud->dirty = true;
+  return hud;
+}
+
+void hud_free(hud_t *hud) {
+  list_free(hud->widgets);
+  if (hud->target != NULL) {
+    SDL_DestroyTexture(hud->target);
+    COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
+  }
+  free(hud);
+}
+
+static widget_t *widget_init(hud_t *hud, widget_type_t type,
+                             const char *font_path, SDL_Point location) {
+  widget_t *widget = malloc(sizeof(widget_t));
+  assert(widget);
+  widget->type = type;
+  widget->font = (TTF_Font *)asset_cache_obj_get_or_create(ASSET_FONT, font_path);
+  assert(widget->font);
+  widget->location = location;
+  widget->label = NULL;
+  widget->number = NULL;
+  widget->format = NULL;
+  widget->text = NULL;
+  widget->shown_number = 0;
+  widget->shown_text = NULL;
+  widget->texture = NULL;
+  list_add(hud->widgets, widget);
+  hud->dirty = true;
+  return widget;
+}
+
+void hud_add_label(hud_t *hud, const char *font_path, SDL_Point location,
+                   const char *text) {
+  widget_t *widget = widget_init(hud, WIDGET_LABEL, font_path, location);
+  widget->label = strdup(text);
+  assert(widget->label);
+}
+
+void hud_add_number(hud_t *hud, const char *font_path, SDL_Point location,
+                    const long long *value, const char *format) {
+  widget_t *widget = widget_init(hud, WIDGET_NUMBER, font_path, location);
+  widget->number = value;
+  widget->format = format;
+}
+
+void hud_add_text(hud_t *hud, const char *font_path, SDL_Point location,
+                  const char *const *text) {
+  widget_t *widget = widget_init(hud, WIDGET_TEXT, font_path, location);
+  widget->text = text;
+}
+
+void hud_invalidate(hud_t *hud) {
+  // A device reset loses the widgets' textures too, so they are rasterized
+  // again rather than trusted
+  for (size_t i = 0; i < list_size(hud->widgets); i++) {
+    widget_t *widget = list_get(hud->widgets, i);
+    if (widget->texture != NULL) {
+      SDL_DestroyTexture(widget->texture);
+      COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
+      widget->texture = NULL;
+    }
+  }
+  hud->dirty = true;
+}
+
+/**
+ * Returns whether the widget's texture is missing or was rasterized from a
+ * value that has since changed.
+ */
+static bool widget_is_stale(widget_t *widget) {
+  switch (widget->type) {
+  case WIDGET_LABEL: {
+    return widget->texture == NULL;
+  }
+  case WIDGET_NUMBER: {
+    return widget->texture == NULL || *widget->number != widget->shown_number;
+  }
+  case WIDGET_TEXT: {
+    return *widget->text != widget->shown_text ||
+           (widget->texture == NULL && widget->shown_text != NULL);
+  }
+  default: {
+    assert(false && "Unknown widget type");
+  }
+  }
+}
+
+/**
+ * Re-rasterizes the widget's texture if its bound value has changed.
+ * Returns whether the texture changed.
+ */
+static bool widget_update(widget_t *widget) {
+  if (!widget_is_stale(widget)) {
+    return false;
+  }
+  char number_text[HUD_NUMBER_LEN];
+  const char *text;
+  switch (widget->type) {
+  case WIDGET_LABEL: {
+    text = widget->label;
+    break;
+  }
+  case WIDGET_NUMBER: {
+    widget->shown_number = *widget->number;
+    snprintf(number_text, sizeof(number_text), widget->format,
+             widget->shown_number);
+    text = number_text;
+    break;
+  }
+  case WIDGET_TEXT: {
+    widget->shown_text = *widget->text;
+    text = widget->shown_text;
+    break;
+  }
+  default: {
+    assert(false && "Unknown widget type");
+  }
+  }
+
+  if (widget->texture != NULL) {
+    SDL_DestroyTexture(widget->texture);
+    COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
+    widget->texture = NULL;
+  }
+  if (text != NULL && text[0] != '\0') {
+    widget->texture = text_render(text, widget->font);
+  }
+  return true;
+}
+
+bool hud_is_dirty(hud_t *hud) {
+  if (hud->dirty) {
+    return true;
+  }
+  for (size_t i = 0; i < list_size(hud->widgets); i++) {
+    if (widget_is_stale(list_get(hud->widgets, i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void hud_render(hud_t *hud, int x, int y) {
+#ifdef HEADLESS
+  // There is no renderer to draw to
+  (void)hud;
+  (void)x;
+  (void)y;
+#else
+  bool changed = hud->dirty;
+  for (size_t i = 0; i < list_size(hud->widgets); i++) {
+    if (widget_update(list_get(hud->widgets, i))) {
+      changed = true;
+    }
+  }
+
+  SDL_Renderer *renderer = sdl_get_renderer();
+  if (changed) {
+    // The HUD may itself be drawn to a texture rather than the window
+    SDL_Texture *screen = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, hud->target);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    for (size_t i = 0; i < list_size(hud->widgets); i++) {
+      widget_t *widget = list_get(hud->widgets, i);
+      if (widget->texture != NULL) {
+        text_display(widget->texture, (vector_t){widget->location.x,
+                                                 widget->location.y});
+      }
+    }
+    SDL_SetRenderTarget(renderer, screen);
+    hud->dirty = false;
+  }
+
+  sdl_render(hud->target, x, y, hud->width, hud->height);
+#endif
+}
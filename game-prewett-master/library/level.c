@@ -0,0 +1,434 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "level.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ALLOC_SUBSYSTEM ALLOC_GAME
+#include "alloc_track.h"
+
+const size_t LEVEL_INIT_CAPACITY = 64;
+const size_t LEVEL_LINE_LEN = 256;
+
+struct level {
+  // Text levels are held as a single chunk of records owned by the level
+  level_record_t *records;
+  level_part_t *parts;
+  size_t num_parts;
+
+  // Compiled levels point into the mapped file instead
+  const uint8_t *map;
+  size_t map_size;
+  const level_chunk_t *chunks;
+  // Maps the kinds named in the file to indices into the caller's kinds
+  size_t *kind_map;
+  size_t num_kinds;
+
+  size_t num_chunks;
+  size_t num_records;
+  double length;
+  size_t chunk;
+  size_t cursor;
+};
+
+static int compare_records(const void *a, const void *b) {
+  double x1 = ((const level_record_t *)a)->min.x;
+  double x2 = ((const level_record_t *)b)->min.x;
+  return (x1 > x2) - (x1 < x2);
+}
+
+// helper function for level_load
+static size_t find_kind(const char *name, const char *const *kinds,
+                        size_t num_kinds) {
+  for (size_t i = 0; i < num_kinds; i++) {
+    if (strcmp(name, kinds[i]) == 0) {
+      return i;
+    }
+  }
+  return LEVEL_NO_KIND;
+}
+
+static level_t *level_init(void) {
+  level_t *level = malloc(sizeof(level_t));
+  assert(level);
+  level->records = NULL;
+  level->parts = NULL;
+  level->num_parts = 0;
+  level->map = NULL;
+  level->map_size = 0;
+  level->chunks = NULL;
+  level->kind_map = NULL;
+  level->num_kinds = 0;
+  level->num_chunks = 0;
+  level->num_records = 0;
+  level->length = 0;
+  level->chunk = 0;
+  level->cursor = 0;
+  return level;
+}
+
+// Grows an array of parts so that `count` more fit
+static level_part_t *reserve_parts(level_part_t *parts, size_t *capacity,
+                                   size_t num_parts, size_t count) {
+  if (num_parts + count <= *capacity) {
+    return parts;
+  }
+  while (num_parts + count > *capacity) {
+    *capacity *= 2;
+  }
+  parts = realloc(parts, *capacity * sizeof(level_part_t));
+  assert(parts);
+  return parts;
+}
+
+level_record_t *level_parse_text(FILE *f, const char *path,
+                                 level_kind_resolver_t resolve, void *aux,
+                                 size_t *num_records, level_part_t **parts,
+                                 size_t *num_parts, double *length) {
+  size_t capacity = LEVEL_INIT_CAPACITY;
+  level_record_t *records = malloc(capacity * sizeof(level_record_t));
+  assert(records);
+  size_t part_capacity = LEVEL_INIT_CAPACITY;
+  *parts = malloc(part_capacity * sizeof(level_part_t));
+  assert(*parts);
+  *num_records = 0;
+  *num_parts = 0;
+  *length = 0;
+
+  char line[LEVEL_LINE_LEN];
+  size_t line_number = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    line_number++;
+    char name[LEVEL_LINE_LEN];
+    vector_t position;
+    vector_t size;
+    int fields = 0;
+    if (line[0] != '#') {
+      fields = sscanf(line, "%255s %lf %lf %lf %lf", name, &position.x,
+                      &position.y, &size.x, &size.y);
+    }
+    if (fields < 3) {
+      continue;
+    }
+    level_shape_t shape = {.size = VEC_ZERO, .num_parts = 0, .parts = NULL};
+    size_t kind = resolve(aux, name, path, line_number, &shape);
+    if (kind == LEVEL_NO_KIND) {
+      continue;
+    }
+    if (fields == 5) {
+      shape.size = size;
+    }
+    if (*num_records == capacity) {
+      capacity *= 2;
+      records = realloc(records, capacity * sizeof(level_record_t));
+      assert(records);
+    }
+    *parts = reserve_parts(*parts, &part_capacity, *num_parts, shape.num_parts);
+
+    level_record_t *record = &records[(*num_records)++];
+    // Zeroed so records written out as-is have no stray padding bytes
+    memset(record, 0, sizeof(*record));
+    vector_t half = vec_multiply(0.5, shape.size);
+    record->position = position;
+    record->size = shape.size;
+    record->min = vec_subtract(position, half);
+    record->max = vec_add(position, half);
+    record->kind = kind;
+    record->num_parts = shape.num_parts;
+    record->first_part = *num_parts;
+    for (size_t i = 0; i < shape.num_parts; i++) {
+      level_part_t *part = &(*parts)[(*num_parts)++];
+      memset(part, 0, sizeof(*part));
+      part->min = shape.parts[i].min;
+      part->max = shape.parts[i].max;
+      part->tag = shape.parts[i].tag;
+      record->min.x = fmin(record->min.x, position.x + part->min.x);
+      record->min.y = fmin(record->min.y, position.y + part->min.y);
+      record->max.x = fmax(record->max.x, position.x + part->max.x);
+      record->max.y = fmax(record->max.y, position.y + part->max.y);
+    }
+    if (record->max.x > *length) {
+      *length = record->max.x;
+    }
+  }
+
+  // level_spawn() walks the records with a cursor, so they must be in order.
+  // Their parts are found by index, so they can stay where they are.
+  qsort(records, *num_records, sizeof(level_record_t), compare_records);
+  return records;
+}
+
+typedef struct {
+  const char *const *kinds;
+  const level_shape_t *shapes;
+  size_t num_kinds;
+} kind_list_t;
+
+// level_kind_resolver_t for the kinds passed to level_load()
+static size_t resolve_listed_kind(void *aux, const char *name,
+                                  const char *path, size_t line_number,
+                                  level_shape_t *shape) {
+  kind_list_t *list = aux;
+  size_t kind = find_kind(name, list->kinds, list->num_kinds);
+  if (kind == LEVEL_NO_KIND) {
+    fprintf(stderr, "%s:%zu: unknown kind '%s'\n", path, line_number, name);
+  } else if (list->shapes != NULL) {
+    *shape = list->shapes[kind];
+  }
+  return kind;
+}
+
+static level_t *load_text(FILE *f, const char *path, const char *const *kinds,
+                          const level_shape_t *shapes, size_t num_kinds) {
+  level_t *level = level_init();
+  kind_list_t list = {.kinds = kinds, .shapes = shapes, .num_kinds = num_kinds};
+  level->records = level_parse_text(f, path, resolve_listed_kind, &list,
+                                    &level->num_records, &level->parts,
+                                    &level->num_parts, &level->length);
+  level->num_chunks = 1;
+  return level;
+}
+
+#ifdef _WIN32
+// No mmap on Windows, so compiled levels are read into memory in one go
+static const uint8_t *map_level(FILE *f, size_t *size) {
+  fseek(f, 0, SEEK_END);
+  long length = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = malloc(length);
+  assert(data);
+  if (fread(data, 1, length, f) != (size_t)length) {
+    free(data);
+    return NULL;
+  }
+  *size = length;
+  return data;
+}
+
+static void unmap_level(const uint8_t *data, size_t size) {
+  free((void *)data);
+}
+
+static void advise_chunk(level_t *level, size_t chunk, bool needed) {}
+#else
+static const uint8_t *map_level(FILE *f, size_t *size) {
+  struct stat info;
+  if (fstat(fileno(f), &info) != 0 || info.st_size == 0) {
+    return NULL;
+  }
+  void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  *size = info.st_size;
+  return data;
+}
+
+static void unmap_level(const uint8_t *data, size_t size) {
+  munmap((void *)data, size);
+}
+
+// Asks the kernel to read a chunk ahead of time, or to drop its pages
+static void advise_chunk(level_t *level, size_t chunk, bool needed) {
+  if (level->map == NULL || chunk >= level->num_chunks) {
+    return;
+  }
+  const level_chunk_t *info = &level->chunks[chunk];
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t start = info->offset / page_size * page_size;
+  size_t end = info->offset + info->num_records * sizeof(level_record_t) +
+               info->num_parts * sizeof(level_part_t);
+  if (end > level->map_size || end <= start) {
+    return;
+  }
+  madvise((void *)(level->map + start), end - start,
+          needed ? MADV_WILLNEED : MADV_DONTNEED);
+}
+#endif
+
+static level_t *load_compiled(FILE *f, const char *path,
+                              const char *const *kinds, size_t num_kinds) {
+  size_t size = 0;
+  const uint8_t *data = map_level(f, &size);
+  if (data == NULL) {
+    return NULL;
+  }
+
+  const level_file_header_t *header = (const level_file_header_t *)data;
+  size_t names_size = 0;
+  size_t table_end = sizeof(level_file_header_t);
+  if (size >= table_end) {
+    names_size = (size_t)header->num_kinds * LEVEL_KIND_NAME_LEN;
+    table_end +=
+        names_size + (size_t)header->num_chunks * sizeof(level_chunk_t);
+  }
+  if (size < sizeof(level_file_header_t) ||
+      header->version != LEVEL_VERSION || size < table_end) {
+    fprintf(stderr, "Ignoring invalid level %s\n", path);
+    unmap_level(data, size);
+    return NULL;
+  }
+
+  level_t *level = level_init();
+  level->map = data;
+  level->map_size = size;
+  level->num_chunks = header->num_chunks;
+  level->num_records = header->num_records;
+  level->length = header->length;
+  level->chunks = (const level_chunk_t *)(data + sizeof(level_file_header_t) +
+                                          names_size);
+
+  const char *names = (const char *)(data + sizeof(level_file_header_t));
+  level->num_kinds = header->num_kinds;
+  level->kind_map = malloc(header->num_kinds * sizeof(size_t));
+  assert(level->kind_map);
+  for (size_t i = 0; i < header->num_kinds; i++) {
+    char name[LEVEL_KIND_NAME_LEN + 1] = {0};
+    memcpy(name, names + i * LEVEL_KIND_NAME_LEN, LEVEL_KIND_NAME_LEN);
+    level->kind_map[i] = find_kind(name, kinds, num_kinds);
+    if (level->kind_map[i] == LEVEL_NO_KIND) {
+      fprintf(stderr, "%s: unknown kind '%s'\n", path, name);
+    }
+  }
+  level_reset(level);
+  return level;
+}
+
+level_t *level_load(const char *path, const char *const *kinds,
+                    const level_shape_t *shapes, size_t num_kinds) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+
+  // Compiled levels are recognized by their magic rather than their extension
+  char magic[4];
+  bool is_compiled = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                     memcmp(magic, LEVEL_MAGIC, sizeof(magic)) == 0;
+  rewind(f);
+  level_t *level = is_compiled ? load_compiled(f, path, kinds, num_kinds)
+                               : load_text(f, path, kinds, shapes, num_kinds);
+  // The mapping keeps the file alive, so the stream is not needed
+  fclose(f);
+  return level;
+}
+
+void level_free(level_t *level) {
+  if (level->map != NULL) {
+    unmap_level(level->map, level->map_size);
+  }
+  free(level->records);
+  free(level->parts);
+  free(level->kind_map);
+  free(level);
+}
+
+size_t level_entries(level_t *level) { return level->num_records; }
+
+double level_length(level_t *level) { return level->length; }
+
+void level_reset(level_t *level) {
+  if (level->chunk < level->num_chunks) {
+    advise_chunk(level, level->chunk, false);
+  }
+  level->chunk = 0;
+  level->cursor = 0;
+  advise_chunk(level, 0, true);
+  advise_chunk(level, 1, true);
+}
+
+bool level_is_done(level_t *level) {
+  return level->chunk >= level->num_chunks;
+}
+
+level_position_t level_tell(level_t *level) {
+  return (level_position_t){level->chunk, level->cursor};
+}
+
+void level_seek(level_t *level, level_position_t position) {
+  if (position.chunk == level->chunk) {
+    level->cursor = position.cursor;
+    return;
+  }
+  advise_chunk(level, level->chunk, false);
+  advise_chunk(level, level->chunk + 1, false);
+  level->chunk = position.chunk;
+  level->cursor = position.cursor;
+  advise_chunk(level, level->chunk, true);
+  advise_chunk(level, level->chunk + 1, true);
+}
+
+// Gets the records and parts of a chunk, or none if the chunk lies outside
+// the file
+static const level_record_t *chunk_records(level_t *level, size_t chunk,
+                                           size_t *count,
+                                           const level_part_t **parts,
+                                           size_t *num_parts) {
+  if (level->map == NULL) {
+    *count = level->num_records;
+    *parts = level->parts;
+    *num_parts = level->num_parts;
+    return level->records;
+  }
+  const level_chunk_t *info = &level->chunks[chunk];
+  size_t parts_offset =
+      info->offset + info->num_records * sizeof(level_record_t);
+  size_t end = parts_offset + info->num_parts * sizeof(level_part_t);
+  if (info->offset > level->map_size || end > level->map_size) {
+    *count = 0;
+    return NULL;
+  }
+  *count = info->num_records;
+  *parts = (const level_part_t *)(level->map + parts_offset);
+  *num_parts = info->num_parts;
+  return (const level_record_t *)(level->map + info->offset);
+}
+
+size_t level_spawn(level_t *level, double horizon, level_spawner_t spawner,
+                   void *aux) {
+  size_t spawned = 0;
+  while (level->chunk < level->num_chunks) {
+    size_t count;
+    const level_part_t *parts;
+    size_t num_parts;
+    const level_record_t *records =
+        chunk_records(level, level->chunk, &count, &parts, &num_parts);
+    if (level->cursor >= count) {
+      // Everything in this chunk is in play, so its pages can go
+      advise_chunk(level, level->chunk, false);
+      level->chunk++;
+      level->cursor = 0;
+      advise_chunk(level, level->chunk + 1, true);
+      continue;
+    }
+
+    const level_record_t *record = &records[level->cursor];
+    if (record->min.x > horizon) {
+      break;
+    }
+    level->cursor++;
+    size_t kind = record->kind;
+    if (level->kind_map != NULL) {
+      kind = kind < level->num_kinds ? level->kind_map[kind] : LEVEL_NO_KIND;
+    }
+    bool has_parts = record->first_part <= num_parts &&
+                     record->num_parts <= num_parts - record->first_part;
+    if (kind != LEVEL_NO_KIND && has_parts) {
+      level_shape_t shape = {.size = record->size,
+                             .num_parts = record->num_parts,
+                             .parts = parts + record->first_part};
+      spawner(aux, kind, record->position, &shape);
+      spawned++;
+    }
+  }
+  return spawned;
+}
@@ -3,6 +3,9 @@
 #include <math.h>
 #include <stdlib.h>
 
+#define ALLOC_SUBSYSTEM ALLOC_LIST
+#include "alloc_track.h"
+
 typedef struct list {
 
   size_t length;
@@ -0,0 +1,132 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "clock.h"
+#include "pacer.h"
+
+#define ALLOC_SUBSYSTEM ALLOC_OTHER
+#include "alloc_track.h"
+
+// The sleep stops this long before a deadline at first, never closer than
+// PACER_MIN_SPIN, and never further than PACER_MAX_SPIN or half a period
+const double PACER_INITIAL_SPIN = 2e-3;
+const double PACER_MIN_SPIN = 2e-4;
+const double PACER_MAX_SPIN = 8e-3;
+// Each frame the margin shrinks by this factor unless a sleep oversleeps it
+const double PACER_SPIN_DECAY = 0.99;
+const double PACER_MS_PER_S = 1e3;
+const double PACER_NS_PER_S = 1e9;
+
+struct pacer {
+  // 0 when frames are not waited for
+  double period;
+  double deadline;
+  double start;
+  double last_frame_end;
+  double spin_margin;
+  double total_jitter;
+  pacer_stats_t stats;
+};
+
+static void sleep_for(double seconds) {
+  struct timespec duration;
+  duration.tv_sec = (time_t)seconds;
+  duration.tv_nsec = (long)((seconds - duration.tv_sec) * PACER_NS_PER_S);
+  nanosleep(&duration, NULL);
+}
+
+pacer_t *pacer_init(double target_fps) {
+  pacer_t *pacer = calloc(1, sizeof(pacer_t));
+  assert(pacer);
+  pacer->start = now_seconds();
+  pacer->last_frame_end = pacer->start;
+  pacer->spin_margin = PACER_INITIAL_SPIN;
+  pacer_set_target(pacer, target_fps);
+  return pacer;
+}
+
+void pacer_free(pacer_t *pacer) { free(pacer); }
+
+void pacer_set_target(pacer_t *pacer, double target_fps) {
+  assert(target_fps >= 0);
+  pacer->period = target_fps > 0 ? 1 / target_fps : 0;
+  pacer->deadline = pacer->last_frame_end + pacer->period;
+}
+
+/**
+ * Waits until the next deadline, sleeping for as much of the wait as can be
+ * trusted not to oversleep it.
+ *
+ * @return the time the wait ended
+ */
+static double wait_for_deadline(pacer_t *pacer, double now) {
+  double sleep_until = pacer->deadline - pacer->spin_margin;
+  if (now < sleep_until) {
+    sleep_for(sleep_until - now);
+    double woke = now_seconds();
+    pacer->stats.sleep_time += woke - now;
+    double oversleep = woke - sleep_until;
+    // Oversleeping by more than a period is a stall, such as the process
+    // being descheduled, and says nothing about how precisely sleeps wake
+    if (oversleep > pacer->period) {
+      oversleep = 0;
+    }
+    double margin = fmax(oversleep, pacer->spin_margin * PACER_SPIN_DECAY);
+    double max_margin = fmin(PACER_MAX_SPIN, pacer->period / 2);
+    pacer->spin_margin = fmax(PACER_MIN_SPIN, fmin(margin, max_margin));
+    now = woke;
+  }
+
+  double spin_start = now;
+  while (now < pacer->deadline) {
+    now = now_seconds();
+  }
+  pacer->stats.spin_time += now - spin_start;
+  return now;
+}
+
+void pacer_end_frame(pacer_t *pacer) {
+  double now = now_seconds();
+  if (pacer->period > 0) {
+    if (now > pacer->deadline) {
+      // Later frames are due a period apart from this one, not crammed in
+      // to make up for it
+      pacer->stats.missed_deadlines++;
+      pacer->deadline = now;
+    } else {
+      now = wait_for_deadline(pacer, now);
+    }
+    pacer->deadline += pacer->period;
+
+    double jitter = fabs(now - pacer->last_frame_end - pacer->period);
+    pacer->total_jitter += jitter;
+    pacer->stats.max_jitter = fmax(pacer->stats.max_jitter, jitter);
+  }
+
+  pacer->stats.frames++;
+  pacer->stats.mean_jitter = pacer->total_jitter / pacer->stats.frames;
+  pacer->stats.elapsed = now - pacer->start;
+  pacer->last_frame_end = now;
+}
+
+void pacer_resume(pacer_t *pacer) {
+  pacer->last_frame_end = now_seconds();
+  pacer->deadline = pacer->last_frame_end + pacer->period;
+}
+
+pacer_stats_t pacer_stats(const pacer_t *pacer) { return pacer->stats; }
+
+void pacer_report(const pacer_t *pacer, FILE *file) {
+  const pacer_stats_t *stats = &pacer->stats;
+  fprintf(file,
+          "Paced %zu frames in %.1f s (%.1f fps): %zu missed deadlines, "
+          "jitter mean %.3f ms max %.3f ms, waited %.2f s asleep and %.2f s "
+          "spinning\n",
+          stats->frames, stats->elapsed,
+          stats->elapsed > 0 ? stats->frames / stats->elapsed : 0,
+          stats->missed_deadlines, stats->mean_jitter * PACER_MS_PER_S,
+          stats->max_jitter * PACER_MS_PER_S, stats->sleep_time,
+          stats->spin_time);
+}
@@ -0,0 +1,398 @@
+#include <SDL2/SDL_ttf.h>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asset_cache.h"
+#include "clock.h"
+#include "counters.h"
+#include "perf_overlay.h"
+#include "sdl_wrapper.h"
+
+#define ALLOC_SUBSYSTEM ALLOC_RENDER
+#include "alloc_track.h"
+
+// The atlas holds printable ASCII, which is all the overlay draws
+#define FIRST_PERF_GLYPH ' '
+#define LAST_PERF_GLYPH '~'
+#define NUM_PERF_GLYPHS (LAST_PERF_GLYPH - FIRST_PERF_GLYPH + 1)
+const int PERF_ATLAS_WIDTH = 512;
+
+// About 8 s at 60 FPS, so the 1% low is taken over several frames
+#define PERF_HISTORY 512
+// The most recent frames are graphed, one pixel wide each
+#define PERF_GRAPH_FRAMES 240
+const int PERF_GRAPH_HEIGHT = 60;
+// The frame time of a full-height bar
+const double PERF_GRAPH_MAX_TIME = 1.0 / 20;
+// Bars are green up to 60 FPS, yellow up to 30 FPS and red beyond
+#define NUM_PERF_BAR_COLORS 3
+const double PERF_BAR_TIMES[NUM_PERF_BAR_COLORS] = {1.0 / 60, 1.0 / 30,
+                                                    INFINITY};
+const SDL_Color PERF_BAR_COLORS[NUM_PERF_BAR_COLORS] = {
+    {80, 220, 80, 255}, {240, 200, 60, 255}, {240, 70, 70, 255}};
+const SDL_Color PERF_GUIDE_COLOR = {255, 255, 255, 96};
+const SDL_Color PERF_BACKGROUND_COLOR = {0, 0, 0, 176};
+const int PERF_PADDING = 6;
+
+// How often the average frame rate and 1% low are recomputed
+const double PERF_SUMMARY_INTERVAL = 0.25;
+const double PERF_LOW_FRACTION = 0.01;
+const double PERF_MS_PER_S = 1e3;
+
+#define PERF_NUM_LINES 4
+#define PERF_LINE_LEN 96
+
+typedef struct {
+  // Where the glyph is in the atlas; empty for glyphs the font lacks
+  SDL_Rect source;
+  int advance;
+} perf_glyph_t;
+
+struct perf_overlay {
+  bool is_shown;
+  // The atlas is built the first time the overlay is drawn (or NULL)
+  const char *font_path;
+  SDL_Texture *atlas;
+  perf_glyph_t glyphs[NUM_PERF_GLYPHS];
+  int line_height;
+
+  // The latest frame time is at (num_frames - 1) % PERF_HISTORY
+  double frame_times[PERF_HISTORY];
+  size_t num_frames;
+  // When the last frame ended, or 0 before the first one
+  double last_frame_end;
+
+  // The frame being measured
+  double phase_starts[NUM_PERF_PHASES];
+  size_t phase_start_allocs[NUM_PERF_PHASES];
+  double phase_times[NUM_PERF_PHASES];
+  size_t phase_allocs[NUM_PERF_PHASES];
+  uint64_t last_draw_calls;
+
+  // The last frame measured, which is what is shown
+  double shown_phase_times[NUM_PERF_PHASES];
+  size_t shown_phase_allocs[NUM_PERF_PHASES];
+  size_t shown_draw_calls;
+  size_t shown_bodies;
+  size_t shown_forcers;
+
+  double average_fps;
+  double low_fps;
+  double last_summary_time;
+
+  // Scratch space, so updating and drawing the overlay does not allocate
+  double sorted_times[PERF_HISTORY];
+  SDL_Rect bars[PERF_GRAPH_FRAMES];
+};
+
+// Gets the number of allocations made so far, or 0 if they are not tracked
+static size_t count_allocations(void) {
+  size_t total = 0;
+#ifdef ALLOC_TRACK
+  for (size_t i = 0; i < NUM_ALLOC_SUBSYSTEMS; i++) {
+    total += alloc_track_stats(i).total_allocs;
+  }
+#endif
+  return total;
+}
+
+/**
+ * Rasterizes every glyph into one texture, packed into rows PERF_ATLAS_WIDTH
+ * pixels wide.
+ */
+static void build_atlas(perf_overlay_t *overlay, TTF_Font *font) {
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *surfaces[NUM_PERF_GLYPHS];
+  int x = 0, y = 0, row_height = 0;
+  for (size_t i = 0; i < NUM_PERF_GLYPHS; i++) {
+    Uint16 ch = FIRST_PERF_GLYPH + i;
+    perf_glyph_t *glyph = &overlay->glyphs[i];
+    surfaces[i] = TTF_RenderGlyph_Blended(font, ch, white);
+    glyph->source = (SDL_Rect){0, 0, 0, 0};
+    if (surfaces[i] != NULL) {
+      if (x + surfaces[i]->w > PERF_ATLAS_WIDTH) {
+        x = 0;
+        y += row_height;
+        row_height = 0;
+      }
+      glyph->source =
+          (SDL_Rect){x, y, surfaces[i]->w, surfaces[i]->h};
+      x += surfaces[i]->w;
+      if (surfaces[i]->h > row_height) {
+        row_height = surfaces[i]->h;
+      }
+    }
+    if (TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &glyph->advance) !=
+        0) {
+      glyph->advance = glyph->source.w;
+    }
+  }
+
+  // New surfaces are cleared, so unused parts of the atlas are transparent
+  SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(
+      0, PERF_ATLAS_WIDTH, y + row_height, 32, SDL_PIXELFORMAT_ARGB8888);
+  assert(atlas);
+  for (size_t i = 0; i < NUM_PERF_GLYPHS; i++) {
+    if (surfaces[i] != NULL) {
+      // Copy the glyph's alpha instead of blending it onto the atlas
+      SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+      SDL_Rect dest = overlay->glyphs[i].source;
+      SDL_BlitSurface(surfaces[i], NULL, atlas, &dest);
+      SDL_FreeSurface(surfaces[i]);
+    }
+  }
+  overlay->atlas = SDL_CreateTextureFromSurface(sdl_get_renderer(), atlas);
+  assert(overlay->atlas);
+  COUNTER_INC(COUNTER_TEXTURES_CREATED);
+  SDL_SetTextureBlendMode(overlay->atlas, SDL_BLENDMODE_BLEND);
+  SDL_FreeSurface(atlas);
+  overlay->line_height = TTF_FontLineSkip(font);
+}
+
+perf_overlay_t *perf_overlay_init(const char *font_path) {
+  perf_overlay_t *overlay = calloc(1, sizeof(perf_overlay_t));
+  assert(overlay);
+  overlay->is_shown = false;
+  overlay->font_path = font_path;
+  overlay->atlas = NULL;
+  overlay->last_draw_calls = counters_total(COUNTER_DRAW_CALLS);
+  return overlay;
+}
+
+void perf_overlay_free(perf_overlay_t *overlay) {
+  if (overlay->atlas != NULL) {
+    SDL_DestroyTexture(overlay->atlas);
+    COUNTER_INC(COUNTER_TEXTURES_DESTROYED);
+  }
+  free(overlay);
+}
+
+bool perf_overlay_is_shown(const perf_overlay_t *overlay) {
+  return overlay->is_shown;
+}
+
+void perf_overlay_toggle(perf_overlay_t *overlay) {
+  overlay->is_shown = !overlay->is_shown;
+  // The summary is only kept up to date while the overlay is shown
+  overlay->last_summary_time = 0;
+}
+
+void perf_overlay_begin_phase(perf_overlay_t *overlay, perf_phase_t phase) {
+  overlay->phase_starts[phase] = now_seconds();
+  overlay->phase_start_allocs[phase] = count_allocations();
+}
+
+void perf_overlay_end_phase(perf_overlay_t *overlay, perf_phase_t phase) {
+  overlay->phase_times[phase] += now_seconds() - overlay->phase_starts[phase];
+  overlay->phase_allocs[phase] +=
+      count_allocations() - overlay->phase_start_allocs[phase];
+}
+
+static int compare_times_descending(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x < y) - (x > y);
+}
+
+/**
+ * Computes the average frame rate over the frame history, and the 1% low:
+ * the average frame rate of the slowest 1% of those frames.
+ */
+static void update_summary(perf_overlay_t *overlay) {
+  size_t n =
+      overlay->num_frames < PERF_HISTORY ? overlay->num_frames : PERF_HISTORY;
+  if (n == 0) {
+    return;
+  }
+  double total = 0;
+  for (size_t i = 0; i < n; i++) {
+    overlay->sorted_times[i] = overlay->frame_times[i];
+    total += overlay->frame_times[i];
+  }
+  qsort(overlay->sorted_times, n, sizeof(double), compare_times_descending);
+  size_t num_slow = (size_t)ceil(n * PERF_LOW_FRACTION);
+  double slow_total = 0;
+  for (size_t i = 0; i < num_slow; i++) {
+    slow_total += overlay->sorted_times[i];
+  }
+  overlay->average_fps = total > 0 ? n / total : 0;
+  overlay->low_fps = slow_total > 0 ? num_slow / slow_total : 0;
+}
+
+void perf_overlay_end_frame(perf_overlay_t *overlay, scene_t *scene) {
+  double now = now_seconds();
+  // The first frame has no start to measure from
+  if (overlay->last_frame_end > 0) {
+    overlay->frame_times[overlay->num_frames % PERF_HISTORY] =
+        now - overlay->last_frame_end;
+    overlay->num_frames++;
+  }
+  overlay->last_frame_end = now;
+
+  for (size_t i = 0; i < NUM_PERF_PHASES; i++) {
+    overlay->shown_phase_times[i] = overlay->phase_times[i];
+    overlay->shown_phase_allocs[i] = overlay->phase_allocs[i];
+    overlay->phase_times[i] = 0;
+    overlay->phase_allocs[i] = 0;
+  }
+  uint64_t draw_calls = counters_total(COUNTER_DRAW_CALLS);
+  overlay->shown_draw_calls = draw_calls - overlay->last_draw_calls;
+  overlay->last_draw_calls = draw_calls;
+  overlay->shown_bodies = scene_bodies(scene);
+  overlay->shown_forcers = scene_force_creators(scene);
+
+  if (overlay->is_shown &&
+      now - overlay->last_summary_time >= PERF_SUMMARY_INTERVAL) {
+    update_summary(overlay);
+    overlay->last_summary_time = now;
+  }
+}
+
+// Formats the text of the overlay into `lines`
+static void format_lines(perf_overlay_t *overlay,
+                         char lines[PERF_NUM_LINES][PERF_LINE_LEN]) {
+  double frame_time = 0;
+  if (overlay->num_frames > 0) {
+    frame_time =
+        overlay->frame_times[(overlay->num_frames - 1) % PERF_HISTORY];
+  }
+  snprintf(lines[0], PERF_LINE_LEN, "%.0f FPS   avg %.1f   1%% low %.1f",
+           frame_time > 0 ? 1 / frame_time : 0, overlay->average_fps,
+           overlay->low_fps);
+  snprintf(lines[1], PERF_LINE_LEN,
+           "frame %.2f ms   sim %.2f   render %.2f   present %.2f",
+           frame_time * PERF_MS_PER_S,
+           overlay->shown_phase_times[PERF_SIM] * PERF_MS_PER_S,
+           overlay->shown_phase_times[PERF_RENDER] * PERF_MS_PER_S,
+           overlay->shown_phase_times[PERF_PRESENT] * PERF_MS_PER_S);
+  snprintf(lines[2], PERF_LINE_LEN, "bodies %zu   forcers %zu   draws %zu",
+           overlay->shown_bodies, overlay->shown_forcers,
+           overlay->shown_draw_calls);
+#ifdef ALLOC_TRACK
+  snprintf(lines[3], PERF_LINE_LEN, "allocs   sim %zu   render %zu   present %zu",
+           overlay->shown_phase_allocs[PERF_SIM],
+           overlay->shown_phase_allocs[PERF_RENDER],
+           overlay->shown_phase_allocs[PERF_PRESENT]);
+#else
+  snprintf(lines[3], PERF_LINE_LEN, "allocs   (build with -DALLOC_TRACK)");
+#endif
+}
+
+static int measure_text(perf_overlay_t *overlay, const char *text) {
+  int width = 0;
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c >= FIRST_PERF_GLYPH && *c <= LAST_PERF_GLYPH) {
+      width += overlay->glyphs[*c - FIRST_PERF_GLYPH].advance;
+    }
+  }
+  return width;
+}
+
+// Draws each character of the text as a quad from the atlas
+static void draw_text(perf_overlay_t *overlay, int x, int y,
+                      const char *text) {
+  SDL_Renderer *renderer = sdl_get_renderer();
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c < FIRST_PERF_GLYPH || *c > LAST_PERF_GLYPH) {
+      continue;
+    }
+    perf_glyph_t *glyph = &overlay->glyphs[*c - FIRST_PERF_GLYPH];
+    if (glyph->source.w > 0) {
+      SDL_Rect dest = {x, y, glyph->source.w, glyph->source.h};
+      SDL_RenderCopy(renderer, overlay->atlas, &glyph->source, &dest);
+    }
+    x += glyph->advance;
+  }
+}
+
+// Gets the height in pixels of a bar or guide line for a frame time
+static int get_bar_height(double frame_time) {
+  double fraction = fmin(frame_time / PERF_GRAPH_MAX_TIME, 1);
+  return (int)round(fraction * PERF_GRAPH_HEIGHT);
+}
+
+/**
+ * Draws a bar for each recent frame, newest on the right, with lines at the
+ * frame times where the bars change color. Bars of the same color are drawn
+ * together.
+ */
+static void draw_graph(perf_overlay_t *overlay, int x, int y) {
+  SDL_Renderer *renderer = sdl_get_renderer();
+  size_t n = overlay->num_frames < PERF_GRAPH_FRAMES ? overlay->num_frames
+                                                     : PERF_GRAPH_FRAMES;
+  double min_time = 0;
+  for (size_t color = 0; color < NUM_PERF_BAR_COLORS; color++) {
+    double max_time = PERF_BAR_TIMES[color];
+    int num_bars = 0;
+    for (size_t i = 0; i < n; i++) {
+      size_t frame = overlay->num_frames - n + i;
+      double frame_time = overlay->frame_times[frame % PERF_HISTORY];
+      if (frame_time <= min_time || frame_time > max_time) {
+        continue;
+      }
+      int height = get_bar_height(frame_time);
+      height = height > 0 ? height : 1;
+      int bar_x = x + (int)(PERF_GRAPH_FRAMES - n + i);
+      overlay->bars[num_bars++] =
+          (SDL_Rect){bar_x, y + PERF_GRAPH_HEIGHT - height, 1, height};
+    }
+    SDL_Color c = PERF_BAR_COLORS[color];
+    SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+    SDL_RenderFillRects(renderer, overlay->bars, num_bars);
+    min_time = max_time;
+  }
+
+  SDL_Color c = PERF_GUIDE_COLOR;
+  SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+  for (size_t i = 0; i < NUM_PERF_BAR_COLORS - 1; i++) {
+    int line_y = y + PERF_GRAPH_HEIGHT - get_bar_height(PERF_BAR_TIMES[i]);
+    SDL_RenderDrawLine(renderer, x, line_y, x + PERF_GRAPH_FRAMES - 1,
+                       line_y);
+  }
+}
+
+void perf_overlay_render(perf_overlay_t *overlay, int x, int y) {
+#ifdef HEADLESS
+  // There is no renderer to draw to
+  (void)overlay;
+  (void)x;
+  (void)y;
+#else
+  if (!overlay->is_shown) {
+    return;
+  }
+  // Most runs never show the overlay, so startup does not pay for the atlas
+  if (overlay->atlas == NULL) {
+    TTF_Font *font = (TTF_Font *)asset_cache_obj_get_or_create(
+        ASSET_FONT, overlay->font_path);
+    assert(font);
+    build_atlas(overlay, font);
+  }
+  char lines[PERF_NUM_LINES][PERF_LINE_LEN];
+  format_lines(overlay, lines);
+  int width = PERF_GRAPH_FRAMES;
+  for (size_t i = 0; i < PERF_NUM_LINES; i++) {
+    int line_width = measure_text(overlay, lines[i]);
+    width = line_width > width ? line_width : width;
+  }
+  int text_height = PERF_NUM_LINES * overlay->line_height;
+
+  SDL_Renderer *renderer = sdl_get_renderer();
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_Color c = PERF_BACKGROUND_COLOR;
+  SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+  SDL_Rect background = {x, y, width + 2 * PERF_PADDING,
+                         text_height + PERF_GRAPH_HEIGHT + 3 * PERF_PADDING};
+  SDL_RenderFillRect(renderer, &background);
+
+  for (size_t i = 0; i < PERF_NUM_LINES; i++) {
+    draw_text(overlay, x + PERF_PADDING,
+              y + PERF_PADDING + i * overlay->line_height, lines[i]);
+  }
+  draw_graph(overlay, x + PERF_PADDING, y + 2 * PERF_PADDING + text_height);
+  // The rest of the wrapper draws opaque shapes
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+#endif
+}
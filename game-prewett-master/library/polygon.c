@@ -6,6 +6,9 @@
 
 #include "color.h"
 
+#define ALLOC_SUBSYSTEM ALLOC_POLYGON
+#include "alloc_track.h"
+
 struct polygon {
   list_t *points;
   vector_t velocity;
@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include "prefab.h"
+
+// The width and height of a block or spike, the thickness of the strip on
+// top of a block and of its side, and the width and height of a coin
+#define PREFAB_UNIT 40.0
+#define PREFAB_WALL 5.0
+#define PREFAB_COIN_SIZE 30.0
+
+#define PART_BOX(center_x, center_y, width, height, part_tag)                 \
+  {.min = {(center_x) - (width) / 2, (center_y) - (height) / 2},              \
+   .max = {(center_x) + (width) / 2, (center_y) + (height) / 2},              \
+   .tag = (part_tag)}
+
+// The parts of a block of height `h` centered (x, y) from the anchor: a strip
+// on top that can be landed on, a lethal left side, and the square drawn as
+// the block itself
+#define BLOCK_PARTS(x, y, h)                                                  \
+  PART_BOX((x), (y) + (h) / 2, PREFAB_UNIT, PREFAB_WALL - 2, PART_LANDING),   \
+      PART_BOX((x)-PREFAB_UNIT / 2 + PREFAB_WALL / 2, (y)-2, PREFAB_WALL,     \
+               (h)-3 * PREFAB_WALL, PART_SIDE),                               \
+      PART_BOX((x), (y), PREFAB_UNIT, (h), PART_BLOCK)
+
+// A spike centered (x, y) from the anchor
+#define SPIKE_PART(x, y)                                                      \
+  PART_BOX((x), (y), PREFAB_UNIT, PREFAB_UNIT, PART_SPIKE)
+
+static const level_part_t BLOCK[] = {BLOCK_PARTS(0, 0, PREFAB_UNIT)};
+static const level_part_t SPIKE[] = {SPIKE_PART(0, 0)};
+static const level_part_t DOUBLE_SPIKE[] = {SPIKE_PART(0, 0),
+                                            SPIKE_PART(PREFAB_UNIT, 0)};
+static const level_part_t TRIPLE_SPIKE[] = {SPIKE_PART(0, 0),
+                                            SPIKE_PART(PREFAB_UNIT, 0),
+                                            SPIKE_PART(2 * PREFAB_UNIT, 0)};
+static const level_part_t TRIPLE_BLOCK[] = {
+    BLOCK_PARTS(0, 0, PREFAB_UNIT),
+    BLOCK_PARTS(PREFAB_UNIT, 0, PREFAB_UNIT),
+    BLOCK_PARTS(2 * PREFAB_UNIT, 0, PREFAB_UNIT),
+};
+static const level_part_t FIVE_BLOCK[] = {
+    BLOCK_PARTS(0, 0, PREFAB_UNIT),
+    BLOCK_PARTS(PREFAB_UNIT, 0, PREFAB_UNIT),
+    BLOCK_PARTS(2 * PREFAB_UNIT, 0, PREFAB_UNIT),
+    BLOCK_PARTS(3 * PREFAB_UNIT, 0, PREFAB_UNIT),
+    BLOCK_PARTS(4 * PREFAB_UNIT, 0, PREFAB_UNIT),
+};
+static const level_part_t DOUBLE_STAIRCASE[] = {
+    BLOCK_PARTS(0, 0, PREFAB_UNIT),
+    BLOCK_PARTS(6 * PREFAB_UNIT, 20, 2 * PREFAB_UNIT),
+};
+static const level_part_t TRIPLE_STAIRCASE[] = {
+    BLOCK_PARTS(0, 0, PREFAB_UNIT),
+    BLOCK_PARTS(5 * PREFAB_UNIT, 20, 2 * PREFAB_UNIT),
+    BLOCK_PARTS(10 * PREFAB_UNIT, 40, 3 * PREFAB_UNIT),
+};
+
+// An obstacle anchored on a square the size of one block
+#define OBSTACLE_SHAPE(part_list)                                             \
+  {.size = {PREFAB_UNIT, PREFAB_UNIT},                                        \
+   .num_parts = sizeof(part_list) / sizeof(level_part_t),                     \
+   .parts = (part_list)}
+
+const char *const PREFAB_NAMES[NUM_PREFABS] = {
+    [PREFAB_BLOCK] = "block",
+    [PREFAB_SPIKE] = "spike",
+    [PREFAB_DOUBLE_SPIKE] = "double_spike",
+    [PREFAB_TRIPLE_SPIKE] = "triple_spike",
+    [PREFAB_TRIPLE_BLOCK] = "triple_block",
+    [PREFAB_FIVE_BLOCK] = "five_block",
+    [PREFAB_DOUBLE_STAIRCASE] = "double_staircase",
+    [PREFAB_TRIPLE_STAIRCASE] = "triple_staircase",
+    [PREFAB_COIN] = "coin",
+};
+
+const level_shape_t PREFAB_SHAPES[NUM_PREFABS] = {
+    [PREFAB_BLOCK] = OBSTACLE_SHAPE(BLOCK),
+    [PREFAB_SPIKE] = OBSTACLE_SHAPE(SPIKE),
+    [PREFAB_DOUBLE_SPIKE] = OBSTACLE_SHAPE(DOUBLE_SPIKE),
+    [PREFAB_TRIPLE_SPIKE] = OBSTACLE_SHAPE(TRIPLE_SPIKE),
+    [PREFAB_TRIPLE_BLOCK] = OBSTACLE_SHAPE(TRIPLE_BLOCK),
+    [PREFAB_FIVE_BLOCK] = OBSTACLE_SHAPE(FIVE_BLOCK),
+    [PREFAB_DOUBLE_STAIRCASE] = OBSTACLE_SHAPE(DOUBLE_STAIRCASE),
+    [PREFAB_TRIPLE_STAIRCASE] = OBSTACLE_SHAPE(TRIPLE_STAIRCASE),
+    [PREFAB_COIN] = {.size = {PREFAB_COIN_SIZE, PREFAB_COIN_SIZE},
+                     .num_parts = 0,
+                     .parts = NULL},
+};
+
+static const prefab_kind_t LEVEL1_KINDS[] = {PREFAB_BLOCK,
+                                             PREFAB_BLOCK,
+                                             PREFAB_BLOCK,
+                                             PREFAB_BLOCK,
+                                             PREFAB_SPIKE,
+                                             PREFAB_SPIKE,
+                                             PREFAB_SPIKE,
+                                             PREFAB_SPIKE,
+                                             PREFAB_DOUBLE_SPIKE,
+                                             PREFAB_DOUBLE_SPIKE,
+                                             PREFAB_TRIPLE_STAIRCASE,
+                                             PREFAB_TRIPLE_STAIRCASE,
+                                             PREFAB_FIVE_BLOCK,
+                                             PREFAB_FIVE_BLOCK,
+                                             PREFAB_TRIPLE_BLOCK,
+                                             PREFAB_TRIPLE_BLOCK};
+
+static const prefab_kind_t LEVEL2_KINDS[] = {PREFAB_BLOCK,
+                                             PREFAB_BLOCK,
+                                             PREFAB_SPIKE,
+                                             PREFAB_SPIKE,
+                                             PREFAB_DOUBLE_SPIKE,
+                                             PREFAB_DOUBLE_SPIKE,
+                                             PREFAB_DOUBLE_STAIRCASE,
+                                             PREFAB_DOUBLE_STAIRCASE,
+                                             PREFAB_FIVE_BLOCK,
+                                             PREFAB_FIVE_BLOCK,
+                                             PREFAB_TRIPLE_BLOCK,
+                                             PREFAB_TRIPLE_BLOCK,
+                                             PREFAB_TRIPLE_SPIKE};
+
+const spawn_table_t SPAWN_TABLES[NUM_SPAWN_TABLES] = {
+    {.name = "level1",
+     .velocity = -260,
+     .interval = 2.0,
+     .num_kinds = sizeof(LEVEL1_KINDS) / sizeof(LEVEL1_KINDS[0]),
+     .kinds = LEVEL1_KINDS},
+    {.name = "level2",
+     .velocity = -330,
+     .interval = 1.5,
+     .num_kinds = sizeof(LEVEL2_KINDS) / sizeof(LEVEL2_KINDS[0]),
+     .kinds = LEVEL2_KINDS},
+};
+
+prefab_kind_t prefab_find(const char *name) {
+  for (size_t i = 0; i < NUM_PREFABS; i++) {
+    if (strcmp(name, PREFAB_NAMES[i]) == 0) {
+      return i;
+    }
+  }
+  return NUM_PREFABS;
+}
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+#include "profiler.h"
+
+const double PROFILER_NS_PER_US = 1e3;
+
+// The zones recorded by one thread. Buffers are kept after their thread
+// exits so its zones are still dumped.
+typedef struct profiler_buffer {
+  struct profiler_buffer *next;
+  size_t thread_index;
+  // The number of zones ever recorded; the latest are at count % size
+  size_t count;
+  uint64_t starts[PROFILER_MAX_DEPTH];
+  const char *names[PROFILER_MAX_DEPTH];
+  size_t depth;
+  profiler_event_t events[PROFILER_BUFFER_EVENTS];
+} profiler_buffer_t;
+
+static _Atomic(profiler_buffer_t *) buffers = NULL;
+static atomic_size_t num_threads = 0;
+static _Thread_local profiler_buffer_t *thread_buffer = NULL;
+
+// Makes the calling thread's buffer on its first zone
+static profiler_buffer_t *get_thread_buffer(void) {
+  if (thread_buffer == NULL) {
+    profiler_buffer_t *buffer = malloc(sizeof(profiler_buffer_t));
+    assert(buffer);
+    buffer->thread_index = atomic_fetch_add(&num_threads, 1);
+    buffer->count = 0;
+    buffer->depth = 0;
+    buffer->next = atomic_load(&buffers);
+    while (!atomic_compare_exchange_weak(&buffers, &buffer->next, buffer)) {
+    }
+    thread_buffer = buffer;
+  }
+  return thread_buffer;
+}
+
+int profiler_begin(const char *name) {
+  profiler_buffer_t *buffer = get_thread_buffer();
+  if (buffer->depth < PROFILER_MAX_DEPTH) {
+    buffer->names[buffer->depth] = name;
+    buffer->starts[buffer->depth] = now_ns();
+  }
+  buffer->depth++;
+  return 0;
+}
+
+void profiler_end(void) {
+  uint64_t end = now_ns();
+  profiler_buffer_t *buffer = get_thread_buffer();
+  assert(buffer->depth > 0 && "profiler_end() without profiler_begin()");
+  buffer->depth--;
+  if (buffer->depth < PROFILER_MAX_DEPTH) {
+    profiler_event_t *event =
+        &buffer->events[buffer->count % PROFILER_BUFFER_EVENTS];
+    event->name = buffer->names[buffer->depth];
+    event->start = buffer->starts[buffer->depth];
+    event->duration = end - event->start;
+    buffer->count++;
+  }
+}
+
+void profiler_end_scope(int *zone) { profiler_end(); }
+
+size_t profiler_mark(void) { return get_thread_buffer()->count; }
+
+uint64_t profiler_total(const char *name, size_t mark) {
+  profiler_buffer_t *buffer = get_thread_buffer();
+  if (buffer->count > PROFILER_BUFFER_EVENTS &&
+      mark < buffer->count - PROFILER_BUFFER_EVENTS) {
+    mark = buffer->count - PROFILER_BUFFER_EVENTS;
+  }
+  uint64_t total = 0;
+  for (size_t i = mark; i < buffer->count; i++) {
+    profiler_event_t *event = &buffer->events[i % PROFILER_BUFFER_EVENTS];
+    if (strcmp(event->name, name) == 0) {
+      total += event->duration;
+    }
+  }
+  return total;
+}
+
+bool profiler_dump(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  fprintf(file, "{\"traceEvents\":[\n");
+  bool is_first = true;
+  for (profiler_buffer_t *buffer = atomic_load(&buffers); buffer != NULL;
+       buffer = buffer->next) {
+    size_t first = buffer->count > PROFILER_BUFFER_EVENTS
+                       ? buffer->count - PROFILER_BUFFER_EVENTS
+                       : 0;
+    for (size_t i = first; i < buffer->count; i++) {
+      profiler_event_t *event = &buffer->events[i % PROFILER_BUFFER_EVENTS];
+      // Complete ("X") events, since each zone is recorded once it ends
+      fprintf(file,
+              "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"pid\":1,\"tid\":%zu}",
+              is_first ? "" : ",\n", event->name,
+              event->start / PROFILER_NS_PER_US,
+              event->duration / PROFILER_NS_PER_US, buffer->thread_index);
+      is_first = false;
+    }
+  }
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return fclose(file) == 0;
+}
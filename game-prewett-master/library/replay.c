@@ -0,0 +1,201 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+
+#define ALLOC_SUBSYSTEM ALLOC_GAME
+#include "alloc_track.h"
+
+const double REPLAY_MS_PER_S = 1e3;
+// A uint64_t takes at most 10 groups of 7 bits
+const size_t MAX_VARINT_BYTES = 10;
+
+struct replay {
+  FILE *file;
+  bool is_recording;
+  uint64_t seed;
+  // The tick of the last event written or read, which the next is relative to
+  uint64_t last_tick;
+  // Playback reads one event ahead to know when it is due
+  replay_event_t pending;
+  bool has_pending;
+  bool is_done;
+};
+
+static void write_varint(FILE *file, uint64_t value) {
+  while (value >= 0x80) {
+    fputc((int)(value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+  fputc((int)value, file);
+}
+
+// Returns false at the end of the file or on a malformed varint
+static bool read_varint(FILE *file, uint64_t *value) {
+  *value = 0;
+  for (size_t i = 0; i < MAX_VARINT_BYTES; i++) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    *value |= (uint64_t)(byte & 0x7F) << (7 * i);
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Maps signed values to unsigned so small negative numbers stay short
+static uint64_t zigzag_encode(int32_t value) {
+  return ((uint64_t)(uint32_t)value << 1) ^ (uint64_t)(int64_t)(value >> 31);
+}
+
+static int32_t zigzag_decode(uint64_t value) {
+  return (int32_t)((value >> 1) ^ -(value & 1));
+}
+
+static replay_t *replay_init(FILE *file, bool is_recording, uint64_t seed) {
+  replay_t *replay = malloc(sizeof(replay_t));
+  assert(replay);
+  replay->file = file;
+  replay->is_recording = is_recording;
+  replay->seed = seed;
+  replay->last_tick = 0;
+  replay->has_pending = false;
+  replay->is_done = false;
+  return replay;
+}
+
+replay_t *replay_record(const char *path, uint64_t seed) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fwrite(REPLAY_MAGIC, 1, strlen(REPLAY_MAGIC), file);
+  write_varint(file, REPLAY_VERSION);
+  write_varint(file, seed);
+  return replay_init(file, true, seed);
+}
+
+replay_t *replay_open(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  char magic[4];
+  uint64_t version;
+  uint64_t seed;
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+      memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0 ||
+      !read_varint(file, &version) || version != REPLAY_VERSION ||
+      !read_varint(file, &seed)) {
+    fprintf(stderr, "Ignoring invalid recording %s\n", path);
+    fclose(file);
+    return NULL;
+  }
+  return replay_init(file, false, seed);
+}
+
+uint64_t replay_seed(replay_t *replay) { return replay->seed; }
+
+void replay_write(replay_t *replay, const replay_event_t *event) {
+  assert(replay->is_recording);
+  assert(event->tick >= replay->last_tick);
+  write_varint(replay->file, event->tick - replay->last_tick);
+  write_varint(replay->file, event->type);
+  switch (event->type) {
+  case REPLAY_KEY:
+    write_varint(replay->file, (unsigned char)event->key);
+    write_varint(replay->file, event->released);
+    write_varint(replay->file,
+                 (uint64_t)round(event->held_time * REPLAY_MS_PER_S));
+    break;
+  case REPLAY_CLICK:
+    write_varint(replay->file, zigzag_encode(event->x));
+    write_varint(replay->file, zigzag_encode(event->y));
+    break;
+  case REPLAY_END:
+    break;
+  }
+  replay->last_tick = event->tick;
+}
+
+// helper function for replay_next; returns false at the end of the stream
+static bool read_event(replay_t *replay, replay_event_t *event) {
+  uint64_t delta;
+  uint64_t type;
+  if (!read_varint(replay->file, &delta) ||
+      !read_varint(replay->file, &type)) {
+    return false;
+  }
+  memset(event, 0, sizeof(*event));
+  event->type = type;
+  event->tick = replay->last_tick + delta;
+  replay->last_tick = event->tick;
+
+  uint64_t fields[3];
+  switch (type) {
+  case REPLAY_KEY:
+    if (!read_varint(replay->file, &fields[0]) ||
+        !read_varint(replay->file, &fields[1]) ||
+        !read_varint(replay->file, &fields[2])) {
+      return false;
+    }
+    event->key = (char)fields[0];
+    event->released = fields[1] != 0;
+    event->held_time = fields[2] / REPLAY_MS_PER_S;
+    return true;
+  case REPLAY_CLICK:
+    if (!read_varint(replay->file, &fields[0]) ||
+        !read_varint(replay->file, &fields[1])) {
+      return false;
+    }
+    event->x = zigzag_decode(fields[0]);
+    event->y = zigzag_decode(fields[1]);
+    return true;
+  case REPLAY_END:
+    return true;
+  default:
+    // A type from a newer version, which cannot be skipped
+    return false;
+  }
+}
+
+bool replay_next(replay_t *replay, uint64_t tick, replay_event_t *event) {
+  assert(!replay->is_recording);
+  if (replay->is_done) {
+    return false;
+  }
+  if (!replay->has_pending) {
+    if (!read_event(replay, &replay->pending)) {
+      replay->is_done = true;
+      return false;
+    }
+    replay->has_pending = true;
+  }
+  if (replay->pending.tick > tick) {
+    return false;
+  }
+  if (replay->pending.type == REPLAY_END) {
+    replay->is_done = true;
+    return false;
+  }
+  *event = replay->pending;
+  replay->has_pending = false;
+  return true;
+}
+
+bool replay_is_done(replay_t *replay) { return replay->is_done; }
+
+void replay_close(replay_t *replay, uint64_t tick) {
+  if (replay->is_recording) {
+    replay_event_t end = {.type = REPLAY_END, .tick = tick};
+    replay_write(replay, &end);
+  }
+  fclose(replay->file);
+  free(replay);
+}
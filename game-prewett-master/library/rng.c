@@ -0,0 +1,33 @@
+#include <assert.h>
+
+#include "rng.h"
+
+const uint64_t RNG_MULTIPLIER = 0x2545F4914F6CDD1DULL;
+const double RNG_32_BIT_RANGE = 4294967296.0;
+
+void rng_seed(rng_t *rng, uint64_t seed) {
+  // xorshift gets stuck at 0, so mix the seed with splitmix64 first
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  rng->state = z ? z : 1;
+}
+
+uint32_t rng_next(rng_t *rng) {
+  uint64_t x = rng->state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  rng->state = x;
+  // The high bits are the best distributed
+  return (uint32_t)((x * RNG_MULTIPLIER) >> 32);
+}
+
+double rng_double(rng_t *rng) { return rng_next(rng) / RNG_32_BIT_RANGE; }
+
+size_t rng_range(rng_t *rng, size_t n) {
+  assert(n > 0);
+  // Multiply-shift rather than modulo, so the result uses the high bits
+  return (size_t)(((uint64_t)rng_next(rng) * n) >> 32);
+}
@@ -1,13 +1,23 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "counters.h"
 #include "forces.h"
+#include "profiler.h"
 #include "scene.h"
 
+#define ALLOC_SUBSYSTEM ALLOC_BODY
+#include "alloc_track.h"
+
 const size_t BODIES_INIT = 0;
 const size_t CAPACITY_INIT = 10;
+const size_t SNAPSHOT_INIT_CAPACITY = 4096;
+// Entries are padded so each body's state is aligned for its doubles
+const size_t SNAPSHOT_ALIGNMENT = sizeof(double);
 
 struct scene {
   size_t num_bodies;
@@ -16,6 +26,23 @@ struct scene {
   list_t *force_creator_list;
 };
 
+// Holds an entry per body and then per force creator, in scene order. Each
+// entry is a header, to check the body or forcer still matches, and then its
+// state.
+typedef struct {
+  void *owner;
+  // Entries are walked by their saved size, never the current owner's
+  size_t state_size;
+} snapshot_header_t;
+
+struct scene_snapshot {
+  size_t num_bodies;
+  size_t num_forcers;
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+};
+
 scene_t *scene_init(void) {
   scene_t *scene = malloc(sizeof(scene_t));
   assert(scene != NULL);
@@ -36,6 +63,10 @@ void scene_free(scene_t *scene) {
 
 size_t scene_bodies(scene_t *scene) { return scene->num_bodies; }
 
+size_t scene_force_creators(scene_t *scene) {
+  return list_size(scene->force_creator_list);
+}
+
 body_t *scene_get_body(scene_t *scene, size_t index) {
   return list_get(scene->bodies, index);
 }
@@ -51,11 +82,23 @@ void scene_remove_body(scene_t *scene, size_t index) {
   body_remove(list_get(scene->bodies, index));
 }
 
+// Returns whether any of the bodies a force creator acts on is asleep
+static bool forcer_is_asleep(forcer_t *force) {
+  for (size_t i = 0; i < list_size(force->bodies); i++) {
+    if (body_is_asleep(list_get(force->bodies, i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void scene_tick(scene_t *scene, double dt) {
+  PROFILE_ZONE("scene_tick");
   for (size_t i = 0; i < list_size(scene->force_creator_list); i++) {
     forcer_t *force = list_get(scene->force_creator_list, i);
-    if (force && force->creator) {
+    if (force && force->creator && !forcer_is_asleep(force)) {
       force->creator(force->aux);
+      COUNTER_INC(COUNTER_FORCE_CREATORS);
     }
   }
 
@@ -81,10 +124,12 @@ void scene_tick(scene_t *scene, double dt) {
       }
       list_remove(scene->bodies, i);
       body_free(current_body);
+      COUNTER_INC(COUNTER_BODIES_REMOVED);
       scene->num_bodies--;
       i--;
-    } else {
+    } else if (!body_is_asleep(current_body)) {
       body_tick(current_body, dt);
+      COUNTER_INC(COUNTER_BODIES_INTEGRATED);
     }
   }
 }
@@ -96,6 +141,128 @@ void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
 
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies) {
+  scene_add_stateful_force_creator(scene, forcer, aux, bodies, NULL, 0);
+}
+
+void scene_add_stateful_force_creator(scene_t *scene, force_creator_t forcer,
+                                      void *aux, list_t *bodies, void *state,
+                                      size_t state_size) {
   forcer_t *new_forcer = forcer_init(forcer, aux, bodies);
+  new_forcer->state = state;
+  new_forcer->state_size = state_size;
   list_add(scene->force_creator_list, new_forcer);
 }
+
+scene_snapshot_t *scene_snapshot_init(void) {
+  scene_snapshot_t *snapshot = malloc(sizeof(scene_snapshot_t));
+  assert(snapshot != NULL);
+  snapshot->num_bodies = 0;
+  snapshot->num_forcers = 0;
+  snapshot->size = 0;
+  snapshot->capacity = SNAPSHOT_INIT_CAPACITY;
+  snapshot->data = malloc(snapshot->capacity);
+  assert(snapshot->data != NULL);
+  return snapshot;
+}
+
+void scene_snapshot_free(scene_snapshot_t *snapshot) {
+  free(snapshot->data);
+  free(snapshot);
+}
+
+size_t scene_snapshot_size(scene_snapshot_t *snapshot) {
+  return snapshot->size;
+}
+
+size_t scene_snapshot_bodies(scene_snapshot_t *snapshot) {
+  return snapshot->num_bodies;
+}
+
+static size_t entry_size(size_t state_size) {
+  size_t size = sizeof(snapshot_header_t) + state_size;
+  return (size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT *
+         SNAPSHOT_ALIGNMENT;
+}
+
+// Appends an entry for `owner` and returns where its state goes
+static uint8_t *snapshot_add(scene_snapshot_t *snapshot, void *owner,
+                             size_t state_size) {
+  size_t size = entry_size(state_size);
+  if (snapshot->size + size > snapshot->capacity) {
+    while (snapshot->size + size > snapshot->capacity) {
+      snapshot->capacity *= 2;
+    }
+    snapshot->data = realloc(snapshot->data, snapshot->capacity);
+    assert(snapshot->data != NULL);
+  }
+  uint8_t *entry = snapshot->data + snapshot->size;
+  snapshot_header_t header = {.owner = owner, .state_size = state_size};
+  memcpy(entry, &header, sizeof(header));
+  snapshot->size += size;
+  return entry + sizeof(header);
+}
+
+void scene_save(scene_t *scene, scene_snapshot_t *snapshot) {
+  snapshot->size = 0;
+  snapshot->num_bodies = scene->num_bodies;
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    body_save_state(body, snapshot_add(snapshot, body, body_state_size(body)));
+  }
+  snapshot->num_forcers = list_size(scene->force_creator_list);
+  for (size_t i = 0; i < snapshot->num_forcers; i++) {
+    forcer_t *force = list_get(scene->force_creator_list, i);
+    memcpy(snapshot_add(snapshot, force, force->state_size), force->state,
+           force->state_size);
+  }
+}
+
+// Checks that the entry at `offset` belongs to `owner` and has as much state
+// as it has now. A body freed and replaced by one at the same address with a
+// different number of points fails the second check.
+static bool entry_matches(scene_snapshot_t *snapshot, size_t offset,
+                          void *owner, size_t state_size) {
+  snapshot_header_t header;
+  memcpy(&header, snapshot->data + offset, sizeof(header));
+  return header.owner == owner && header.state_size == state_size;
+}
+
+bool scene_restore(scene_t *scene, scene_snapshot_t *snapshot) {
+  if (snapshot->num_bodies > scene->num_bodies ||
+      snapshot->num_forcers > list_size(scene->force_creator_list)) {
+    return false;
+  }
+
+  // Check everything first so a failed restore changes nothing
+  size_t offset = 0;
+  for (size_t i = 0; i < snapshot->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    size_t state_size = body_state_size(body);
+    if (!entry_matches(snapshot, offset, body, state_size)) {
+      return false;
+    }
+    offset += entry_size(state_size);
+  }
+  for (size_t i = 0; i < snapshot->num_forcers; i++) {
+    forcer_t *force = list_get(scene->force_creator_list, i);
+    if (!entry_matches(snapshot, offset, force, force->state_size)) {
+      return false;
+    }
+    offset += entry_size(force->state_size);
+  }
+
+  offset = 0;
+  for (size_t i = 0; i < snapshot->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    size_t state_size = body_state_size(body);
+    body_load_state(body, snapshot->data + offset + sizeof(snapshot_header_t));
+    offset += entry_size(state_size);
+  }
+  for (size_t i = 0; i < snapshot->num_forcers; i++) {
+    forcer_t *force = list_get(scene->force_creator_list, i);
+    memcpy(force->state, snapshot->data + offset + sizeof(snapshot_header_t),
+           force->state_size);
+    offset += entry_size(force->state_size);
+  }
+  return true;
+}
@@ -1,11 +1,17 @@
 #include "sdl_wrapper.h"
 #include "asset_cache.h"
+#include "clock.h"
+#include "counters.h"
+#include "profiler.h"
+#include "startup.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
-#include <time.h>
+
+#define ALLOC_SUBSYSTEM ALLOC_RENDER
+#include "alloc_track.h"
 
 const char WINDOW_TITLE[] = "CS 3";
 const int WINDOW_WIDTH = 1000;
@@ -15,6 +21,8 @@ const double MS_PER_S = 1e3;
 const int COLOR_R = 255;
 const int COLOR_G = 255;
 const int COLOR_B = 255;
+// Polygons with up to this many vertices are converted on the stack
+#define POLYGON_STACK_POINTS 64
 
 /**
  * The coordinate at the center of the screen.
@@ -36,6 +44,14 @@ SDL_Renderer *renderer;
  * The keypress handler, or NULL if none has been configured.
  */
 key_handler_t key_handler = NULL;
+/**
+ * The mouse click handler, or NULL if none has been configured.
+ */
+click_handler_t click_handler = NULL;
+/**
+ * The render reset handler, or NULL if none has been configured.
+ */
+render_reset_handler_t render_reset_handler = NULL;
 
 /**
  * SDL's timestamp when a key was last pressed or released.
@@ -43,54 +59,180 @@ key_handler_t key_handler = NULL;
  */
 uint32_t key_start_timestamp;
 /**
- * The value of clock() when time_since_last_tick() was last called.
+ * Whether the window may no longer show what was last presented, because of
+ * input or something happening to the window. Cleared by sdl_show().
+ */
+bool is_damaged = true;
+/**
+ * The monotonic time in seconds when time_since_last_tick() was last called.
  * Initially 0.
  */
-clock_t last_clock = 0;
+double last_tick_time = 0;
+
+/**
+ * The texture format the renderer uploads fastest, or SDL_PIXELFORMAT_UNKNOWN
+ * until it is first looked up.
+ */
+Uint32 preferred_format = SDL_PIXELFORMAT_UNKNOWN;
+
+/**
+ * Gets the first texture format the renderer supports natively that keeps an
+ * alpha channel, since the sprites rely on transparency.
+ */
+static Uint32 get_preferred_format(void) {
+  if (preferred_format != SDL_PIXELFORMAT_UNKNOWN) {
+    return preferred_format;
+  }
+  preferred_format = SDL_PIXELFORMAT_ARGB8888;
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) == 0) {
+    for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+      if (SDL_ISPIXELFORMAT_ALPHA(info.texture_formats[i])) {
+        preferred_format = info.texture_formats[i];
+        break;
+      }
+    }
+  }
+  return preferred_format;
+}
+
+/**
+ * Box filters an ARGB8888 surface down to `width` x `height`. Each destination
+ * pixel is the alpha-weighted average of the source pixels it covers, so
+ * transparent edges do not bleed dark fringes into the sprite.
+ */
+static SDL_Surface *downscale_surface(SDL_Surface *src, int width,
+                                      int height) {
+  SDL_Surface *dst = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                    SDL_PIXELFORMAT_ARGB8888);
+  if (dst == NULL) {
+    return NULL;
+  }
+  SDL_LockSurface(src);
+  for (int dy = 0; dy < height; dy++) {
+    int y0 = dy * src->h / height;
+    int y1 = (dy + 1) * src->h / height;
+    if (y1 <= y0) {
+      y1 = y0 + 1;
+    }
+    Uint32 *dst_row = (Uint32 *)((Uint8 *)dst->pixels + dy * dst->pitch);
+    for (int dx = 0; dx < width; dx++) {
+      int x0 = dx * src->w / width;
+      int x1 = (dx + 1) * src->w / width;
+      if (x1 <= x0) {
+        x1 = x0 + 1;
+      }
+      Uint64 a = 0, r = 0, g = 0, b = 0;
+      for (int y = y0; y < y1; y++) {
+        Uint32 *src_row = (Uint32 *)((Uint8 *)src->pixels + y * src->pitch);
+        for (int x = x0; x < x1; x++) {
+          Uint32 pixel = src_row[x];
+          Uint32 alpha = pixel >> 24;
+          a += alpha;
+          r += ((pixel >> 16) & 0xff) * alpha;
+          g += ((pixel >> 8) & 0xff) * alpha;
+          b += (pixel & 0xff) * alpha;
+        }
+      }
+      Uint64 count = (Uint64)(x1 - x0) * (y1 - y0);
+      Uint32 pixel = 0;
+      if (a > 0) {
+        pixel = (Uint32)(a / count) << 24 | (Uint32)(r / a) << 16 |
+                (Uint32)(g / a) << 8 | (Uint32)(b / a);
+      }
+      dst_row[dx] = pixel;
+    }
+  }
+  SDL_UnlockSurface(src);
+  return dst;
+}
+
+SDL_Texture *sdl_load_texture(SDL_RWops *src, int width, int height,
+                              Uint32 format) {
+  if (src == NULL) {
+    return NULL;
+  }
+  SDL_Surface *surface = IMG_Load_RW(src, 1);
+  if (surface == NULL) {
+    return NULL;
+  }
+
+  if (width > 0 && height > 0 && (width < surface->w || height < surface->h)) {
+    width = width < surface->w ? width : surface->w;
+    height = height < surface->h ? height : surface->h;
+    SDL_Surface *argb =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(surface);
+    if (argb == NULL) {
+      return NULL;
+    }
+    surface = downscale_surface(argb, width, height);
+    SDL_FreeSurface(argb);
+    if (surface == NULL) {
+      return NULL;
+    }
+  }
+
+  if (format == SDL_PIXELFORMAT_UNKNOWN) {
+    format = get_preferred_format();
+  }
+  if (surface->format->format != format) {
+    SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+    SDL_FreeSurface(surface);
+    if (converted == NULL) {
+      return NULL;
+    }
+    surface = converted;
+  }
+
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
+  if (texture != NULL) {
+    COUNTER_INC(COUNTER_TEXTURES_CREATED);
+  }
+  return texture;
+}
 
 SDL_Texture *sdl_display(const char *path) {
-  SDL_Texture *img = IMG_LoadTexture(renderer, path);
-  return img;
+  return sdl_load_texture(SDL_RWFromFile(path, "rb"), 0, 0,
+                          SDL_PIXELFORMAT_UNKNOWN);
 }
 
 void sdl_render(SDL_Texture *texture, int x, int y, int w, int h) {
-  SDL_Rect *textr = malloc(sizeof(SDL_Rect));
-  textr->x = x;
-  textr->y = y;
-  textr->w = w;
-  textr->h = h;
-  SDL_RenderCopy(renderer, texture, NULL, textr);
+  SDL_Rect textr = {.x = x, .y = y, .w = w, .h = h};
+  SDL_RenderCopy(renderer, texture, NULL, &textr);
+  COUNTER_INC(COUNTER_DRAW_CALLS);
 }
 
 void text_display(SDL_Texture *Message, vector_t location) {
   int width, height;
   SDL_QueryTexture(Message, NULL, NULL, &width, &height);
-  SDL_Rect *Message_rect = malloc(sizeof(SDL_Rect));
-  Message_rect->x = location.x;
-  Message_rect->y = location.y;
-  Message_rect->w = width;
-  Message_rect->h = height;
-  SDL_RenderCopy(renderer, Message, NULL, Message_rect);
-  free(Message_rect);
+  SDL_Rect Message_rect = {
+      .x = location.x, .y = location.y, .w = width, .h = height};
+  SDL_RenderCopy(renderer, Message, NULL, &Message_rect);
+  COUNTER_INC(COUNTER_DRAW_CALLS);
 }
 
 SDL_Texture *text_render(const char *message, TTF_Font *font) {
+  PROFILE_ZONE("text_render");
   SDL_Color Color = {COLOR_R, COLOR_G, COLOR_B};
   SDL_Surface *surfaceMessage = TTF_RenderText_Solid(font, message, Color);
   SDL_Texture *Message = SDL_CreateTextureFromSurface(renderer, surfaceMessage);
   SDL_FreeSurface(surfaceMessage);
+  COUNTER_INC(COUNTER_TEXT_RASTERIZATIONS);
+  if (Message != NULL) {
+    COUNTER_INC(COUNTER_TEXTURES_CREATED);
+  }
   return Message;
 }
 
 /** Computes the center of the window in pixel coordinates */
 vector_t get_window_center(void) {
-  int *width = malloc(sizeof(*width)), *height = malloc(sizeof(*height));
-  assert(width != NULL);
-  assert(height != NULL);
-  SDL_GetWindowSize(window, width, height);
-  vector_t dimensions = {.x = *width, .y = *height};
-  free(width);
-  free(height);
+  int width = WINDOW_WIDTH, height = WINDOW_HEIGHT;
+#ifndef HEADLESS
+  SDL_GetWindowSize(window, &width, &height);
+#endif
+  vector_t dimensions = {.x = width, .y = height};
   return vec_multiply(0.5, dimensions);
 }
 
@@ -149,24 +291,52 @@ void sdl_init(vector_t min, vector_t max) {
 
   center = vec_multiply(0.5, vec_add(min, max));
   max_diff = vec_subtract(max, center);
-  SDL_Init(SDL_INIT_EVERYTHING);
+#ifdef HEADLESS
+  // No window or renderer; positions are computed for a default-sized window
+#else
+  // Only video (and the events it brings up) is needed to show a window;
+  // audio is opened by audio_init() when it is first needed
+  startup_begin(STARTUP_VIDEO);
+  SDL_InitSubSystem(SDL_INIT_VIDEO);
   window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
                             SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT,
                             SDL_WINDOW_RESIZABLE);
-  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  startup_end(STARTUP_VIDEO);
+
+  startup_begin(STARTUP_RENDERER);
+  // Frames are paced by the main loop (see pacer.h) rather than by vsync
+  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_TARGETTEXTURE);
+  startup_end(STARTUP_RENDERER);
+
+  startup_begin(STARTUP_TTF);
   TTF_Init();
+  startup_end(STARTUP_TTF);
+#endif
 }
 
 bool sdl_is_done(void *state) {
-  SDL_Event *event = malloc(sizeof(*event));
-  assert(event != NULL);
+  PROFILE_ZONE("sdl_is_done");
+  SDL_Event event_storage;
+  SDL_Event *event = &event_storage;
   while (SDL_PollEvent(event)) {
     switch (event->type) {
     case SDL_QUIT:
-      free(event);
       return true;
+    case SDL_WINDOWEVENT:
+      switch (event->window.event) {
+      case SDL_WINDOWEVENT_SHOWN:
+      case SDL_WINDOWEVENT_EXPOSED:
+      case SDL_WINDOWEVENT_SIZE_CHANGED:
+      case SDL_WINDOWEVENT_MAXIMIZED:
+      case SDL_WINDOWEVENT_RESTORED:
+        is_damaged = true;
+        break;
+      }
+      break;
     case SDL_KEYDOWN:
     case SDL_KEYUP:
+      // Whatever the input does, the frame showing it must be drawn
+      is_damaged = true;
       // Skip the keypress if no handler is configured
       // or an unrecognized key was pressed
       if (key_handler == NULL)
@@ -184,22 +354,30 @@ bool sdl_is_done(void *state) {
       double held_time = (timestamp - key_start_timestamp) / MS_PER_S;
       key_handler(key, type, held_time, state);
       break;
-    // implement mouse click on button
     case SDL_MOUSEBUTTONDOWN:
-      asset_cache_handle_buttons(state, event->button.x, event->button.y);
-      key_handler(UP_ARROW, KEY_PRESSED, 0, state);
+      is_damaged = true;
+      if (click_handler != NULL) {
+        click_handler(event->button.x, event->button.y, state);
+      }
       break;
     case SDL_MOUSEBUTTONUP:
       break;
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+      is_damaged = true;
+      if (render_reset_handler != NULL) {
+        render_reset_handler(state);
+      }
+      break;
     }
   }
-  free(event);
   return false;
 }
 
 void sdl_clear(void) {
   SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
   SDL_RenderClear(renderer);
+  COUNTER_INC(COUNTER_DRAW_CALLS);
 }
 
 void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
@@ -210,11 +388,16 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
 
   vector_t window_center = get_window_center();
 
-  // Convert each vertex to a point on screen
-  int16_t *x_points = malloc(sizeof(*x_points) * n),
-          *y_points = malloc(sizeof(*y_points) * n);
-  assert(x_points != NULL);
-  assert(y_points != NULL);
+  // Convert each vertex to a point on screen, allocating only for polygons
+  // too big for the stack
+  int16_t x_stack[POLYGON_STACK_POINTS], y_stack[POLYGON_STACK_POINTS];
+  int16_t *x_points = x_stack, *y_points = y_stack;
+  if (n > POLYGON_STACK_POINTS) {
+    x_points = malloc(sizeof(*x_points) * n);
+    y_points = malloc(sizeof(*y_points) * n);
+    assert(x_points != NULL);
+    assert(y_points != NULL);
+  }
   for (size_t i = 0; i < n; i++) {
     vector_t *vertex = list_get(points, i);
     vector_t pixel = get_window_position(*vertex, window_center);
@@ -225,27 +408,53 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
   // Draw polygon with the given color
   filledPolygonRGBA(renderer, x_points, y_points, n, color.r * 255,
                     color.g * 255, color.b * 255, 255);
-  free(x_points);
-  free(y_points);
+  COUNTER_INC(COUNTER_DRAW_CALLS);
+  if (x_points != x_stack) {
+    free(x_points);
+    free(y_points);
+  }
 }
 
 void sdl_show(void) {
+  PROFILE_ZONE("sdl_show");
   // Draw boundary lines
   vector_t window_center = get_window_center();
   vector_t max = vec_add(center, max_diff),
            min = vec_subtract(center, max_diff);
   vector_t max_pixel = get_window_position(max, window_center),
            min_pixel = get_window_position(min, window_center);
-  SDL_Rect *boundary = malloc(sizeof(*boundary));
-  boundary->x = min_pixel.x;
-  boundary->y = max_pixel.y;
-  boundary->w = max_pixel.x - min_pixel.x;
-  boundary->h = min_pixel.y - max_pixel.y;
+  SDL_Rect boundary = {.x = min_pixel.x,
+                       .y = max_pixel.y,
+                       .w = max_pixel.x - min_pixel.x,
+                       .h = min_pixel.y - max_pixel.y};
   SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-  SDL_RenderDrawRect(renderer, boundary);
-  free(boundary);
+  SDL_RenderDrawRect(renderer, &boundary);
+  COUNTER_INC(COUNTER_DRAW_CALLS);
 
   SDL_RenderPresent(renderer);
+  is_damaged = false;
+}
+
+bool sdl_is_damaged(void) { return is_damaged; }
+
+bool sdl_is_window_active(void) {
+#ifdef HEADLESS
+  return true;
+#else
+  Uint32 flags = SDL_GetWindowFlags(window);
+  return (flags & SDL_WINDOW_INPUT_FOCUS) &&
+         !(flags & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN));
+#endif
+}
+
+void sdl_wait_event(double timeout) {
+#ifdef HEADLESS
+  // There are no events to wait for
+  (void)timeout;
+#else
+  // A NULL event leaves the event queued for sdl_is_done()
+  SDL_WaitEventTimeout(NULL, (int)(timeout * MS_PER_S));
+#endif
 }
 
 void sdl_render_scene(scene_t *scene, void *aux) {
@@ -267,43 +476,28 @@ void sdl_render_scene(scene_t *scene, void *aux) {
 
 void sdl_on_key(key_handler_t handler) { key_handler = handler; }
 
+void sdl_on_click(click_handler_t handler) { click_handler = handler; }
+
+void sdl_on_render_reset(render_reset_handler_t handler) {
+  render_reset_handler = handler;
+}
+
 double time_since_last_tick(void) {
-  clock_t now = clock();
-  double difference = last_clock
-                          ? (double)(now - last_clock) / CLOCKS_PER_SEC
+  double now = now_seconds();
+  double difference = last_tick_time
+                          ? now - last_tick_time
                           : 0.0; // return 0 the first time this is called
-  last_clock = now;
+  last_tick_time = now;
   return difference;
 }
 
-SDL_Rect get_body_bounding_box(body_t *body) {
-  assert(body != NULL);
-  list_t *points = body_get_shape(body);
-  size_t n = list_size(points);
-  assert(n > 0);
-
-  vector_t *first_point = list_get(points, 0);
-  double min_x = first_point->x;
-  double max_x = first_point->x;
-  double min_y = first_point->y;
-  double max_y = first_point->y;
-
-  for (size_t i = 1; i < n; i++) {
-    vector_t *point = list_get(points, i);
-    if (point->x < min_x)
-      min_x = point->x;
-    if (point->x > max_x)
-      max_x = point->x;
-    if (point->y < min_y)
-      min_y = point->y;
-    if (point->y > max_y)
-      max_y = point->y;
-  }
+// Converts a box in scene coordinates to a rectangle on the window
+static SDL_Rect get_window_rect(vector_t min, vector_t max) {
   vector_t window_center = get_window_center();
   vector_t top_left =
-      get_window_position((vector_t){min_x, max_y}, window_center);
+      get_window_position((vector_t){min.x, max.y}, window_center);
   vector_t bottom_right =
-      get_window_position((vector_t){max_x, min_y}, window_center);
+      get_window_position((vector_t){max.x, min.y}, window_center);
 
   SDL_Rect bbox = {.x = (int)round(top_left.x),
                    .y = (int)round(top_left.y),
@@ -313,4 +507,18 @@ SDL_Rect get_body_bounding_box(body_t *body) {
   return bbox;
 }
 
+SDL_Rect get_body_bounding_box(body_t *body) {
+  assert(body != NULL);
+  vector_t min, max;
+  body_get_bounds(body, &min, &max);
+  return get_window_rect(min, max);
+}
+
+SDL_Rect get_part_bounding_box(body_t *body, size_t part) {
+  assert(body != NULL);
+  vector_t min, max;
+  body_get_part_bounds(body, part, &min, &max);
+  return get_window_rect(min, max);
+}
+
 SDL_Renderer *sdl_get_renderer(void) { return renderer; }
@@ -0,0 +1,70 @@
+#include <assert.h>
+#include <stdbool.h>
+
+#include "clock.h"
+#include "startup.h"
+
+const double STARTUP_MS_PER_S = 1e3;
+
+static const char *const STARTUP_PHASE_NAMES[NUM_STARTUP_PHASES] = {
+    [STARTUP_VIDEO] = "video",
+    [STARTUP_RENDERER] = "renderer",
+    [STARTUP_TTF] = "TTF",
+    [STARTUP_AUDIO] = "audio",
+    [STARTUP_ASSET_PRELOAD] = "asset preload",
+    [STARTUP_FIRST_FRAME] = "first frame",
+};
+
+// When startup began, or 0 before it has
+static double origin = 0;
+static double phase_starts[NUM_STARTUP_PHASES];
+static double phase_times[NUM_STARTUP_PHASES];
+static bool has_run[NUM_STARTUP_PHASES];
+static double first_frame_time = 0;
+// Where phases ending after the report are logged (or NULL)
+static FILE *log_file = NULL;
+
+void startup_begin(startup_phase_t phase) {
+  double now = now_seconds();
+  if (origin == 0) {
+    origin = now;
+  }
+  phase_starts[phase] = now;
+}
+
+void startup_end(startup_phase_t phase) {
+  assert(origin != 0);
+  double now = now_seconds();
+  double duration = now - phase_starts[phase];
+  phase_times[phase] += duration;
+  has_run[phase] = true;
+  if (phase == STARTUP_FIRST_FRAME && first_frame_time == 0) {
+    first_frame_time = now - origin;
+  }
+  if (log_file != NULL) {
+    fprintf(log_file, "Startup: %s took %.2f ms, %.2f ms after launch\n",
+            STARTUP_PHASE_NAMES[phase], duration * STARTUP_MS_PER_S,
+            (now - origin) * STARTUP_MS_PER_S);
+  }
+}
+
+double startup_phase_time(startup_phase_t phase) { return phase_times[phase]; }
+
+double startup_time_to_first_frame(void) { return first_frame_time; }
+
+void startup_report(FILE *file) {
+  fprintf(file, "Startup phases:\n");
+  for (size_t i = 0; i < NUM_STARTUP_PHASES; i++) {
+    if (has_run[i]) {
+      fprintf(file, "  %-14s %8.2f ms\n", STARTUP_PHASE_NAMES[i],
+              phase_times[i] * STARTUP_MS_PER_S);
+    } else {
+      fprintf(file, "  %-14s %8s\n", STARTUP_PHASE_NAMES[i], "not yet");
+    }
+  }
+  if (first_frame_time > 0) {
+    fprintf(file, "First frame presented %.2f ms after launch\n",
+            first_frame_time * STARTUP_MS_PER_S);
+  }
+  log_file = file;
+}
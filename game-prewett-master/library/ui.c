@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "list.h"
+#include "ui.h"
+
+#define ALLOC_SUBSYSTEM ALLOC_RENDER
+#include "alloc_track.h"
+
+const int UI_CELL_SIZE = 50;
+const size_t UI_CELL_CAPACITY = 2;
+
+struct ui_region {
+  asset_t *button;
+  SDL_Rect box;
+  size_t screen;
+  bool enabled;
+};
+
+static list_t *UI_REGIONS;
+static list_t **UI_CELLS;
+static size_t UI_COLS;
+static size_t UI_ROWS;
+static size_t UI_SCREEN = 0;
+
+void ui_init(int width, int height) {
+  assert(width > 0 && height > 0);
+  UI_REGIONS = list_init(UI_CELL_CAPACITY, free);
+  UI_COLS = (width + UI_CELL_SIZE - 1) / UI_CELL_SIZE;
+  UI_ROWS = (height + UI_CELL_SIZE - 1) / UI_CELL_SIZE;
+  UI_CELLS = malloc(UI_COLS * UI_ROWS * sizeof(list_t *));
+  assert(UI_CELLS);
+  for (size_t i = 0; i < UI_COLS * UI_ROWS; i++) {
+    UI_CELLS[i] = list_init(UI_CELL_CAPACITY, NULL);
+  }
+  UI_SCREEN = 0;
+}
+
+void ui_destroy(void) {
+  for (size_t i = 0; i < UI_COLS * UI_ROWS; i++) {
+    list_free(UI_CELLS[i]);
+  }
+  free(UI_CELLS);
+  list_free(UI_REGIONS);
+  UI_CELLS = NULL;
+  UI_REGIONS = NULL;
+}
+
+/**
+ * Clamps the cells overlapped by `box` to the grid.
+ * Returns false if the box lies entirely outside the grid.
+ */
+static bool get_cell_range(SDL_Rect box, size_t *col0, size_t *row0,
+                           size_t *col1, size_t *row1) {
+  if (box.w <= 0 || box.h <= 0 || box.x + box.w <= 0 || box.y + box.h <= 0) {
+    return false;
+  }
+  int first_col = box.x < 0 ? 0 : box.x / UI_CELL_SIZE;
+  int first_row = box.y < 0 ? 0 : box.y / UI_CELL_SIZE;
+  if ((size_t)first_col >= UI_COLS || (size_t)first_row >= UI_ROWS) {
+    return false;
+  }
+  size_t last_col = (box.x + box.w - 1) / UI_CELL_SIZE;
+  size_t last_row = (box.y + box.h - 1) / UI_CELL_SIZE;
+  *col0 = first_col;
+  *row0 = first_row;
+  *col1 = last_col < UI_COLS ? last_col : UI_COLS - 1;
+  *row1 = last_row < UI_ROWS ? last_row : UI_ROWS - 1;
+  return true;
+}
+
+ui_region_t *ui_add_button(asset_t *button, size_t screen) {
+  assert(asset_get_type(button) == ASSET_BUTTON);
+  ui_region_t *region = malloc(sizeof(ui_region_t));
+  assert(region);
+  region->button = button;
+  region->box = asset_get_bounding_box(button);
+  region->screen = screen;
+  region->enabled = true;
+  list_add(UI_REGIONS, region);
+
+  size_t col0, row0, col1, row1;
+  if (get_cell_range(region->box, &col0, &row0, &col1, &row1)) {
+    for (size_t row = row0; row <= row1; row++) {
+      for (size_t col = col0; col <= col1; col++) {
+        list_add(UI_CELLS[row * UI_COLS + col], region);
+      }
+    }
+  }
+  return region;
+}
+
+// helper function for ui_remove
+static void remove_from_list(list_t *list, ui_region_t *region) {
+  for (size_t i = 0; i < list_size(list); i++) {
+    if (list_get(list, i) == region) {
+      list_remove(list, i);
+      return;
+    }
+  }
+}
+
+void ui_remove(ui_region_t *region) {
+  size_t col0, row0, col1, row1;
+  if (get_cell_range(region->box, &col0, &row0, &col1, &row1)) {
+    for (size_t row = row0; row <= row1; row++) {
+      for (size_t col = col0; col <= col1; col++) {
+        remove_from_list(UI_CELLS[row * UI_COLS + col], region);
+      }
+    }
+  }
+  remove_from_list(UI_REGIONS, region);
+  free(region);
+}
+
+void ui_set_enabled(ui_region_t *region, bool enabled) {
+  region->enabled = enabled;
+}
+
+void ui_set_screen(size_t screen) { UI_SCREEN = screen; }
+
+size_t ui_get_screen(void) { return UI_SCREEN; }
+
+bool ui_handle_click(state_t *state, double x, double y) {
+  if (x < 0 || y < 0) {
+    return false;
+  }
+  size_t col = (size_t)x / UI_CELL_SIZE;
+  size_t row = (size_t)y / UI_CELL_SIZE;
+  if (col >= UI_COLS || row >= UI_ROWS) {
+    return false;
+  }
+
+  list_t *cell = UI_CELLS[row * UI_COLS + col];
+  for (size_t i = list_size(cell); i > 0; i--) {
+    ui_region_t *region = list_get(cell, i - 1);
+    SDL_Rect box = region->box;
+    if (region->enabled && region->screen == UI_SCREEN && x >= box.x &&
+        x < box.x + box.w && y >= box.y && y < box.y + box.h) {
+      // The handler may change screens or remove regions, so stop here
+      asset_on_button_click(region->button, state, x, y);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,260 @@
+/**
+ * Times the library's inner kernels: vector math, polygon geometry, list
+ * operations and collision tests.
+ *
+ * Usage: bench_kernels [--json] [filter]
+ *
+ * Only benchmarks whose names contain `filter` are run. Each result is the
+ * time per iteration: the median over the repetitions, with its median
+ * absolute deviation, after warming up. --json prints one JSON object per
+ * line instead of a table, so runs before and after a change can be compared
+ * by a script.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "collision.h"
+#include "list.h"
+#include "polygon.h"
+#include "rng.h"
+#include "vector.h"
+
+const uint64_t BENCH_SEED = 0x62656e63;
+// A power of 2, so iterations can cycle through the inputs with a mask
+#define NUM_VECTORS 1024
+const size_t LIST_LENGTH = 1024;
+const size_t VERTEX_COUNTS[] = {4, 16, 64};
+#define NUM_VERTEX_COUNTS (sizeof(VERTEX_COUNTS) / sizeof(VERTEX_COUNTS[0]))
+const double SHAPE_RADIUS = 20;
+// How far apart the centers of separated shapes are
+const double SEPARATION = 200;
+#define MAX_NAME_LEN 64
+
+static vector_t vectors[NUM_VECTORS];
+
+static void bench_vec_add(void *aux, size_t iterations) {
+  vector_t sum = VEC_ZERO;
+  for (size_t i = 0; i < iterations; i++) {
+    sum = vec_add(sum, vectors[i & (NUM_VECTORS - 1)]);
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+static void bench_vec_multiply(void *aux, size_t iterations) {
+  vector_t sum = VEC_ZERO;
+  for (size_t i = 0; i < iterations; i++) {
+    sum = vec_add(sum, vec_multiply(0.5, vectors[i & (NUM_VECTORS - 1)]));
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+static void bench_vec_dot(void *aux, size_t iterations) {
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    sum += vec_dot(vectors[i & (NUM_VECTORS - 1)],
+                   vectors[(i + 1) & (NUM_VECTORS - 1)]);
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+static void bench_vec_rotate(void *aux, size_t iterations) {
+  vector_t sum = VEC_ZERO;
+  for (size_t i = 0; i < iterations; i++) {
+    sum = vec_add(sum, vec_rotate(vectors[i & (NUM_VECTORS - 1)], 0.1));
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+static void bench_vec_get_length(void *aux, size_t iterations) {
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    sum += vec_get_length(vectors[i & (NUM_VECTORS - 1)]);
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+// Makes a regular polygon with its vertices in counterclockwise order
+static list_t *make_regular_polygon(vector_t center, size_t num_vertices) {
+  list_t *points = list_init(num_vertices, free);
+  for (size_t i = 0; i < num_vertices; i++) {
+    double angle = 2 * M_PI * i / num_vertices;
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point);
+    *point = (vector_t){center.x + SHAPE_RADIUS * cos(angle),
+                        center.y + SHAPE_RADIUS * sin(angle)};
+    list_add(points, point);
+  }
+  return points;
+}
+
+static polygon_t *make_polygon(size_t num_vertices) {
+  return polygon_init(make_regular_polygon(VEC_ZERO, num_vertices), VEC_ZERO,
+                      0, 0, 0, 0);
+}
+
+static void bench_polygon_centroid(void *aux, size_t iterations) {
+  vector_t sum = VEC_ZERO;
+  for (size_t i = 0; i < iterations; i++) {
+    sum = vec_add(sum, polygon_centroid(aux));
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+static void bench_polygon_area(void *aux, size_t iterations) {
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    sum += polygon_area(aux);
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+static void bench_polygon_rotate(void *aux, size_t iterations) {
+  for (size_t i = 0; i < iterations; i++) {
+    polygon_rotate(aux, 0.01, VEC_ZERO);
+  }
+  bench_consume(list_get(polygon_get_points(aux), 0), sizeof(vector_t));
+}
+
+// Adds LIST_LENGTH elements, then removes them all from the back
+static void bench_list_stack(void *aux, size_t iterations) {
+  list_t *list = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < LIST_LENGTH; j++) {
+      list_add(list, &vectors[j & (NUM_VECTORS - 1)]);
+    }
+    while (list_size(list) > 0) {
+      list_remove(list, list_size(list) - 1);
+    }
+  }
+  bench_consume(&list, sizeof(list));
+}
+
+// Adds LIST_LENGTH elements, then removes them all from the front
+static void bench_list_queue(void *aux, size_t iterations) {
+  list_t *list = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < LIST_LENGTH; j++) {
+      list_add(list, &vectors[j & (NUM_VECTORS - 1)]);
+    }
+    while (list_size(list) > 0) {
+      list_remove(list, 0);
+    }
+  }
+  bench_consume(&list, sizeof(list));
+}
+
+// Reads every element of a LIST_LENGTH list
+static void bench_list_get(void *aux, size_t iterations) {
+  list_t *list = aux;
+  double sum = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < list_size(list); j++) {
+      sum += ((vector_t *)list_get(list, j))->x;
+    }
+  }
+  bench_consume(&sum, sizeof(sum));
+}
+
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+} body_pair_t;
+
+static void bench_find_collision(void *aux, size_t iterations) {
+  body_pair_t *pair = aux;
+  size_t collided = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    collided += find_collision(pair->body1, pair->body2).collided;
+  }
+  bench_consume(&collided, sizeof(collided));
+}
+
+// Makes two bodies with `num_vertices` vertices each, `distance` apart
+static body_pair_t make_pair(size_t num_vertices, double distance) {
+  rgb_color_t color = {0, 0, 0};
+  body_pair_t pair = {
+      body_init(make_regular_polygon(VEC_ZERO, num_vertices), 1, color),
+      body_init(make_regular_polygon((vector_t){distance, 0}, num_vertices), 1,
+                color)};
+  return pair;
+}
+
+typedef struct {
+  bench_format_t format;
+  const char *filter;
+} run_options_t;
+
+static void run(const run_options_t *options, const char *name,
+                bench_func_t func, void *aux) {
+  if (!bench_matches(name, options->filter)) {
+    return;
+  }
+  bench_result_t result = bench_run(name, func, aux, &BENCH_DEFAULT_OPTIONS);
+  bench_print(stdout, &result, options->format);
+}
+
+int main(int argc, char **argv) {
+  run_options_t options = {.format = BENCH_TEXT, .filter = NULL};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      options.format = BENCH_JSON;
+    } else {
+      options.filter = argv[i];
+    }
+  }
+
+  rng_t rng;
+  rng_seed(&rng, BENCH_SEED);
+  for (size_t i = 0; i < NUM_VECTORS; i++) {
+    vectors[i] = (vector_t){rng_double(&rng) * 2 - 1, rng_double(&rng) * 2 - 1};
+  }
+
+  bench_print_header(stdout, options.format);
+  run(&options, "vec_add", bench_vec_add, NULL);
+  run(&options, "vec_multiply", bench_vec_multiply, NULL);
+  run(&options, "vec_dot", bench_vec_dot, NULL);
+  run(&options, "vec_rotate", bench_vec_rotate, NULL);
+  run(&options, "vec_get_length", bench_vec_get_length, NULL);
+
+  char names[NUM_VERTEX_COUNTS][5][MAX_NAME_LEN];
+  for (size_t i = 0; i < NUM_VERTEX_COUNTS; i++) {
+    size_t n = VERTEX_COUNTS[i];
+    polygon_t *polygon = make_polygon(n);
+    snprintf(names[i][0], MAX_NAME_LEN, "polygon_centroid/%zu", n);
+    run(&options, names[i][0], bench_polygon_centroid, polygon);
+    snprintf(names[i][1], MAX_NAME_LEN, "polygon_area/%zu", n);
+    run(&options, names[i][1], bench_polygon_area, polygon);
+    snprintf(names[i][2], MAX_NAME_LEN, "polygon_rotate/%zu", n);
+    run(&options, names[i][2], bench_polygon_rotate, polygon);
+    polygon_free(polygon);
+  }
+
+  list_t *list = list_init(LIST_LENGTH, NULL);
+  run(&options, "list_add+remove_back/1024", bench_list_stack, list);
+  run(&options, "list_add+remove_front/1024", bench_list_queue, list);
+  for (size_t i = 0; i < LIST_LENGTH; i++) {
+    list_add(list, &vectors[i & (NUM_VECTORS - 1)]);
+  }
+  run(&options, "list_get/1024", bench_list_get, list);
+  list_free(list);
+
+  for (size_t i = 0; i < NUM_VERTEX_COUNTS; i++) {
+    size_t n = VERTEX_COUNTS[i];
+    // Overlapping by half a radius, and too far apart to touch
+    body_pair_t overlapping = make_pair(n, 1.5 * SHAPE_RADIUS);
+    body_pair_t separated = make_pair(n, SEPARATION);
+    snprintf(names[i][3], MAX_NAME_LEN, "find_collision/overlapping/%zu", n);
+    run(&options, names[i][3], bench_find_collision, &overlapping);
+    snprintf(names[i][4], MAX_NAME_LEN, "find_collision/separated/%zu", n);
+    run(&options, names[i][4], bench_find_collision, &separated);
+    body_free(overlapping.body1);
+    body_free(overlapping.body2);
+    body_free(separated.body1);
+    body_free(separated.body2);
+  }
+  return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * Measures how scene_tick() scales with the size of a scene, by building
+ * synthetic scenes of 10 to 100k bodies through the public scene and forces
+ * APIs and ticking them.
+ *
+ * Usage: bench_scene [--json] [ticks=50] [max_bodies=100000]
+ *
+ * Each body is a small square on a grid with a random velocity, and gets:
+ *  - drag,
+ *  - Newtonian gravity towards one of a few heavy attractors,
+ *  - a spring to the next body on every other body,
+ *  - physics collisions with its right and upper neighbors,
+ * so a scene of n bodies has about 4.5n force creators, 2n of which run a
+ * collision test every tick.
+ *
+ * For each size, the median and MAD of the time per tick are reported along
+ * with the time per body and the peak resident set size. Sizes run in
+ * increasing order in one process, so the peak RSS of a size is that of the
+ * largest scene built so far.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "bench_util.h"
+#include "clock.h"
+#include "forces.h"
+#include "rng.h"
+#include "scene.h"
+
+const size_t SCENE_SIZES[] = {10, 100, 1000, 10000, 100000};
+#define NUM_SCENE_SIZES (sizeof(SCENE_SIZES) / sizeof(SCENE_SIZES[0]))
+const size_t DEFAULT_TICKS = 50;
+const uint64_t SCENE_SEED = 0x7363656e;
+const double TICK_DT = 1.0 / 120;
+
+const double BODY_SIZE = 2;
+// Far enough apart that most neighbors are not touching at the start
+const double GRID_SPACING = 6;
+const double MAX_SPEED = 20;
+#define NUM_ATTRACTORS 4
+const double ATTRACTOR_MASS = 1e6;
+const double GRAVITY_G = 1e-3;
+const double SPRING_K = 0.5;
+const double DRAG_GAMMA = 0.1;
+const double ELASTICITY_FACTOR = 0.9;
+
+typedef struct {
+  scene_t *scene;
+  size_t num_bodies;
+  size_t num_forcers;
+} bench_scene_t;
+
+static list_t *make_square(vector_t center, double size) {
+  list_t *points = list_init(4, free);
+  vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point);
+    *point = vec_add(center, vec_multiply(size / 2, corners[i]));
+    list_add(points, point);
+  }
+  return points;
+}
+
+static bench_scene_t build_scene(size_t num_bodies, rng_t *rng) {
+  bench_scene_t bench = {.scene = scene_init(), .num_bodies = num_bodies};
+  rgb_color_t color = {0, 0, 0};
+  size_t columns = (size_t)ceil(sqrt(num_bodies));
+
+  body_t *attractors[NUM_ATTRACTORS];
+  double width = columns * GRID_SPACING;
+  for (size_t i = 0; i < NUM_ATTRACTORS; i++) {
+    vector_t corner = {i % 2 * width, i / 2 * width};
+    attractors[i] =
+        body_init(make_square(corner, BODY_SIZE), ATTRACTOR_MASS, color);
+    scene_add_body(bench.scene, attractors[i]);
+  }
+
+  body_t **bodies = malloc(num_bodies * sizeof(body_t *));
+  assert(bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    vector_t center = {i % columns * GRID_SPACING, i / columns * GRID_SPACING};
+    bodies[i] = body_init(make_square(center, BODY_SIZE), 1, color);
+    body_set_velocity(bodies[i],
+                      (vector_t){(rng_double(rng) * 2 - 1) * MAX_SPEED,
+                                 (rng_double(rng) * 2 - 1) * MAX_SPEED});
+    scene_add_body(bench.scene, bodies[i]);
+  }
+
+  for (size_t i = 0; i < num_bodies; i++) {
+    create_drag(bench.scene, DRAG_GAMMA, bodies[i]);
+    create_newtonian_gravity(bench.scene, GRAVITY_G, bodies[i],
+                             attractors[i % NUM_ATTRACTORS]);
+    bench.num_forcers += 2;
+    if (i % 2 == 0 && i + 1 < num_bodies) {
+      create_spring(bench.scene, SPRING_K, bodies[i], bodies[i + 1]);
+      bench.num_forcers++;
+    }
+    if ((i + 1) % columns != 0 && i + 1 < num_bodies) {
+      create_physics_collision(bench.scene, bodies[i], bodies[i + 1],
+                               ELASTICITY_FACTOR);
+      bench.num_forcers++;
+    }
+    if (i + columns < num_bodies) {
+      create_physics_collision(bench.scene, bodies[i], bodies[i + columns],
+                               ELASTICITY_FACTOR);
+      bench.num_forcers++;
+    }
+  }
+  free(bodies);
+  return bench;
+}
+
+static void tick_scene(void *aux, size_t iterations) {
+  bench_scene_t *bench = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    scene_tick(bench->scene, TICK_DT);
+  }
+}
+
+// Gets the peak resident set size of the process in MiB
+static double get_peak_rss(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+  return usage.ru_maxrss / 1024.0; // KiB
+#endif
+}
+
+int main(int argc, char **argv) {
+  bool is_json = false;
+  size_t ticks = DEFAULT_TICKS;
+  size_t max_bodies = SCENE_SIZES[NUM_SCENE_SIZES - 1];
+  size_t num_numbers = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      is_json = true;
+    } else if (num_numbers++ == 0) {
+      ticks = strtoul(argv[i], NULL, 10);
+    } else {
+      max_bodies = strtoul(argv[i], NULL, 10);
+    }
+  }
+  assert(ticks > 0);
+
+  // One tick per repetition, after a single untimed tick
+  bench_options_t options = {
+      .warmup_time = 0, .min_repetition_time = 0, .repetitions = ticks};
+  rng_t rng;
+  rng_seed(&rng, SCENE_SEED);
+
+  if (!is_json) {
+    printf("%8s %8s %10s %12s %10s %10s %10s\n", "bodies", "forcers",
+           "build ms", "ms/tick", "mad ms", "ns/body", "peak MiB");
+  }
+  for (size_t i = 0; i < NUM_SCENE_SIZES && SCENE_SIZES[i] <= max_bodies;
+       i++) {
+    double start = now_seconds();
+    bench_scene_t bench = build_scene(SCENE_SIZES[i], &rng);
+    double build_ms = (now_seconds() - start) * 1e3;
+
+    bench_result_t result = bench_run("scene_tick", tick_scene, &bench,
+                                      &options);
+    double ms_per_tick = result.median_ns / 1e6;
+    double ns_per_body = result.median_ns / bench.num_bodies;
+    double peak_rss = get_peak_rss();
+    if (is_json) {
+      printf("{\"bodies\":%zu,\"forcers\":%zu,\"build_ms\":%.3f,"
+             "\"median_tick_ms\":%.4f,\"mad_tick_ms\":%.4f,"
+             "\"ns_per_body\":%.2f,\"peak_rss_mib\":%.1f,\"ticks\":%zu}\n",
+             bench.num_bodies, bench.num_forcers, build_ms, ms_per_tick,
+             result.mad_ns / 1e6, ns_per_body, peak_rss, ticks);
+    } else {
+      printf("%8zu %8zu %10.2f %12.4f %10.4f %10.1f %10.1f\n",
+             bench.num_bodies, bench.num_forcers, build_ms, ms_per_tick,
+             result.mad_ns / 1e6, ns_per_body, peak_rss);
+    }
+    fflush(stdout);
+    scene_free(bench.scene);
+  }
+  return 0;
+}
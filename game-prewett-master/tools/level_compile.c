@@ -0,0 +1,183 @@
+/**
+ * Compiles a text level (see level.h) into the chunked binary layout that the
+ * game memory-maps.
+ *
+ * Usage: level_compile <input_file> <output_file> [chunk_width]
+ *
+ * Placements are sorted by the left edge of their bounding box and split into
+ * chunks of `chunk_width` level units (two screens by default). Each chunk
+ * stores the parts of its placements' shapes after its records, so the game
+ * spawns them without building anything. The text is parsed by
+ * level_parse_text() and the shapes come from prefab.h, so this links against
+ * library/level.c and library/prefab.c.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "level.h"
+#include "prefab.h"
+
+const double DEFAULT_CHUNK_WIDTH = 2000;
+
+typedef struct {
+  char (*names)[LEVEL_KIND_NAME_LEN];
+  size_t num_names;
+  size_t capacity;
+} kind_table_t;
+
+// Gets the index of a kind name, adding it to the table if it is new
+static size_t intern_kind(kind_table_t *table, const char *name) {
+  for (size_t i = 0; i < table->num_names; i++) {
+    if (strncmp(table->names[i], name, LEVEL_KIND_NAME_LEN) == 0) {
+      return i;
+    }
+  }
+  if (table->num_names == table->capacity) {
+    table->capacity = table->capacity ? table->capacity * 2 : 8;
+    table->names =
+        realloc(table->names, table->capacity * sizeof(*table->names));
+    assert(table->names);
+  }
+  memset(table->names[table->num_names], 0, LEVEL_KIND_NAME_LEN);
+  strncpy(table->names[table->num_names], name, LEVEL_KIND_NAME_LEN - 1);
+  return table->num_names++;
+}
+
+// Resolves kind names for level_parse_text() to the prefab shapes, skipping
+// unknown names
+static size_t resolve_kind(void *aux, const char *name, const char *path,
+                           size_t line_number, level_shape_t *shape) {
+  kind_table_t *table = aux;
+  prefab_kind_t prefab = prefab_find(name);
+  if (prefab == NUM_PREFABS) {
+    fprintf(stderr, "%s:%zu: unknown kind '%s'\n", path, line_number, name);
+    return LEVEL_NO_KIND;
+  }
+  *shape = PREFAB_SHAPES[prefab];
+  return intern_kind(table, name);
+}
+
+static size_t chunk_of(const level_record_t *record, double chunk_width) {
+  if (record->min.x <= 0) {
+    return 0;
+  }
+  return (size_t)floor(record->min.x / chunk_width);
+}
+
+static uint64_t align_up(uint64_t offset) {
+  return (offset + LEVEL_CHUNK_ALIGNMENT - 1) / LEVEL_CHUNK_ALIGNMENT *
+         LEVEL_CHUNK_ALIGNMENT;
+}
+
+static void write_padding(FILE *out, uint64_t from, uint64_t to) {
+  for (uint64_t i = from; i < to; i++) {
+    fputc(0, out);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "Usage: %s <input_file> <output_file> [chunk_width]\n",
+            argv[0]);
+    return 1;
+  }
+  double chunk_width = argc == 4 ? atof(argv[3]) : DEFAULT_CHUNK_WIDTH;
+  if (chunk_width <= 0) {
+    fprintf(stderr, "Chunk width must be positive\n");
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "r");
+  if (in == NULL) {
+    fprintf(stderr, "Couldn't open %s\n", argv[1]);
+    return 1;
+  }
+
+  kind_table_t kinds = {NULL, 0, 0};
+  size_t count;
+  level_part_t *parts;
+  size_t num_parts;
+  double length;
+  level_record_t *records = level_parse_text(
+      in, argv[1], resolve_kind, &kinds, &count, &parts, &num_parts, &length);
+  fclose(in);
+
+  size_t num_chunks =
+      count ? chunk_of(&records[count - 1], chunk_width) + 1 : 0;
+  level_chunk_t *chunks = calloc(num_chunks ? num_chunks : 1,
+                                 sizeof(level_chunk_t));
+  assert(chunks);
+  for (size_t i = 0; i < count; i++) {
+    level_chunk_t *chunk = &chunks[chunk_of(&records[i], chunk_width)];
+    chunk->num_records++;
+    chunk->num_parts += records[i].num_parts;
+  }
+  uint64_t offset = sizeof(level_file_header_t) +
+                    kinds.num_names * LEVEL_KIND_NAME_LEN +
+                    num_chunks * sizeof(level_chunk_t);
+  for (size_t i = 0; i < num_chunks; i++) {
+    // Aligned to pages so each chunk can be paged in and out on its own
+    offset = align_up(offset);
+    chunks[i].offset = offset;
+    offset += chunks[i].num_records * sizeof(level_record_t) +
+              chunks[i].num_parts * sizeof(level_part_t);
+  }
+
+  FILE *out = fopen(argv[2], "wb");
+  if (out == NULL) {
+    fprintf(stderr, "Couldn't open %s for writing\n", argv[2]);
+    free(chunks);
+    free(records);
+    free(parts);
+    free(kinds.names);
+    return 1;
+  }
+
+  level_file_header_t header = {.version = LEVEL_VERSION,
+                                .num_kinds = kinds.num_names,
+                                .num_chunks = num_chunks,
+                                .num_records = count,
+                                .chunk_width = chunk_width,
+                                .length = length};
+  memcpy(header.magic, LEVEL_MAGIC, sizeof(header.magic));
+  fwrite(&header, sizeof(header), 1, out);
+  fwrite(kinds.names, LEVEL_KIND_NAME_LEN, kinds.num_names, out);
+  fwrite(chunks, sizeof(level_chunk_t), num_chunks, out);
+
+  uint64_t written = sizeof(level_file_header_t) +
+                     kinds.num_names * LEVEL_KIND_NAME_LEN +
+                     num_chunks * sizeof(level_chunk_t);
+  size_t next = 0;
+  for (size_t i = 0; i < num_chunks; i++) {
+    write_padding(out, written, chunks[i].offset);
+    level_record_t *first = &records[next];
+    size_t chunk_size = chunks[i].num_records;
+    // Parts are indexed from the start of their chunk's parts
+    uint32_t first_part = 0;
+    for (size_t j = 0; j < chunk_size; j++) {
+      level_record_t record = first[j];
+      record.first_part = first_part;
+      first_part += record.num_parts;
+      fwrite(&record, sizeof(record), 1, out);
+    }
+    for (size_t j = 0; j < chunk_size; j++) {
+      fwrite(&parts[first[j].first_part], sizeof(level_part_t),
+             first[j].num_parts, out);
+    }
+    next += chunk_size;
+    written = chunks[i].offset + chunk_size * sizeof(level_record_t) +
+              chunks[i].num_parts * sizeof(level_part_t);
+  }
+
+  fclose(out);
+  free(chunks);
+  free(records);
+  free(parts);
+  free(kinds.names);
+  printf("Compiled %zu placements into %zu chunks in %s\n", count, num_chunks,
+         argv[2]);
+  return 0;
+}
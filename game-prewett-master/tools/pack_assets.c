@@ -0,0 +1,204 @@
+/**
+ * Builds an asset archive (see asset_pack.h) from every file in an assets
+ * directory.
+ *
+ * Usage: pack_assets <assets_dir> <output_file>
+ *
+ * Entries are named "<assets_dir>/<filename>", which is the same path the game
+ * passes to the asset cache, e.g. "assets/coin.png".
+ */
+#include <assert.h>
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "asset_pack.h"
+
+const size_t COPY_BUFFER_SIZE = 1 << 16;
+
+typedef struct {
+  pack_entry_t entry;
+  char path[1024];
+} pack_source_t;
+
+static pack_type_t type_from_extension(const char *filename) {
+  const char *ext = strrchr(filename, '.');
+  if (ext == NULL) {
+    return PACK_OTHER;
+  }
+  ext++;
+  if (strcasecmp(ext, "png") == 0 || strcasecmp(ext, "jpg") == 0 ||
+      strcasecmp(ext, "jpeg") == 0 || strcasecmp(ext, "bmp") == 0) {
+    return PACK_IMAGE;
+  }
+  if (strcasecmp(ext, "ttf") == 0) {
+    return PACK_FONT;
+  }
+  if (strcasecmp(ext, "wav") == 0 || strcasecmp(ext, "ogg") == 0 ||
+      strcasecmp(ext, "mp3") == 0) {
+    return PACK_AUDIO;
+  }
+  return PACK_OTHER;
+}
+
+static int compare_sources(const void *a, const void *b) {
+  return strncmp(((const pack_source_t *)a)->entry.name,
+                 ((const pack_source_t *)b)->entry.name, PACK_NAME_LEN);
+}
+
+static uint64_t align_up(uint64_t offset) {
+  return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+}
+
+static bool write_padding(FILE *out, uint64_t from, uint64_t to) {
+  for (uint64_t i = from; i < to; i++) {
+    if (fputc(0, out) == EOF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Copies a source file into the archive. The file must still be the size it
+ * was when its entry was made, or the offsets after it would be wrong.
+ *
+ * @return whether all of the file was copied
+ */
+static bool copy_source(const pack_source_t *source, FILE *out, char *buffer) {
+  FILE *in = fopen(source->path, "rb");
+  if (in == NULL) {
+    fprintf(stderr, "Couldn't open %s\n", source->path);
+    return false;
+  }
+  uint64_t copied = 0;
+  size_t n;
+  while ((n = fread(buffer, 1, COPY_BUFFER_SIZE, in)) > 0) {
+    if (fwrite(buffer, 1, n, out) != n) {
+      fprintf(stderr, "Couldn't write %s to the archive\n", source->path);
+      fclose(in);
+      return false;
+    }
+    copied += n;
+  }
+  bool read_failed = ferror(in);
+  fclose(in);
+  if (read_failed || copied != source->entry.size) {
+    fprintf(stderr, "Read %llu of the %llu bytes of %s\n",
+            (unsigned long long)copied,
+            (unsigned long long)source->entry.size, source->path);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <assets_dir> <output_file>\n", argv[0]);
+    return 1;
+  }
+  char dir_name[PACK_NAME_LEN];
+  snprintf(dir_name, sizeof(dir_name), "%s", argv[1]);
+  size_t dir_len = strlen(dir_name);
+  while (dir_len > 1 && dir_name[dir_len - 1] == '/') {
+    dir_name[--dir_len] = '\0';
+  }
+
+  DIR *dir = opendir(argv[1]);
+  if (dir == NULL) {
+    fprintf(stderr, "Couldn't open directory %s\n", argv[1]);
+    return 1;
+  }
+
+  size_t capacity = 16;
+  size_t count = 0;
+  pack_source_t *sources = malloc(capacity * sizeof(pack_source_t));
+  assert(sources);
+
+  struct dirent *file;
+  while ((file = readdir(dir)) != NULL) {
+    if (file->d_name[0] == '.') {
+      continue;
+    }
+    if (count == capacity) {
+      capacity *= 2;
+      sources = realloc(sources, capacity * sizeof(pack_source_t));
+      assert(sources);
+    }
+    pack_source_t *source = &sources[count];
+    memset(source, 0, sizeof(*source));
+    snprintf(source->path, sizeof(source->path), "%s/%s", argv[1],
+             file->d_name);
+
+    struct stat info;
+    if (stat(source->path, &info) != 0 || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+    int name_len = snprintf(source->entry.name, PACK_NAME_LEN, "%s/%s",
+                            dir_name, file->d_name);
+    if (name_len >= PACK_NAME_LEN) {
+      fprintf(stderr, "Skipping %s: name longer than %d characters\n",
+              source->path, PACK_NAME_LEN - 1);
+      continue;
+    }
+    source->entry.type = type_from_extension(file->d_name);
+    source->entry.size = info.st_size;
+    count++;
+  }
+  closedir(dir);
+
+  // The runtime binary searches the index, so it must be sorted by name
+  qsort(sources, count, sizeof(pack_source_t), compare_sources);
+
+  uint64_t offset = sizeof(pack_header_t) + count * sizeof(pack_entry_t);
+  for (size_t i = 0; i < count; i++) {
+    offset = align_up(offset);
+    sources[i].entry.offset = offset;
+    offset += sources[i].entry.size;
+  }
+
+  FILE *out = fopen(argv[2], "wb");
+  if (out == NULL) {
+    fprintf(stderr, "Couldn't open %s for writing\n", argv[2]);
+    free(sources);
+    return 1;
+  }
+
+  pack_header_t header = {.version = PACK_VERSION, .num_entries = count};
+  memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+  for (size_t i = 0; ok && i < count; i++) {
+    ok = fwrite(&sources[i].entry, sizeof(pack_entry_t), 1, out) == 1;
+  }
+
+  char *buffer = malloc(COPY_BUFFER_SIZE);
+  assert(buffer);
+  uint64_t written = sizeof(pack_header_t) + count * sizeof(pack_entry_t);
+  for (size_t i = 0; ok && i < count; i++) {
+    ok = write_padding(out, written, sources[i].entry.offset) &&
+         copy_source(&sources[i], out, buffer);
+    written = sources[i].entry.offset + sources[i].entry.size;
+    if (ok) {
+      printf("%-56s %10llu bytes\n", sources[i].entry.name,
+             (unsigned long long)sources[i].entry.size);
+    }
+  }
+  free(buffer);
+  free(sources);
+
+  // Buffered writes may only fail once they are flushed
+  if (fclose(out) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    fprintf(stderr, "Couldn't write %s\n", argv[2]);
+    remove(argv[2]);
+    return 1;
+  }
+  printf("Packed %zu assets into %s\n", count, argv[2]);
+  return 0;
+}
@@ -0,0 +1,460 @@
+/**
+ * Plays recorded gameplay sessions through the game and checks that they run
+ * no slower than a baseline.
+ *
+ * Usage: perf_replay [options] <replay>...
+ *   --baseline <file>        compare the results against this baseline
+ *   --write-baseline <file>  write the results as a new baseline instead
+ *   --tolerance <stat>=<pct> how much slower than the baseline the p50, p99
+ *                            or max may be, in percent (10, 25 and 50 by
+ *                            default)
+ *   --slack <ms>             added to every limit, so very short times do not
+ *                            fail on noise (0.05 by default)
+ *   --runs <n>               how many times to play each session, keeping the
+ *                            best value of each statistic (3 by default)
+ *
+ * Each replay is a recording made with GD_RECORD, played back exactly as the
+ * game does with GD_REPLAY. A frame is two fixed steps, as at 60 FPS, then
+ * drawing the frame into an offscreen texture, so nothing waits for vsync.
+ * Each frame is timed in parts:
+ *  - sim: the steps,
+ *  - collision: the part of the steps spent in collision force creators,
+ *  - render: drawing the frame, until the renderer has been handed every
+ *    command,
+ *  - frame: sim and render together.
+ * The median, 99th percentile and maximum of each are reported in
+ * milliseconds. Exits with 1 if any of them is slower than the baseline
+ * allows, or 2 if the arguments are wrong or a session could not be played.
+ *
+ * Build it like the game but with -DPROFILE, with library/bench_util.c, and
+ * with this file in place of library/emscripten.c, and run it from the
+ * directory the game runs from.
+ * The standard sessions are the .gdrp files in sessions/, written by
+ * tools/record_sessions.c. Pass all of them with --write-baseline before a
+ * change and with --baseline after it.
+ *
+ * Baselines are only comparable on the machine they were written on, so
+ * none is checked in; write one before making the change being measured.
+ *
+ * Every run of a session is a child process, since the game keeps some of
+ * its state in globals that emscripten_init() does not reset.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "clock.h"
+#include "list.h"
+#include "profiler.h"
+#include "sdl_wrapper.h"
+#include "state.h"
+
+#ifndef PROFILE
+#error "perf_replay needs -DPROFILE to time collisions"
+#endif
+
+const char *PERF_REPLAY_ENV = "GD_REPLAY";
+const char *PERF_PROFILE_ENV = "GD_PROFILE";
+const char *NULL_DEVICE = "/dev/null";
+const size_t STEPS_PER_FRAME = 2;
+// An hour of frames; a replay that runs longer is probably not being played
+const size_t MAX_FRAMES = 60 * 60 * 60;
+const size_t INITIAL_FRAMES = 1024;
+const size_t DEFAULT_RUNS = 3;
+const double DEFAULT_SLACK_MS = 0.05;
+const double HARNESS_MS_PER_S = 1e3;
+const double HARNESS_MS_PER_NS = 1e-6;
+#define MAX_SESSION_NAME 64
+#define MAX_METRIC_NAME 16
+#define MAX_BASELINE_LINE 256
+
+// The zones of the force creators that run collision tests
+#define NUM_COLLISION_ZONES 2
+const char *const COLLISION_ZONES[NUM_COLLISION_ZONES] = {
+    "collision_force_creator", "compound_collision_force_creator"};
+
+typedef enum {
+  METRIC_SIM,
+  METRIC_COLLISION,
+  METRIC_RENDER,
+  METRIC_FRAME,
+  NUM_METRICS,
+} metric_t;
+
+const char *const METRIC_NAMES[NUM_METRICS] = {"sim", "collision", "render",
+                                               "frame"};
+
+typedef enum { STAT_P50, STAT_P99, STAT_MAX, NUM_STATS } stat_t;
+
+const char *const STAT_NAMES[NUM_STATS] = {"p50", "p99", "max"};
+const double STAT_PERCENTILES[NUM_STATS] = {0.5, 0.99, 1};
+const double DEFAULT_TOLERANCES[NUM_STATS] = {10, 25, 50};
+
+// The statistics of a session, in milliseconds
+typedef struct {
+  size_t frames;
+  double stats[NUM_METRICS][NUM_STATS];
+} session_result_t;
+
+// A line of a baseline file
+typedef struct {
+  char session[MAX_SESSION_NAME];
+  char metric[MAX_METRIC_NAME];
+  double stats[NUM_STATS];
+} baseline_row_t;
+
+typedef struct {
+  const char *baseline_path;
+  const char *write_path;
+  double tolerances[NUM_STATS];
+  double slack_ms;
+  size_t runs;
+} options_t;
+
+// Gets a percentile of sorted values by the nearest-rank method
+static double get_percentile(const double *sorted, size_t n, double p) {
+  size_t rank = (size_t)ceil(p * n);
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Gets the name a session is stored under in baselines: its file name
+static const char *get_session_name(const char *replay_path) {
+  const char *slash = strrchr(replay_path, '/');
+  return slash != NULL ? slash + 1 : replay_path;
+}
+
+/**
+ * Plays a session in this process, timing each of its frames.
+ * Returns false if the session could not be played to its end.
+ */
+static bool measure_session(const char *replay_path,
+                            session_result_t *result) {
+  setenv(PERF_REPLAY_ENV, replay_path, 1);
+  state_t *state = emscripten_init();
+  SDL_Renderer *renderer = sdl_get_renderer();
+  int width, height;
+  SDL_GetRendererOutputSize(renderer, &width, &height);
+  SDL_Texture *target =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_TARGET, width, height);
+  if (target == NULL) {
+    fprintf(stderr, "Couldn't create an offscreen target: %s\n",
+            SDL_GetError());
+    emscripten_free(state);
+    return false;
+  }
+
+  size_t capacity = INITIAL_FRAMES;
+  double *samples[NUM_METRICS];
+  for (size_t i = 0; i < NUM_METRICS; i++) {
+    samples[i] = malloc(capacity * sizeof(double));
+    assert(samples[i]);
+  }
+  size_t frames = 0;
+  bool is_done = false;
+  while (!is_done && frames < MAX_FRAMES) {
+    size_t mark = profiler_mark();
+    double start = now_seconds();
+    for (size_t i = 0; i < STEPS_PER_FRAME && !is_done; i++) {
+      is_done = emscripten_step(state) == 0;
+    }
+    double sim = now_seconds() - start;
+    uint64_t collision_ns = 0;
+    for (size_t i = 0; i < NUM_COLLISION_ZONES; i++) {
+      collision_ns += profiler_total(COLLISION_ZONES[i], mark);
+    }
+
+    SDL_SetRenderTarget(renderer, target);
+    start = now_seconds();
+    emscripten_render(state);
+    SDL_RenderFlush(renderer);
+    double render = now_seconds() - start;
+    SDL_SetRenderTarget(renderer, NULL);
+
+    if (frames == capacity) {
+      capacity *= 2;
+      for (size_t i = 0; i < NUM_METRICS; i++) {
+        samples[i] = realloc(samples[i], capacity * sizeof(double));
+        assert(samples[i]);
+      }
+    }
+    samples[METRIC_SIM][frames] = sim * HARNESS_MS_PER_S;
+    samples[METRIC_COLLISION][frames] = collision_ns * HARNESS_MS_PER_NS;
+    samples[METRIC_RENDER][frames] = render * HARNESS_MS_PER_S;
+    samples[METRIC_FRAME][frames] = (sim + render) * HARNESS_MS_PER_S;
+    frames++;
+  }
+
+  result->frames = frames;
+  for (size_t i = 0; i < NUM_METRICS; i++) {
+    qsort(samples[i], frames, sizeof(double), bench_compare_doubles);
+    for (size_t j = 0; j < NUM_STATS; j++) {
+      result->stats[i][j] =
+          get_percentile(samples[i], frames, STAT_PERCENTILES[j]);
+    }
+    free(samples[i]);
+  }
+  SDL_DestroyTexture(target);
+  emscripten_free(state);
+  if (!is_done) {
+    fprintf(stderr, "%s did not end after %zu frames\n", replay_path, frames);
+  }
+  return is_done;
+}
+
+// Plays a session in a child process
+static bool run_session(const char *replay_path, session_result_t *result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return false;
+  }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    // Only the timings are wanted, not the game's output or trace file
+    setenv(PERF_PROFILE_ENV, NULL_DEVICE, 1);
+    freopen(NULL_DEVICE, "w", stdout);
+    session_result_t child_result;
+    bool is_measured = measure_session(replay_path, &child_result);
+    if (is_measured) {
+      is_measured = write(fds[1], &child_result, sizeof(child_result)) ==
+                    sizeof(child_result);
+    }
+    _exit(is_measured ? 0 : 1);
+  }
+
+  close(fds[1]);
+  // Smaller than PIPE_BUF, so it is written and read in one piece
+  ssize_t size = read(fds[0], result, sizeof(*result));
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  return size == sizeof(*result) && WIFEXITED(status) &&
+         WEXITSTATUS(status) == 0;
+}
+
+// Keeps the lowest value of each statistic, which is the least disturbed
+static void merge_best(session_result_t *best, const session_result_t *run) {
+  for (size_t i = 0; i < NUM_METRICS; i++) {
+    for (size_t j = 0; j < NUM_STATS; j++) {
+      best->stats[i][j] = fmin(best->stats[i][j], run->stats[i][j]);
+    }
+  }
+}
+
+// Reads a baseline into a list of baseline_row_t, or returns NULL
+static list_t *read_baseline(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return NULL;
+  }
+  list_t *rows = list_init(NUM_METRICS, free);
+  char line[MAX_BASELINE_LINE];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    baseline_row_t *row = malloc(sizeof(baseline_row_t));
+    assert(row);
+    if (sscanf(line, "%63s %15s %lf %lf %lf", row->session, row->metric,
+               &row->stats[STAT_P50], &row->stats[STAT_P99],
+               &row->stats[STAT_MAX]) != 2 + NUM_STATS) {
+      fprintf(stderr, "Skipping malformed line in %s: %s", path, line);
+      free(row);
+      continue;
+    }
+    list_add(rows, row);
+  }
+  fclose(file);
+  return rows;
+}
+
+static baseline_row_t *find_row(list_t *rows, const char *session,
+                                const char *metric) {
+  for (size_t i = 0; i < list_size(rows); i++) {
+    baseline_row_t *row = list_get(rows, i);
+    if (strcmp(row->session, session) == 0 &&
+        strcmp(row->metric, metric) == 0) {
+      return row;
+    }
+  }
+  return NULL;
+}
+
+// Prints every statistic that is slower than its baseline allows
+static size_t count_regressions(const options_t *options, list_t *baseline,
+                                const char *session,
+                                const session_result_t *result) {
+  size_t regressions = 0;
+  for (size_t i = 0; i < NUM_METRICS; i++) {
+    baseline_row_t *row = find_row(baseline, session, METRIC_NAMES[i]);
+    if (row == NULL) {
+      printf("%s %s: not in the baseline\n", session, METRIC_NAMES[i]);
+      continue;
+    }
+    for (size_t j = 0; j < NUM_STATS; j++) {
+      double limit = row->stats[j] * (1 + options->tolerances[j] / 100) +
+                     options->slack_ms;
+      if (result->stats[i][j] > limit) {
+        printf("REGRESSION %s %s %s: %.4f ms, baseline %.4f ms, limit %.4f "
+               "ms\n",
+               session, METRIC_NAMES[i], STAT_NAMES[j], result->stats[i][j],
+               row->stats[j], limit);
+        regressions++;
+      }
+    }
+  }
+  return regressions;
+}
+
+static void write_rows(FILE *file, const char *session,
+                       const session_result_t *result) {
+  for (size_t i = 0; i < NUM_METRICS; i++) {
+    fprintf(file, "%s %s %.4f %.4f %.4f\n", session, METRIC_NAMES[i],
+            result->stats[i][STAT_P50], result->stats[i][STAT_P99],
+            result->stats[i][STAT_MAX]);
+  }
+}
+
+static bool parse_tolerance(const char *arg, options_t *options) {
+  for (size_t i = 0; i < NUM_STATS; i++) {
+    size_t length = strlen(STAT_NAMES[i]);
+    if (strncmp(arg, STAT_NAMES[i], length) == 0 && arg[length] == '=') {
+      options->tolerances[i] = atof(arg + length + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+static int usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [--baseline <file> | --write-baseline <file>] "
+          "[--tolerance <p50|p99|max>=<pct>] [--slack <ms>] [--runs <n>] "
+          "<replay>...\n",
+          program);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  options_t options = {.baseline_path = NULL,
+                       .write_path = NULL,
+                       .slack_ms = DEFAULT_SLACK_MS,
+                       .runs = DEFAULT_RUNS};
+  memcpy(options.tolerances, DEFAULT_TOLERANCES, sizeof(DEFAULT_TOLERANCES));
+  int first_replay = argc;
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+      options.baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--write-baseline") == 0 && has_value) {
+      options.write_path = argv[++i];
+    } else if (strcmp(argv[i], "--tolerance") == 0 && has_value) {
+      if (!parse_tolerance(argv[++i], &options)) {
+        return usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--slack") == 0 && has_value) {
+      options.slack_ms = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--runs") == 0 && has_value) {
+      options.runs = strtoul(argv[++i], NULL, 10);
+    } else if (strncmp(argv[i], "--", 2) == 0) {
+      return usage(argv[0]);
+    } else {
+      first_replay = i;
+      break;
+    }
+  }
+  if (first_replay == argc || options.runs == 0 ||
+      (options.baseline_path != NULL && options.write_path != NULL)) {
+    return usage(argv[0]);
+  }
+
+  list_t *baseline = NULL;
+  if (options.baseline_path != NULL) {
+    baseline = read_baseline(options.baseline_path);
+    if (baseline == NULL) {
+      fprintf(stderr, "Couldn't read %s\n", options.baseline_path);
+      return 2;
+    }
+  }
+  FILE *out = NULL;
+  if (options.write_path != NULL) {
+    out = fopen(options.write_path, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Couldn't open %s for writing\n", options.write_path);
+      return 2;
+    }
+    fprintf(out, "# session metric p50_ms p99_ms max_ms\n");
+  }
+
+  size_t regressions = 0;
+  bool has_failed = false;
+  printf("%-24s %-10s %10s %10s %10s %8s\n", "session", "metric", "p50 ms",
+         "p99 ms", "max ms", "frames");
+  for (int i = first_replay; i < argc; i++) {
+    const char *session = get_session_name(argv[i]);
+    // A replay that can't be opened would leave the game on its start screen
+    FILE *replay = fopen(argv[i], "rb");
+    if (replay == NULL) {
+      fprintf(stderr, "Couldn't open %s\n", argv[i]);
+      has_failed = true;
+      continue;
+    }
+    fclose(replay);
+
+    session_result_t best;
+    bool is_measured = true;
+    for (size_t run = 0; run < options.runs && is_measured; run++) {
+      session_result_t result;
+      is_measured = run_session(argv[i], &result);
+      if (run == 0) {
+        best = result;
+      } else if (is_measured) {
+        merge_best(&best, &result);
+      }
+    }
+    if (!is_measured) {
+      fprintf(stderr, "Couldn't play %s\n", argv[i]);
+      has_failed = true;
+      continue;
+    }
+
+    for (size_t j = 0; j < NUM_METRICS; j++) {
+      printf("%-24s %-10s %10.4f %10.4f %10.4f %8zu\n", session,
+             METRIC_NAMES[j], best.stats[j][STAT_P50], best.stats[j][STAT_P99],
+             best.stats[j][STAT_MAX], best.frames);
+    }
+    if (baseline != NULL) {
+      regressions += count_regressions(&options, baseline, session, &best);
+    }
+    if (out != NULL) {
+      write_rows(out, session, &best);
+    }
+  }
+
+  if (out != NULL && fclose(out) != 0) {
+    fprintf(stderr, "Couldn't write %s\n", options.write_path);
+    has_failed = true;
+  }
+  if (baseline != NULL) {
+    list_free(baseline);
+    printf("%zu regression%s\n", regressions, regressions == 1 ? "" : "s");
+  }
+  if (has_failed) {
+    return 2;
+  }
+  return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * Writes the gameplay sessions that perf_replay plays, as recordings in the
+ * format of replay.h.
+ *
+ * Usage: record_sessions <output_dir>
+ *
+ * The sessions are scripted rather than played by hand: each clicks the play
+ * button and then presses keys on a fixed schedule. Playback only depends on
+ * the seed and the inputs, so the same session loads the game the same way
+ * on every machine. The copies in sessions/ were written by this tool; run it
+ * again after changing the schedules below.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "replay.h"
+#include "sdl_wrapper.h"
+
+// The game takes this many fixed steps per second
+const uint64_t SESSION_STEPS_PER_S = 120;
+// The center of the play button on the start screen
+const int32_t SESSION_PLAY_X = 500;
+const int32_t SESSION_PLAY_Y = 295;
+const uint64_t SESSION_JUMP_HOLD = 10;
+const char SESSION_PRACTICE_KEY = 'p';
+#define MAX_SESSION_PATH 1024
+
+typedef struct {
+  const char *name;
+  uint64_t seed;
+  // Whether practice mode is turned on right after play is clicked
+  bool practice;
+  // Steps between the starts of jumps, or 0 not to jump
+  uint64_t jump_period;
+  uint64_t seconds;
+} session_spec_t;
+
+// Dying at every obstacle, then jumping steadily, then respawning from
+// checkpoints
+#define NUM_SESSIONS 3
+const session_spec_t SESSIONS[NUM_SESSIONS] = {
+    {.name = "idle.gdrp", .seed = 1, .jump_period = 0, .seconds = 60},
+    {.name = "jumping.gdrp", .seed = 2, .jump_period = 60, .seconds = 60},
+    {.name = "practice.gdrp",
+     .seed = 3,
+     .practice = true,
+     .jump_period = 45,
+     .seconds = 60},
+};
+
+static void write_key(replay_t *replay, uint64_t tick, char key, bool released,
+                      double held_time) {
+  replay_event_t event = {.type = REPLAY_KEY,
+                          .tick = tick,
+                          .key = key,
+                          .released = released,
+                          .held_time = held_time};
+  replay_write(replay, &event);
+}
+
+static bool write_session(const char *dir, const session_spec_t *spec) {
+  char path[MAX_SESSION_PATH];
+  snprintf(path, sizeof(path), "%s/%s", dir, spec->name);
+  replay_t *replay = replay_record(path, spec->seed);
+  if (replay == NULL) {
+    fprintf(stderr, "Couldn't open %s for writing\n", path);
+    return false;
+  }
+
+  replay_event_t click = {.type = REPLAY_CLICK,
+                          .tick = 0,
+                          .x = SESSION_PLAY_X,
+                          .y = SESSION_PLAY_Y};
+  replay_write(replay, &click);
+  if (spec->practice) {
+    write_key(replay, 1, SESSION_PRACTICE_KEY, false, 0);
+    write_key(replay, 2, SESSION_PRACTICE_KEY, true, 0);
+  }
+
+  uint64_t length = spec->seconds * SESSION_STEPS_PER_S;
+  if (spec->jump_period > 0) {
+    double held_time = (double)SESSION_JUMP_HOLD / SESSION_STEPS_PER_S;
+    for (uint64_t tick = spec->jump_period;
+         tick + SESSION_JUMP_HOLD < length; tick += spec->jump_period) {
+      write_key(replay, tick, UP_ARROW, false, 0);
+      write_key(replay, tick + SESSION_JUMP_HOLD, UP_ARROW, true, held_time);
+    }
+  }
+  replay_close(replay, length);
+  printf("Wrote %s (%llu s)\n", path, (unsigned long long)spec->seconds);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <output_dir>\n", argv[0]);
+    return 1;
+  }
+  for (size_t i = 0; i < NUM_SESSIONS; i++) {
+    if (!write_session(argv[1], &SESSIONS[i])) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,393 @@
+/**
+ * Checks that every pair of obstacles the random spawner can produce can be
+ * cleared, by simulating the pair many times with randomized jump timing.
+ *
+ * Usage: validate_levels [trials_per_sequence] [threads]
+ *
+ * Each trial spawns one obstacle, then the next one a spawn interval later,
+ * exactly as the game's random spawner does, and the dasher jumps whenever
+ * the next lethal part is closer than a randomly drawn lead distance. A
+ * sequence is cleared if any trial gets past both obstacles alive; sequences
+ * that no trial clears are reported as unclearable.
+ *
+ * Trials are split between worker threads (one per core by default), and each
+ * worker simulates its trials in scenes of its own. Trial i of a sequence is
+ * always seeded the same way, so results do not depend on the thread count.
+ *
+ * The obstacle shapes and spawn tables are the game's own, from prefab.h.
+ * The physics constants mirror demo/game.c.
+ */
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "collision.h"
+#include "forces.h"
+#include "prefab.h"
+#include "rng.h"
+#include "scene.h"
+
+const size_t DEFAULT_TRIALS = 2000;
+// Trials handed to a worker at once, so workers rarely contend on the queue
+const size_t TRIALS_PER_JOB = 64;
+const uint64_t VALIDATE_SEED = 0x6764766c;
+
+const double STEP = 1.0 / 120;
+const vector_t START = {50, 70};
+const double DASHER_SIZE = 50;
+const double GROUND_Y = 70;
+const double GRAVITY = 2000;
+const double JUMP_SPEED = 750;
+const vector_t SPAWN_POINT = {1000, 70};
+// The range the lead distance of each jump is drawn from
+const double MIN_LEAD = 0;
+const double MAX_LEAD = 400;
+// Extra time after the second obstacle should have passed before giving up
+const double TRIAL_SLACK = 1;
+
+// An ordered pair of obstacles, with the tallies of its trials
+typedef struct {
+  const spawn_table_t *level;
+  prefab_kind_t first;
+  prefab_kind_t second;
+  atomic_size_t cleared;
+  atomic_size_t trials;
+} sequence_t;
+
+typedef struct {
+  sequence_t *sequences;
+  size_t num_sequences;
+  size_t trials_per_sequence;
+  size_t jobs_per_sequence;
+  atomic_size_t next_job;
+  // In steps, summed over all workers
+  atomic_ullong steps;
+} validator_t;
+
+// The state of one trial, passed to the collision handlers
+typedef struct {
+  body_t *dasher;
+  bool is_jumping;
+  bool is_dead;
+} trial_t;
+
+static list_t *make_box(vector_t center, double width, double height) {
+  list_t *points = list_init(4, free);
+  vector_t corners[] = {{-width / 2, -height / 2},
+                        {width / 2, -height / 2},
+                        {width / 2, height / 2},
+                        {-width / 2, height / 2}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point);
+    *point = vec_add(center, corners[i]);
+    list_add(points, point);
+  }
+  return points;
+}
+
+static void land(body_t *dasher, body_t *obstacle, vector_t axis, void *aux,
+                 double force_const) {
+  trial_t *trial = aux;
+  vector_t velocity = body_get_velocity(dasher);
+  velocity.y = 0;
+  body_set_velocity(dasher, velocity);
+  trial->is_jumping = false;
+}
+
+static void die(body_t *dasher, body_t *obstacle, vector_t axis, void *aux,
+                double force_const) {
+  ((trial_t *)aux)->is_dead = true;
+}
+
+const collision_handler_t TAG_HANDLERS[NUM_PART_TAGS] = {
+    [PART_LANDING] = land,
+    [PART_SIDE] = die,
+    [PART_SPIKE] = die,
+};
+
+// Builds an obstacle out of the same parts as the game's prefabs. The drawn
+// block parts are left out, since nothing collides with them.
+static body_t *spawn_shape(scene_t *scene, trial_t *trial,
+                           const level_shape_t *shape, double velocity) {
+  body_t *obstacle =
+      body_init(make_box(SPAWN_POINT, shape->size.x, shape->size.y), INFINITY,
+                (rgb_color_t){0, 0, 0});
+  for (size_t i = 0; i < shape->num_parts; i++) {
+    const level_part_t *part = &shape->parts[i];
+    if (part->tag == PART_BLOCK) {
+      continue;
+    }
+    vector_t center = {SPAWN_POINT.x + (part->min.x + part->max.x) / 2,
+                       SPAWN_POINT.y + (part->min.y + part->max.y) / 2};
+    body_add_part(obstacle,
+                  make_box(center, part->max.x - part->min.x,
+                           part->max.y - part->min.y),
+                  part->tag);
+  }
+  body_set_velocity(obstacle, (vector_t){velocity, 0});
+  scene_add_body(scene, obstacle);
+  create_compound_collision(scene, trial->dasher, obstacle, TAG_HANDLERS,
+                            NUM_PART_TAGS, trial, 0);
+  return obstacle;
+}
+
+// Gets the distance from the dasher to the closest lethal part ahead of it
+static double get_gap(trial_t *trial, body_t **obstacles, size_t num) {
+  vector_t min, max;
+  body_get_bounds(trial->dasher, &min, &max);
+  double front = max.x;
+  double gap = INFINITY;
+  for (size_t i = 0; i < num; i++) {
+    if (obstacles[i] == NULL) {
+      continue;
+    }
+    for (size_t j = 0; j < body_num_parts(obstacles[i]); j++) {
+      if (body_get_part_tag(obstacles[i], j) == PART_LANDING) {
+        continue;
+      }
+      body_get_part_bounds(obstacles[i], j, &min, &max);
+      if (min.x >= front && min.x - front < gap) {
+        gap = min.x - front;
+      }
+    }
+  }
+  return gap;
+}
+
+// Whether the dasher is standing on an obstacle, as in the game
+static bool is_on_obstacle(trial_t *trial, body_t **obstacles, size_t num) {
+  if (body_get_velocity(trial->dasher).y > 0) {
+    return false;
+  }
+  for (size_t i = 0; i < num; i++) {
+    if (obstacles[i] != NULL &&
+        find_tagged_collision(trial->dasher, obstacles[i], PART_LANDING)
+            .collided) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether an obstacle is entirely behind the dasher
+static bool is_passed(trial_t *trial, body_t *obstacle) {
+  vector_t dasher_min, dasher_max, min, max;
+  body_get_bounds(trial->dasher, &dasher_min, &dasher_max);
+  body_get_bounds(obstacle, &min, &max);
+  return max.x < dasher_min.x;
+}
+
+// Gets how far a shape reaches to the right of its anchor
+static double get_extent(const level_shape_t *shape) {
+  double extent = shape->size.x / 2;
+  for (size_t i = 0; i < shape->num_parts; i++) {
+    extent = fmax(extent, shape->parts[i].max.x);
+  }
+  return extent;
+}
+
+// Simulates one trial of a sequence, returning whether the dasher survived
+static bool run_trial(const sequence_t *sequence, uint64_t seed,
+                      size_t *steps) {
+  const spawn_table_t *level = sequence->level;
+  rng_t rng;
+  rng_seed(&rng, seed);
+
+  scene_t *scene = scene_init();
+  trial_t trial = {.is_jumping = false, .is_dead = false};
+  trial.dasher = body_init(make_box(START, DASHER_SIZE, DASHER_SIZE), 1,
+                           (rgb_color_t){1, 1, 1});
+  body_set_continuous(trial.dasher, true);
+  scene_add_body(scene, trial.dasher);
+
+  // The spawner's timer only fires on the first step at or past the interval
+  size_t second_tick = (size_t)ceil(level->interval / STEP - 1e-9);
+  double crossing = (SPAWN_POINT.x +
+                     get_extent(&PREFAB_SHAPES[sequence->second]) -
+                     START.x + DASHER_SIZE / 2) /
+                    -level->velocity;
+  size_t last_tick =
+      second_tick + (size_t)ceil((crossing + TRIAL_SLACK) / STEP);
+  body_t *obstacles[2] = {
+      spawn_shape(scene, &trial, &PREFAB_SHAPES[sequence->first],
+                  level->velocity),
+      NULL};
+  double lead = MIN_LEAD + rng_double(&rng) * (MAX_LEAD - MIN_LEAD);
+
+  bool cleared = false;
+  size_t tick = 0;
+  for (; tick < last_tick && !trial.is_dead; tick++) {
+    if (tick == second_tick) {
+      obstacles[1] = spawn_shape(
+          scene, &trial, &PREFAB_SHAPES[sequence->second], level->velocity);
+    }
+    if (obstacles[1] != NULL && is_passed(&trial, obstacles[1])) {
+      cleared = true;
+      break;
+    }
+
+    // Inputs arrive between steps, so the policy acts before the step
+    if (!trial.is_jumping && get_gap(&trial, obstacles, 2) < lead) {
+      vector_t velocity = body_get_velocity(trial.dasher);
+      velocity.y = JUMP_SPEED;
+      body_set_velocity(trial.dasher, velocity);
+      trial.is_jumping = true;
+      lead = MIN_LEAD + rng_double(&rng) * (MAX_LEAD - MIN_LEAD);
+    }
+
+    if (trial.is_jumping || !is_on_obstacle(&trial, obstacles, 2)) {
+      vector_t velocity = body_get_velocity(trial.dasher);
+      velocity.y -= GRAVITY * STEP;
+      body_set_velocity(trial.dasher, velocity);
+    }
+    scene_tick(scene, STEP);
+
+    vector_t centroid = body_get_centroid(trial.dasher);
+    if (centroid.y < GROUND_Y) {
+      body_set_centroid(trial.dasher, (vector_t){centroid.x, GROUND_Y});
+      trial.is_jumping = false;
+    }
+  }
+
+  *steps += tick;
+  scene_free(scene);
+  return cleared && !trial.is_dead;
+}
+
+// Gets the distinct kinds of a spawn table in the order they first appear
+static size_t get_distinct_kinds(const spawn_table_t *table,
+                                 prefab_kind_t kinds[NUM_PREFABS]) {
+  size_t count = 0;
+  for (size_t i = 0; i < table->num_kinds; i++) {
+    bool is_new = true;
+    for (size_t j = 0; j < count; j++) {
+      if (kinds[j] == table->kinds[i]) {
+        is_new = false;
+      }
+    }
+    if (is_new) {
+      kinds[count++] = table->kinds[i];
+    }
+  }
+  return count;
+}
+
+static void *run_worker(void *aux) {
+  validator_t *validator = aux;
+  size_t num_jobs = validator->num_sequences * validator->jobs_per_sequence;
+  size_t steps = 0;
+  while (true) {
+    size_t job = atomic_fetch_add(&validator->next_job, 1);
+    if (job >= num_jobs) {
+      break;
+    }
+    size_t index = job / validator->jobs_per_sequence;
+    sequence_t *sequence = &validator->sequences[index];
+    size_t first = job % validator->jobs_per_sequence * TRIALS_PER_JOB;
+    size_t last = first + TRIALS_PER_JOB;
+    if (last > validator->trials_per_sequence) {
+      last = validator->trials_per_sequence;
+    }
+
+    size_t cleared = 0;
+    for (size_t i = first; i < last; i++) {
+      uint64_t seed =
+          VALIDATE_SEED ^ ((uint64_t)index << 32) ^ (uint64_t)i;
+      if (run_trial(sequence, seed, &steps)) {
+        cleared++;
+      }
+    }
+    atomic_fetch_add(&sequence->cleared, cleared);
+    atomic_fetch_add(&sequence->trials, last - first);
+  }
+  atomic_fetch_add(&validator->steps, steps);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    fprintf(stderr, "Usage: %s [trials_per_sequence] [threads]\n", argv[0]);
+    return 1;
+  }
+  size_t trials = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_TRIALS;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t num_threads =
+      argc > 2 ? strtoul(argv[2], NULL, 10) : (cores > 0 ? cores : 1);
+  if (trials == 0 || num_threads == 0) {
+    fprintf(stderr, "Trials and threads must be positive\n");
+    return 1;
+  }
+
+  prefab_kind_t kinds[NUM_SPAWN_TABLES][NUM_PREFABS];
+  size_t num_kinds[NUM_SPAWN_TABLES];
+  size_t num_sequences = 0;
+  for (size_t i = 0; i < NUM_SPAWN_TABLES; i++) {
+    num_kinds[i] = get_distinct_kinds(&SPAWN_TABLES[i], kinds[i]);
+    num_sequences += num_kinds[i] * num_kinds[i];
+  }
+  sequence_t *sequences = malloc(num_sequences * sizeof(sequence_t));
+  assert(sequences);
+  size_t next = 0;
+  for (size_t i = 0; i < NUM_SPAWN_TABLES; i++) {
+    for (size_t a = 0; a < num_kinds[i]; a++) {
+      for (size_t b = 0; b < num_kinds[i]; b++) {
+        sequence_t *sequence = &sequences[next++];
+        sequence->level = &SPAWN_TABLES[i];
+        sequence->first = kinds[i][a];
+        sequence->second = kinds[i][b];
+        atomic_init(&sequence->cleared, 0);
+        atomic_init(&sequence->trials, 0);
+      }
+    }
+  }
+
+  validator_t validator = {.sequences = sequences,
+                           .num_sequences = num_sequences,
+                           .trials_per_sequence = trials,
+                           .jobs_per_sequence =
+                               (trials + TRIALS_PER_JOB - 1) / TRIALS_PER_JOB};
+  atomic_init(&validator.next_job, 0);
+  atomic_init(&validator.steps, 0);
+
+  double start = now_seconds();
+  pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+  assert(threads);
+  for (size_t i = 0; i < num_threads; i++) {
+    int error = pthread_create(&threads[i], NULL, run_worker, &validator);
+    assert(error == 0);
+  }
+  for (size_t i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  double elapsed = now_seconds() - start;
+
+  size_t unclearable = 0;
+  for (size_t i = 0; i < num_sequences; i++) {
+    sequence_t *sequence = &sequences[i];
+    size_t cleared = atomic_load(&sequence->cleared);
+    size_t total = atomic_load(&sequence->trials);
+    printf("%-7s %-17s -> %-17s %6.2f%% cleared%s\n", sequence->level->name,
+           PREFAB_NAMES[sequence->first], PREFAB_NAMES[sequence->second],
+           100.0 * cleared / total, cleared == 0 ? "  UNCLEARABLE" : "");
+    if (cleared == 0) {
+      unclearable++;
+    }
+  }
+
+  double simulated = atomic_load(&validator.steps) * STEP;
+  printf("\n%zu of %zu sequences unclearable\n", unclearable, num_sequences);
+  printf("Simulated %.0f s on %zu threads in %.2f s (%.0f simulated s per "
+         "wall s)\n",
+         simulated, num_threads, elapsed,
+         elapsed > 0 ? simulated / elapsed : 0);
+
+  free(threads);
+  free(sequences);
+  return unclearable == 0 ? 0 : 2;
+}